@@ -0,0 +1,233 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "render.h"
+#include "trace.h"
+
+/* Pages are ATLAS_PAGE_SIZE square unless a single image needs more. Every
+ * image gets ATLAS_PAD transparent pixels on its right and bottom so linear
+ * filtering never picks up a neighbour. */
+#define ATLAS_PAGE_SIZE 256
+#define ATLAS_PAD 1
+#define ATLAS_MAX_PENDING 128
+
+/* An image and its mip chain are packed as one block: level 0 in the top
+ * left corner and the smaller levels side by side below it. */
+typedef struct {
+    SpriteHandle *out;
+    SDL_Surface *surf[MIP_MAX_LEVELS]; /* ARGB8888 with the colour key turned into alpha */
+    int levels;
+    int bw, bh;                        /* block size, padding included */
+    int page;
+    int x, y;
+} AtlasEntry;
+
+static AtlasEntry pending[ATLAS_MAX_PENDING];
+static int pending_count = 0;
+
+void atlas_add(SpriteHandle *out, SDL_Surface *s)
+{
+    if (!out) {
+        SDL_FreeSurface(s);
+        return;
+    }
+    out->atlas = NULL;
+    out->rect = (SDL_Rect){0, 0, 0, 0};
+    out->levels = 0;
+    if (!s) return;
+
+    if (pending_count >= ATLAS_MAX_PENDING) {
+        fprintf(stderr, "ATLAS: too many sprites\n");
+        SDL_FreeSurface(s);
+        return;
+    }
+
+    SDL_Surface *conv = SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(s);
+    if (!conv) return;
+
+    /* Colour key (black) to alpha. */
+    SDL_LockSurface(conv);
+    for (int y = 0; y < conv->h; y++) {
+        Uint32 *row = (Uint32 *)((Uint8 *)conv->pixels + (size_t)y * (size_t)conv->pitch);
+        for (int x = 0; x < conv->w; x++) {
+            row[x] = (row[x] & 0x00FFFFFFu) ? (row[x] | 0xFF000000u) : 0u;
+        }
+    }
+    SDL_UnlockSurface(conv);
+
+    AtlasEntry *e = &pending[pending_count++];
+    e->out = out;
+    e->surf[0] = conv;
+    e->levels = 1;
+    e->page = -1;
+
+    int rowW = 0;
+    while (e->levels < MIP_MAX_LEVELS) {
+        SDL_Surface *next = mip_downsample(e->surf[e->levels - 1]);
+        if (!next) break;
+        e->surf[e->levels++] = next;
+        rowW += next->w + ATLAS_PAD;
+    }
+
+    e->bw = conv->w + ATLAS_PAD;
+    if (rowW > e->bw) e->bw = rowW;
+    e->bh = conv->h + ATLAS_PAD;
+    if (e->levels > 1) e->bh += e->surf[1]->h + ATLAS_PAD;
+}
+
+/* Position of mip level l of e inside its page. */
+static void level_origin(const AtlasEntry *e, int l, int *x, int *y)
+{
+    *x = e->x;
+    *y = e->y;
+    if (l == 0) return;
+    *y += e->surf[0]->h + ATLAS_PAD;
+    for (int k = 1; k < l; k++)
+        *x += e->surf[k]->w + ATLAS_PAD;
+}
+
+static int taller_first(const void *a, const void *b)
+{
+    const AtlasEntry *ea = (const AtlasEntry *)a;
+    const AtlasEntry *eb = (const AtlasEntry *)b;
+    return eb->bh - ea->bh;
+}
+
+/* Shelf packing: blocks sorted by height fill rows left to right; a new row
+ * starts below the tallest block of the current one. Returns the number of
+ * pages used and their sizes. */
+static int pack_entries(int *pageW, int *pageH, int maxPages)
+{
+    int pages = 0;
+    int shelfX = 0, shelfY = 0, shelfH = 0;
+
+    for (int i = 0; i < pending_count; i++) {
+        AtlasEntry *e = &pending[i];
+        int w = e->bw;
+        int h = e->bh;
+
+        if (pages > 0 && shelfX + w > pageW[pages - 1]) {
+            shelfX = 0;
+            shelfY += shelfH;
+            shelfH = 0;
+        }
+        if (pages == 0 || shelfY + h > pageH[pages - 1] || w > pageW[pages - 1]) {
+            if (pages == maxPages) return -1;
+            pageW[pages] = w > ATLAS_PAGE_SIZE ? w : ATLAS_PAGE_SIZE;
+            pageH[pages] = h > ATLAS_PAGE_SIZE ? h : ATLAS_PAGE_SIZE;
+            pages++;
+            shelfX = 0;
+            shelfY = 0;
+            shelfH = 0;
+        }
+
+        e->page = pages - 1;
+        e->x = shelfX;
+        e->y = shelfY;
+        shelfX += w;
+        if (h > shelfH) shelfH = h;
+    }
+    return pages;
+}
+
+static SDL_Texture *upload_page(SDL_Renderer *r, int page, int w, int h)
+{
+    Uint32 *pixels = (Uint32 *)calloc((size_t)w * (size_t)h, sizeof(Uint32));
+    if (!pixels) return NULL;
+
+    for (int i = 0; i < pending_count; i++) {
+        const AtlasEntry *e = &pending[i];
+        if (e->page != page) continue;
+
+        for (int l = 0; l < e->levels; l++) {
+            SDL_Surface *s = e->surf[l];
+            int ox, oy;
+            level_origin(e, l, &ox, &oy);
+
+            SDL_LockSurface(s);
+            for (int y = 0; y < s->h; y++) {
+                memcpy(pixels + (size_t)(oy + y) * (size_t)w + (size_t)ox,
+                       (const Uint8 *)s->pixels + (size_t)y * (size_t)s->pitch,
+                       (size_t)s->w * sizeof(Uint32));
+            }
+            SDL_UnlockSurface(s);
+        }
+    }
+
+    SDL_Texture *t = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+    if (t) {
+        SDL_UpdateTexture(t, NULL, pixels, w * (int)sizeof(Uint32));
+        SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND);
+    } else {
+        fprintf(stderr, "ATLAS: SDL_CreateTexture failed: %s\n", SDL_GetError());
+    }
+
+    free(pixels);
+    return t;
+}
+
+int atlas_build(SDL_Renderer *r)
+{
+    enum { MAX_PAGES = 8 };
+    int pageW[MAX_PAGES], pageH[MAX_PAGES];
+    int rc = 0;
+
+    trace_begin("atlas_build");
+    qsort(pending, (size_t)pending_count, sizeof pending[0], taller_first);
+
+    int pages = pack_entries(pageW, pageH, MAX_PAGES);
+    if (pages < 0) {
+        fprintf(stderr, "ATLAS: sprites do not fit in %d pages\n", MAX_PAGES);
+        pages = MAX_PAGES;
+        rc = -1;
+    }
+
+    for (int p = 0; p < pages; p++) {
+        SDL_Texture *t = upload_page(r, p, pageW[p], pageH[p]);
+        if (!t) rc = -1;
+
+        for (int i = 0; i < pending_count; i++) {
+            AtlasEntry *e = &pending[i];
+            if (e->page != p || !t) continue;
+            e->out->atlas = t;
+            e->out->levels = e->levels;
+            for (int l = 0; l < e->levels; l++) {
+                int ox, oy;
+                level_origin(e, l, &ox, &oy);
+                e->out->mip[l] = (SDL_Rect){ox, oy, e->surf[l]->w, e->surf[l]->h};
+            }
+            e->out->rect = e->out->mip[0];
+        }
+    }
+
+    for (int i = 0; i < pending_count; i++) {
+        for (int l = 0; l < pending[i].levels; l++)
+            SDL_FreeSurface(pending[i].surf[l]);
+    }
+    pending_count = 0;
+
+    trace_end("atlas_build");
+    return rc;
+}
+
+const SDL_Rect *atlas_level_rect(const SpriteHandle *h, int dst_w, int dst_h)
+{
+    if (h->levels <= 1 || dst_w <= 0 || dst_h <= 0)
+        return &h->rect;
+
+    /* The axis that is squeezed the most decides. */
+    float fx = (float)h->rect.w / (float)dst_w;
+    float fy = (float)h->rect.h / (float)dst_h;
+    return &h->mip[mip_level_for(fx > fy ? fx : fy, h->levels)];
+}
+
+void atlas_draw(SDL_Renderer *r, const SpriteHandle *h, const SDL_Rect *dst)
+{
+    if (!h || !h->atlas) return;
+    SDL_RenderCopy(r, h->atlas, atlas_level_rect(h, dst->w, dst->h), dst);
+    render_stats.draw_calls++;
+}
@@ -0,0 +1,45 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL2/SDL.h>
+
+#include "mipmap.h"
+
+/*
+ * Sprite atlas.
+ *
+ * Sprite, weapon and HUD images are packed at load time into a few large
+ * textures, so a whole frame of sprites can be drawn without switching
+ * textures. Black, the colour key of the BMP assets, becomes transparent.
+ *
+ * Every image is packed together with its mip chain on the same page, so
+ * small on-screen sprites can sample a reduced level without changing
+ * texture.
+ *
+ * Queue every image with atlas_add(), then call atlas_build() once; the
+ * handles are filled in by the build.
+ */
+typedef struct {
+    SDL_Texture *atlas; /* NULL if the image is missing */
+    SDL_Rect rect;      /* pixels of the image inside the atlas */
+    int levels;         /* mip levels in mip[]; mip[0] is rect */
+    SDL_Rect mip[MIP_MAX_LEVELS];
+} SpriteHandle;
+
+/* Queue surface s to be packed into *out. The atlas takes ownership of s. */
+void atlas_add(SpriteHandle *out, SDL_Surface *s);
+
+/* Pack everything queued since the last build into atlas pages.
+ * Returns 0 on success, -1 if a page could not be created (the handles on
+ * that page stay empty). */
+int atlas_build(SDL_Renderer *r);
+
+/* Atlas rect of the mip level to sample when the sprite is drawn dst_w x
+ * dst_h pixels. */
+const SDL_Rect *atlas_level_rect(const SpriteHandle *h, int dst_w, int dst_h);
+
+/* Copy the whole sprite to dst, from the mip level that fits its size. Does
+ * nothing for an empty handle. */
+void atlas_draw(SDL_Renderer *r, const SpriteHandle *h, const SDL_Rect *dst);
+
+#endif /* ATLAS_H */
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "audio.h"
+#include "trace.h"
 
 /*
  * SDL2-only audio mixer:
@@ -30,6 +31,8 @@ static int clampi(int v, int lo, int hi) { return (v < lo) ? lo : (v > hi) ? hi
 
 static SDL_AudioDeviceID g_dev = 0;
 static SDL_AudioSpec g_have;
+static TraceBuffer *g_trace_buffer = NULL;  /* the audio thread's, see audio_callback() */
+static int g_trace_adopted = 0;             /* the current device's thread uses it */
 
 static Sound g_bgm = {0};
 static Uint32 g_bgm_pos = 0;
@@ -65,7 +68,7 @@ static void sound_free(Sound *s)
     s->len = 0;
 }
 
-static int sound_load_converted(Sound *out, const char *file)
+static int sound_convert_file(Sound *out, const char *file)
 {
     if (!out || !file) return -1;
 
@@ -128,11 +131,27 @@ static int sound_load_converted(Sound *out, const char *file)
     return 0;
 }
 
+static int sound_load_converted(Sound *out, const char *file)
+{
+    trace_begin_detail("load_wav", file);
+    int rc = sound_convert_file(out, file);
+    trace_end("load_wav");
+    return rc;
+}
+
 static void audio_callback(void *userdata, Uint8 *stream, int len)
 {
     (void)userdata;
     if (!stream || len <= 0) return;
 
+    /* Runs on SDL's audio thread, which must not allocate: its trace ring
+     * was made by audio_init(). */
+    if (!g_trace_adopted) {
+        trace_use_buffer(g_trace_buffer);
+        g_trace_adopted = 1;
+    }
+    trace_begin("audio_mix");
+
     SDL_memset(stream, 0, (size_t)len);
 
     /* Effective volumes (master multiplies BGM/SFX). */
@@ -181,12 +200,15 @@ static void audio_callback(void *userdata, Uint8 *stream, int len)
             ch->active = 0;
         }
     }
+
+    trace_end("audio_mix");
 }
 
 int audio_init(void)
 {
     if (g_dev) return 0;
 
+    trace_begin("audio_init");
     SDL_AudioSpec want;
     SDL_zero(want);
     want.freq = 44100;
@@ -196,10 +218,15 @@ int audio_init(void)
     want.callback = audio_callback;
     want.userdata = NULL;
 
+    /* A reopened device gets a new thread, which takes over the ring of
+     * the old one (closing the device has ended that thread). */
+    if (!g_trace_buffer) g_trace_buffer = trace_reserve_buffer("audio");
+    g_trace_adopted = 0;
     SDL_zero(g_have);
     g_dev = SDL_OpenAudioDevice(NULL, 0, &want, &g_have, 0);
     if (!g_dev) {
         fprintf(stderr, "AUDIO: SDL_OpenAudioDevice failed: %s\n", SDL_GetError());
+        trace_end("audio_init");
         return -1;
     }
 
@@ -232,6 +259,7 @@ int audio_init(void)
     (void)sound_load_converted(&g_sfx[SFX_ENDING],     "ending.wav");
 
     SDL_PauseAudioDevice(g_dev, 0);
+    trace_end("audio_init");
     return 0;
 }
 
@@ -0,0 +1,871 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headless.h"
+#include "game.h"
+#include "render.h"
+#include "swrender.h"
+#include "raycast.h"
+#include "player.h"
+#include "enemy.h"
+#include "items.h"
+#include "map.h"
+#include "flowfield.h"
+#include "config.h"
+#include "input.h"
+
+/*
+ * Render benchmark (bench.exe).
+ *
+ * Loads map1..map9 in turn and flies the camera along a path generated from
+ * the map: a depth-first walk over the open tiles from the player spawn,
+ * visiting every reachable tile and stepping back along the same edges, so
+ * the camera never enters a wall. The camera moves at a fixed number of
+ * tiles per frame and sweeps its view left and right, and nothing is
+ * simulated, so every run draws the same frames. Each frame goes through the
+ * in-game pipeline (world, sprites, HUD) on the headless software renderer.
+ *
+ * Results are written as JSON to stdout or --out FILE:
+ *   bench [--frames N] [--maps FIRST-LAST] [--renderer sdl|software]
+ *         [--floor stretch|cast] [--threads N] [--out FILE]
+ *
+ * With --replay FILE the camera is the player of a recorded game instead
+ * (see input.h): the journal's level is loaded and every frame runs the
+ * next BENCH_REPLAY_STEPS steps of gameplay with its input, enemies and
+ * all, before drawing. Only drawing is timed. The run ends early if the
+ * journal does or the level is left; key events from it (menus) are
+ * dropped:
+ *   bench --replay FILE [--frames N] [--renderer ...] [--out FILE]
+ *
+ * With --enemies N it instead times update_enemies() on the first map with
+ * N enemies spread over the open tiles while the player follows the camera
+ * path, once with the scalar kernel and once with the SIMD one, and reports
+ * how far the two runs' enemy positions ended up apart. A third run with
+ * the SIMD kernel and AI level of detail off shows what the tiers save;
+ * the average number of enemies per tier is reported too:
+ *   bench --enemies 10000 [--frames N] [--maps FIRST] [--out FILE]
+ *
+ * With --flowfield SIZE it times flow field rebuilds (one per frame, from a
+ * different open tile each time) on the chosen maps and on a generated
+ * SIZE x SIZE map. A rebuild may take several updates (see flowfield.h);
+ * both its total time and its slowest update are reported, along with the
+ * tiles reachable from the source averaged over the rebuilds:
+ *   bench --flowfield 1024 [--frames N] [--maps FIRST-LAST] [--out FILE]
+ *
+ * With --mapload SIZE it times load_map() (read, parse and allocate; one
+ * load per frame) on the chosen maps and on a generated SIZE x SIZE map
+ * written out as a map file first:
+ *   bench --mapload 2048 [--frames N] [--maps FIRST-LAST] [--out FILE]
+ */
+
+#define BENCH_WARMUP_FRAMES 10
+#define BENCH_TILES_PER_FRAME 0.08f
+#define BENCH_REPLAY_STEPS 2    /* gameplay steps per frame, 60 fps */
+
+typedef struct {
+    int frames;
+    int first_map, last_map;
+    int renderer;     /* -1 = from config */
+    int floor_mode;   /* -1 = from config */
+    int threads;      /* -1 = from config */
+    int enemies;      /* > 0 = enemy update benchmark */
+    int flow_size;    /* > 0 = flow field benchmark */
+    int load_size;    /* > 0 = map loading benchmark */
+    const char *replay;  /* input journal to play, NULL = camera path */
+    const char *out;
+} BenchOptions;
+
+typedef struct {
+    int map;
+    int frames;
+    double p50, p95, p99, max, mean;   /* frame time, ms */
+    double draw_calls;                 /* per frame */
+    double rays_per_sec;
+} BenchResult;
+
+/* ------------------------------------------------------------
+ * Camera path
+ * ------------------------------------------------------------ */
+typedef struct {
+    float x, y;
+} Waypoint;
+
+static Waypoint *path = NULL;
+static int path_len = 0;
+
+static int tile_open(int x, int y)
+{
+    if (x < 0 || y < 0 || x >= worldWidth || y >= worldHeight) return 0;
+    return !map_is(x, y, TILE_SOLID);
+}
+
+/* Depth-first tour over open tiles from the spawn tile. Every move is
+ * between neighbouring open tiles, including the moves back up the tree. */
+static int build_path(void)
+{
+    static const int dx[4] = { 1, 0, -1, 0 };
+    static const int dy[4] = { 0, 1, 0, -1 };
+
+    free(path);
+    path = NULL;
+    path_len = 0;
+
+    size_t cells = (size_t)worldWidth * (size_t)worldHeight;
+    unsigned char *seen = (unsigned char *)calloc(cells, 1);
+    int *stack = (int *)malloc(cells * sizeof(int));
+    unsigned char *next_dir = (unsigned char *)calloc(cells, 1);
+    path = (Waypoint *)malloc(2 * cells * sizeof(Waypoint));
+    if (!seen || !stack || !next_dir || !path) {
+        free(seen);
+        free(stack);
+        free(next_dir);
+        free(path);
+        path = NULL;
+        return -1;
+    }
+
+    int sx = (int)player_spawn_x, sy = (int)player_spawn_y;
+    int top = 0;
+    if (tile_open(sx, sy)) {
+        stack[top++] = sy * worldWidth + sx;
+        seen[sy * worldWidth + sx] = 1;
+        path[path_len++] = (Waypoint){ sx + 0.5f, sy + 0.5f };
+    }
+
+    while (top > 0) {
+        int cur = stack[top - 1];
+        int cx = cur % worldWidth, cy = cur / worldWidth;
+
+        int moved = 0;
+        while (next_dir[cur] < 4) {
+            int d = next_dir[cur]++;
+            int nx = cx + dx[d], ny = cy + dy[d];
+            if (!tile_open(nx, ny) || seen[ny * worldWidth + nx]) continue;
+
+            seen[ny * worldWidth + nx] = 1;
+            stack[top++] = ny * worldWidth + nx;
+            path[path_len++] = (Waypoint){ nx + 0.5f, ny + 0.5f };
+            moved = 1;
+            break;
+        }
+
+        if (!moved) {
+            top--;
+            if (top > 0) {
+                int p = stack[top - 1];
+                path[path_len++] = (Waypoint){ p % worldWidth + 0.5f, p / worldWidth + 0.5f };
+            }
+        }
+    }
+
+    free(seen);
+    free(stack);
+    free(next_dir);
+    return 0;
+}
+
+/* Camera pose for frame f. With fewer than two waypoints the camera turns
+ * in place at the spawn point. */
+static void camera_at(int f)
+{
+    float sweep = 0.6f * sinf((float)f * 0.05f);
+
+    if (path_len < 2) {
+        px = player_spawn_x;
+        py = player_spawn_y;
+        angle = (float)f * 0.02f;
+        return;
+    }
+
+    float s = (float)f * BENCH_TILES_PER_FRAME;
+    int seg = (int)s % (path_len - 1);
+    float t = s - floorf(s);
+    const Waypoint *a = &path[seg];
+    const Waypoint *b = &path[seg + 1];
+
+    px = a->x + (b->x - a->x) * t;
+    py = a->y + (b->y - a->y) * t;
+    angle = atan2f(b->y - a->y, b->x - a->x) + sweep;
+}
+
+/* ------------------------------------------------------------
+ * Measurement
+ * ------------------------------------------------------------ */
+static int cmp_double(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/* Nearest-rank percentile of a sorted array. */
+static double percentile(const double *sorted, int n, double p)
+{
+    int rank = (int)ceil(p / 100.0 * (double)n);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static void summarize(BenchResult *res, double *ms, int n, Uint32 draw_calls,
+                      Uint32 rays, Uint64 world_ticks)
+{
+    double total = 0.0;
+    for (int i = 0; i < n; i++) total += ms[i];
+    qsort(ms, (size_t)n, sizeof ms[0], cmp_double);
+
+    res->frames = n;
+    res->p50 = percentile(ms, n, 50.0);
+    res->p95 = percentile(ms, n, 95.0);
+    res->p99 = percentile(ms, n, 99.0);
+    res->max = ms[n - 1];
+    res->mean = total / n;
+    res->draw_calls = (double)draw_calls / n;
+
+    double world_sec = (double)world_ticks / (double)SDL_GetPerformanceFrequency();
+    res->rays_per_sec = world_sec > 0.0 ? (double)rays / world_sec : 0.0;
+}
+
+/* Move on to frame f: along the camera path, or the next steps of the
+ * replay. Returns 0 when the replay has nothing more to show. */
+static int advance_frame(const BenchOptions *opt, int f)
+{
+    if (!opt->replay) {
+        camera_at(f);
+        return 1;
+    }
+
+    SDL_Event e;
+    while (input_next_event(&e)) {
+    }
+    for (int s = 0; s < BENCH_REPLAY_STEPS; s++) {
+        if (input_replay_done() || !game_step()) return 0;
+    }
+    return 1;
+}
+
+static void render_frame(SDL_Renderer *r)
+{
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 255);
+    SDL_RenderClear(r);
+    game_render_playing(r);
+    SDL_RenderPresent(r);
+}
+
+/* Run one map. all_ms collects every frame time for the overall summary. */
+static int bench_map(SDL_Renderer *r, const BenchOptions *opt, int map, BenchResult *res,
+                     double *all_ms, int *all_n, RenderStats *all_stats)
+{
+    if (opt->replay) {
+        map = game_start_replay(opt->replay);
+        if (map < 0) {
+            fprintf(stderr, "BENCH: cannot replay %s\n", opt->replay);
+            return -1;
+        }
+    } else {
+        free_map();
+        if (load_map(map) != 0) {
+            fprintf(stderr, "BENCH: cannot load map %d\n", map);
+            return -1;
+        }
+        init_player();
+        init_enemies();
+        init_items();
+        if (build_path() != 0) {
+            fprintf(stderr, "BENCH: out of memory\n");
+            return -1;
+        }
+    }
+
+    for (int f = 0; f < BENCH_WARMUP_FRAMES && advance_frame(opt, f); f++)
+        render_frame(r);
+
+    double *ms = (double *)malloc((size_t)opt->frames * sizeof(double));
+    if (!ms) {
+        input_stop();
+        return -1;
+    }
+
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    render_stats_reset();
+    int n = 0;
+    for (; n < opt->frames && advance_frame(opt, n); n++) {
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        render_frame(r);
+        ms[n] = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+    }
+    input_stop();
+    if (n == 0) {
+        fprintf(stderr, "BENCH: the replay ended before the first frame\n");
+        free(ms);
+        return -1;
+    }
+
+    memcpy(all_ms + *all_n, ms, (size_t)n * sizeof(double));
+    *all_n += n;
+    all_stats->draw_calls += render_stats.draw_calls;
+    all_stats->rays += render_stats.rays;
+    all_stats->world_ticks += render_stats.world_ticks;
+
+    res->map = map;
+    summarize(res, ms, n, render_stats.draw_calls, render_stats.rays,
+              render_stats.world_ticks);
+    free(ms);
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Enemy update benchmark
+ * ------------------------------------------------------------ */
+#define BENCH_ENEMY_DT (1.0f / 60.0f)
+#define BENCH_KILL_EVERY 32     /* frames between kills */
+#define BENCH_KILL_STRIDE 256   /* one enemy in this many is killed */
+
+typedef struct {
+    BenchResult timing;         /* per update_enemies() call */
+    double tiers[ENEMY_LOD_COUNT]; /* average enemies per tier */
+    int count;                  /* enemies left at the end */
+    float *x, *y;               /* their positions */
+} EnemyRun;
+
+/* N enemies of all kinds jittered around the path's tiles. Returns -1 if
+ * the pool cannot grow that far. */
+static int spawn_bench_enemies(int n)
+{
+    Uint32 seed = 12345u;
+
+    enemies_clear();
+    for (int i = 0; i < n; i++) {
+        const Waypoint *w = &path[i % path_len];
+        seed = seed * 1664525u + 1013904223u;
+        float jx = ((float)((seed >> 8) & 0xFF) / 255.0f - 0.5f) * 0.6f;
+        float jy = ((float)((seed >> 16) & 0xFF) / 255.0f - 0.5f) * 0.6f;
+        if (enemy_spawn((EnemyKind)(i % 4), w->x + jx, w->y + jy) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int run_enemy_updates(const BenchOptions *opt, EnemyRun *run)
+{
+    if (spawn_bench_enemies(opt->enemies) != 0) return -1;
+    init_player();
+    godmode_enabled = 1;
+
+    double *ms = (double *)malloc((size_t)opt->frames * sizeof(double));
+    if (!ms) return -1;
+
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    for (int f = 0; f < opt->frames; f++) {
+        camera_at(f);
+        /* Kill a few so the dying countdown and removals are timed too. */
+        if (f % BENCH_KILL_EVERY == 0) {
+            for (int i = f / BENCH_KILL_EVERY % BENCH_KILL_STRIDE; i < enemies.count; i += BENCH_KILL_STRIDE)
+                damage_enemy(i, 1000);
+        }
+
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        update_enemies(BENCH_ENEMY_DT);
+        ms[f] = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+
+        int tiers[ENEMY_LOD_COUNT];
+        enemy_lod_counts(tiers);
+        for (int t = 0; t < ENEMY_LOD_COUNT; t++)
+            run->tiers[t] += (double)tiers[t] / (double)opt->frames;
+    }
+    summarize(&run->timing, ms, opt->frames, 0, 0, 0);
+    free(ms);
+
+    run->count = enemies.count;
+    run->x = (float *)malloc((size_t)(enemies.count + 1) * sizeof(float));
+    run->y = (float *)malloc((size_t)(enemies.count + 1) * sizeof(float));
+    if (!run->x || !run->y) return -1;
+    memcpy(run->x, enemies.x, (size_t)enemies.count * sizeof(float));
+    memcpy(run->y, enemies.y, (size_t)enemies.count * sizeof(float));
+    return 0;
+}
+
+static void write_enemy_timing(FILE *out, const char *name, const EnemyRun *run)
+{
+    const BenchResult *r = &run->timing;
+    fprintf(out, "  \"%s\": {\"frames\": %d, \"enemies_left\": %d, "
+                 "\"tiers\": {\"near\": %.1f, \"mid\": %.1f, \"far\": %.1f}, "
+                 "\"update_ms\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f}},\n",
+            name, r->frames, run->count,
+            run->tiers[ENEMY_LOD_NEAR], run->tiers[ENEMY_LOD_MID], run->tiers[ENEMY_LOD_FAR],
+            r->p50, r->p95, r->p99, r->max, r->mean);
+}
+
+static int write_enemy_json(const BenchOptions *opt, const EnemyRun *scalar, const EnemyRun *simd,
+                            const EnemyRun *full)
+{
+    /* Both runs start from the same pool and kill the same enemies, so the
+     * survivors line up index by index. */
+    double max_diff = (scalar->count == simd->count) ? 0.0 : -1.0;
+    for (int i = 0; max_diff >= 0.0 && i < scalar->count; i++) {
+        double d = fmax(fabs((double)scalar->x[i] - simd->x[i]), fabs((double)scalar->y[i] - simd->y[i]));
+        if (d > max_diff) max_diff = d;
+    }
+
+    FILE *out = opt->out ? fopen(opt->out, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "BENCH: cannot write %s\n", opt->out);
+        return -1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"suite\": \"enemies\",\n");
+    fprintf(out, "  \"map\": %d,\n", opt->first_map);
+    fprintf(out, "  \"enemies\": %d,\n", opt->enemies);
+    fprintf(out, "  \"kernel\": \"%s\",\n", enemy_kernel_name());
+    write_enemy_timing(out, "scalar", scalar);
+    write_enemy_timing(out, "simd", simd);
+    write_enemy_timing(out, "simd_no_lod", full);
+    fprintf(out, "  \"speedup\": %.2f,\n",
+            simd->timing.mean > 0.0 ? scalar->timing.mean / simd->timing.mean : 0.0);
+    fprintf(out, "  \"lod_speedup\": %.2f,\n",
+            simd->timing.mean > 0.0 ? full->timing.mean / simd->timing.mean : 0.0);
+    fprintf(out, "  \"max_position_diff\": %g\n", max_diff);
+    fprintf(out, "}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+static int bench_enemies(const BenchOptions *opt)
+{
+    free_map();
+    if (load_map(opt->first_map) != 0) {
+        fprintf(stderr, "BENCH: cannot load map %d\n", opt->first_map);
+        return -1;
+    }
+    init_player();
+    init_items();
+    if (build_path() != 0 || path_len < 1) {
+        fprintf(stderr, "BENCH: no open tiles on map %d\n", opt->first_map);
+        return -1;
+    }
+
+    EnemyRun scalar = {0}, simd = {0}, full = {0};
+    enemies_set_simd(0);
+    int rc = run_enemy_updates(opt, &scalar);
+    enemies_set_simd(1);
+    if (rc == 0) rc = run_enemy_updates(opt, &simd);
+    enemies_set_lod(0);
+    if (rc == 0) rc = run_enemy_updates(opt, &full);
+    enemies_set_lod(config_get_ai_lod());
+
+    if (rc != 0)
+        fprintf(stderr, "BENCH: out of memory\n");
+    else
+        rc = write_enemy_json(opt, &scalar, &simd, &full);
+
+    free(scalar.x);
+    free(scalar.y);
+    free(simd.x);
+    free(simd.y);
+    free(full.x);
+    free(full.y);
+    return rc;
+}
+
+/* ------------------------------------------------------------
+ * Flow field benchmark
+ * ------------------------------------------------------------ */
+#define BENCH_FLOW_WALLS 20     /* percent of generated tiles that are walls */
+
+typedef struct {
+    int map;                    /* 0 = generated */
+    int w, h;
+    double reachable;           /* tiles with a path to the source, per rebuild */
+    double updates;             /* flowfield_update() calls per rebuild */
+    BenchResult timing;         /* all the updates of a rebuild */
+    BenchResult stall;          /* the slowest update of a rebuild */
+} FlowResult;
+
+static Uint32 bench_rand(Uint32 *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+/* Replace the map with a size x size grid: a solid border and walls
+ * scattered over the inside. */
+static int generate_map(int size)
+{
+    if (map_create(size, size) != 0) return -1;
+
+    Uint32 seed = 777u;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int edge = (x == 0 || y == 0 || x == size - 1 || y == size - 1);
+            if (edge || bench_rand(&seed) % 100 < BENCH_FLOW_WALLS) map_set_tile(x, y, 2);
+        }
+    }
+    map_set_tile(1, 1, 0);
+    player_spawn_x = 1.5f;
+    player_spawn_y = 1.5f;
+    return 0;
+}
+
+/* Rebuild the field from a different open tile every frame, calling
+ * flowfield_update() until the rebuild is done as the game would once per
+ * update. */
+static int time_rebuilds(const BenchOptions *opt, int map, FlowResult *res)
+{
+    double *ms = (double *)malloc((size_t)opt->frames * sizeof(double));
+    double *worst = (double *)malloc((size_t)opt->frames * sizeof(double));
+    if (!ms || !worst) {
+        free(ms);
+        free(worst);
+        return -1;
+    }
+
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    Uint32 seed = 4242u;
+    int sx = (int)player_spawn_x, sy = (int)player_spawn_y;
+    long long reachable = 0, updates = 0;
+    int rc = 0;
+
+    /* The first field is built in one go; start from one. */
+    flowfield_update(sx + 0.5f, sy + 0.5f);
+    for (int f = 0; f < opt->frames && rc == 0; f++) {
+        /* Look for another open tile; keep the last one if none turns up. */
+        for (int tries = 0; tries < 64; tries++) {
+            int x = (int)(bench_rand(&seed) % (Uint32)worldWidth);
+            int y = (int)(bench_rand(&seed) % (Uint32)worldHeight);
+            if (!map_is(x, y, TILE_SOLID) && (x != sx || y != sy)) {
+                sx = x;
+                sy = y;
+                break;
+            }
+        }
+
+        ms[f] = 0.0;
+        worst[f] = 0.0;
+        do {
+            Uint64 t0 = SDL_GetPerformanceCounter();
+            rc = flowfield_update(sx + 0.5f, sy + 0.5f);
+            double t = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+            ms[f] += t;
+            if (t > worst[f]) worst[f] = t;
+            updates++;
+        } while (rc == 0 && flowfield_rebuilding());
+
+        for (int y = 0; y < worldHeight; y++)
+            for (int x = 0; x < worldWidth; x++)
+                reachable += flowfield_distance(x, y) >= 0;
+    }
+
+    if (rc == 0) {
+        res->map = map;
+        res->w = worldWidth;
+        res->h = worldHeight;
+        res->reachable = (double)reachable / opt->frames;
+        res->updates = (double)updates / opt->frames;
+        summarize(&res->timing, ms, opt->frames, 0, 0, 0);
+        summarize(&res->stall, worst, opt->frames, 0, 0, 0);
+    }
+    free(ms);
+    free(worst);
+    return rc;
+}
+
+static int bench_flowfield(const BenchOptions *opt)
+{
+    FlowResult results[10];
+    int done = 0;
+
+    for (int m = opt->first_map; m <= opt->last_map; m++) {
+        free_map();
+        if (load_map(m) != 0) {
+            fprintf(stderr, "BENCH: cannot load map %d\n", m);
+            continue;
+        }
+        if (time_rebuilds(opt, m, &results[done]) == 0) done++;
+    }
+    if (generate_map(opt->flow_size) != 0 || time_rebuilds(opt, 0, &results[done]) != 0)
+        fprintf(stderr, "BENCH: out of memory for a %dx%d map\n", opt->flow_size, opt->flow_size);
+    else
+        done++;
+    free_map();
+    if (done == 0) return -1;
+
+    FILE *out = opt->out ? fopen(opt->out, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "BENCH: cannot write %s\n", opt->out);
+        return -1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"suite\": \"flowfield\",\n");
+    fprintf(out, "  \"budget\": %d,\n", FLOW_DEFAULT_BUDGET);
+    fprintf(out, "  \"maps\": [\n");
+    for (int i = 0; i < done; i++) {
+        const FlowResult *r = &results[i];
+        const BenchResult *t = &r->timing;
+        const BenchResult *s = &r->stall;
+        if (r->map) fprintf(out, "    {\"map\": %d, ", r->map);
+        else fprintf(out, "    {\"map\": \"generated\", ");
+        fprintf(out, "\"size\": [%d, %d], \"reachable\": %.1f, \"rebuilds\": %d, \"updates_per_rebuild\": %.1f, "
+                     "\"rebuild_ms\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f}, "
+                     "\"worst_update_ms\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f}}%s\n",
+                r->w, r->h, r->reachable, t->frames, r->updates,
+                t->p50, t->p95, t->p99, t->max, t->mean,
+                s->p50, s->p95, s->p99, s->max, s->mean,
+                i + 1 < done ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Map loading benchmark
+ * ------------------------------------------------------------ */
+#define BENCH_LOAD_FILE "bench_mapload.txt"
+
+typedef struct {
+    int map;                    /* 0 = generated */
+    int w, h;
+    BenchResult timing;         /* per load */
+} LoadResult;
+
+/* Write a generated size x size map (generate_map()) to path as a map file,
+ * spawn in the corner. */
+static int write_generated_map(const char *path, int size)
+{
+    if (generate_map(size) != 0) return -1;
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        free_map();
+        return -1;
+    }
+    for (int y = 0; y < worldHeight; y++) {
+        for (int x = 0; x < worldWidth; x++) {
+            int t = (x == 1 && y == 1) ? 8 : map_tile(x, y);
+            fprintf(fp, x + 1 < worldWidth ? "%d " : "%d\n", t);
+        }
+    }
+    free_map();
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* Load level map (or the file at path, if not NULL) once per frame. */
+static int time_loads(const BenchOptions *opt, int map, const char *path, LoadResult *res)
+{
+    double *ms = (double *)malloc((size_t)opt->frames * sizeof(double));
+    if (!ms) return -1;
+
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    for (int f = 0; f < opt->frames; f++) {
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        int rc = path ? load_map_path(path, 1) : load_map(map);
+        ms[f] = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+        if (rc != 0) {
+            free(ms);
+            return -1;
+        }
+    }
+
+    res->map = map;
+    res->w = worldWidth;
+    res->h = worldHeight;
+    summarize(&res->timing, ms, opt->frames, 0, 0, 0);
+    free(ms);
+    free_map();
+    return 0;
+}
+
+static int bench_mapload(const BenchOptions *opt)
+{
+    LoadResult results[10];
+    int done = 0;
+
+    for (int m = opt->first_map; m <= opt->last_map; m++) {
+        if (time_loads(opt, m, NULL, &results[done]) == 0) done++;
+        else fprintf(stderr, "BENCH: cannot load map %d\n", m);
+    }
+    if (write_generated_map(BENCH_LOAD_FILE, opt->load_size) != 0 ||
+        time_loads(opt, 0, BENCH_LOAD_FILE, &results[done]) != 0)
+        fprintf(stderr, "BENCH: cannot load a generated %dx%d map\n", opt->load_size, opt->load_size);
+    else
+        done++;
+    remove(BENCH_LOAD_FILE);
+    if (done == 0) return -1;
+
+    FILE *out = opt->out ? fopen(opt->out, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "BENCH: cannot write %s\n", opt->out);
+        return -1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"suite\": \"mapload\",\n");
+    fprintf(out, "  \"maps\": [\n");
+    for (int i = 0; i < done; i++) {
+        const LoadResult *r = &results[i];
+        const BenchResult *t = &r->timing;
+        double tiles_per_sec = t->mean > 0.0 ? (double)r->w * r->h * 1000.0 / t->mean : 0.0;
+        if (r->map) fprintf(out, "    {\"map\": %d, ", r->map);
+        else fprintf(out, "    {\"map\": \"generated\", ");
+        fprintf(out, "\"size\": [%d, %d], \"loads\": %d, "
+                     "\"load_ms\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f}, "
+                     "\"tiles_per_sec\": %.0f}%s\n",
+                r->w, r->h, t->frames, t->p50, t->p95, t->p99, t->max, t->mean, tiles_per_sec,
+                i + 1 < done ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Output
+ * ------------------------------------------------------------ */
+static void write_result(FILE *out, const BenchResult *r)
+{
+    fprintf(out,
+            "\"frames\": %d, "
+            "\"frame_ms\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f}, "
+            "\"draw_calls_per_frame\": %.1f, \"rays_per_sec\": %.0f",
+            r->frames, r->p50, r->p95, r->p99, r->max, r->mean,
+            r->draw_calls, r->rays_per_sec);
+}
+
+static void write_json(FILE *out, const BenchResult *maps, int n, const BenchResult *total)
+{
+    int sw = (render_get_path() == RENDER_PATH_SOFTWARE);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"renderer\": \"%s\",\n", sw ? "software" : "sdl");
+    fprintf(out, "  \"floor\": \"%s\",\n", swr_get_floor_mode() == SWR_FLOOR_CAST ? "cast" : "stretch");
+    fprintf(out, "  \"threads\": %d,\n", sw ? swr_get_thread_count() : 1);
+    fprintf(out, "  \"ray_kernel\": \"%s\",\n", raycast_kernel_name());
+    fprintf(out, "  \"resolution\": [%d, %d],\n", W, H);
+    fprintf(out, "  \"maps\": [\n");
+    for (int i = 0; i < n; i++) {
+        fprintf(out, "    {\"map\": %d, ", maps[i].map);
+        write_result(out, &maps[i]);
+        fprintf(out, "}%s\n", i + 1 < n ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+    fprintf(out, "  \"total\": {");
+    write_result(out, total);
+    fprintf(out, "}\n}\n");
+}
+
+static void parse_args(int argc, char *argv[], BenchOptions *opt)
+{
+    opt->frames = 600;
+    opt->first_map = 1;
+    opt->last_map = 9;
+    opt->renderer = -1;
+    opt->floor_mode = -1;
+    opt->threads = -1;
+    opt->enemies = 0;
+    opt->flow_size = 0;
+    opt->load_size = 0;
+    opt->replay = NULL;
+    opt->out = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!next) break;
+
+        if (strcmp(a, "--frames") == 0) {
+            opt->frames = atoi(next);
+        } else if (strcmp(a, "--maps") == 0) {
+            if (sscanf(next, "%d-%d", &opt->first_map, &opt->last_map) == 1)
+                opt->last_map = opt->first_map;
+        } else if (strcmp(a, "--renderer") == 0) {
+            opt->renderer = (strcmp(next, "software") == 0) ? RENDER_PATH_SOFTWARE : RENDER_PATH_SDL;
+        } else if (strcmp(a, "--floor") == 0) {
+            opt->floor_mode = (strcmp(next, "stretch") == 0) ? SWR_FLOOR_STRETCH : SWR_FLOOR_CAST;
+        } else if (strcmp(a, "--threads") == 0) {
+            opt->threads = atoi(next);
+        } else if (strcmp(a, "--enemies") == 0) {
+            opt->enemies = atoi(next);
+        } else if (strcmp(a, "--flowfield") == 0) {
+            opt->flow_size = atoi(next);
+        } else if (strcmp(a, "--mapload") == 0) {
+            opt->load_size = atoi(next);
+        } else if (strcmp(a, "--replay") == 0) {
+            opt->replay = next;
+        } else if (strcmp(a, "--out") == 0) {
+            opt->out = next;
+        } else {
+            continue;
+        }
+        i++;
+    }
+
+    if (opt->frames < 1) opt->frames = 1;
+    if (opt->first_map < 1) opt->first_map = 1;
+    if (opt->last_map > 9) opt->last_map = 9;
+    if (opt->last_map < opt->first_map) opt->last_map = opt->first_map;
+    /* A journal plays on its own level, once. */
+    if (opt->replay) opt->last_map = opt->first_map;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions opt;
+    parse_args(argc, argv, &opt);
+
+    HeadlessTarget target;
+    if (headless_open(&target) != 0)
+        return 1;
+
+    if (opt.renderer >= 0) render_set_path((RenderPath)opt.renderer);
+    if (opt.floor_mode >= 0) swr_set_floor_mode((SwrFloorMode)opt.floor_mode);
+    if (opt.threads >= 0) swr_set_thread_count(opt.threads);
+
+    if (opt.enemies > 0 || opt.flow_size > 0 || opt.load_size > 0) {
+        int rc = opt.enemies > 0 ? bench_enemies(&opt)
+               : opt.flow_size > 0 ? bench_flowfield(&opt)
+               : bench_mapload(&opt);
+        rc = (rc == 0) ? 0 : 1;
+        free(path);
+        headless_close(&target);
+        return rc;
+    }
+
+    int maps = opt.last_map - opt.first_map + 1;
+    BenchResult results[9];
+    BenchResult total;
+    RenderStats all_stats;
+    memset(&all_stats, 0, sizeof all_stats);
+
+    double *all_ms = (double *)malloc((size_t)maps * (size_t)opt.frames * sizeof(double));
+    if (!all_ms) {
+        headless_close(&target);
+        return 1;
+    }
+
+    int done = 0, all_n = 0;
+    for (int m = opt.first_map; m <= opt.last_map; m++) {
+        if (bench_map(target.renderer, &opt, m, &results[done], all_ms, &all_n, &all_stats) == 0)
+            done++;
+    }
+
+    int rc = 1;
+    if (done > 0) {
+        summarize(&total, all_ms, all_n, all_stats.draw_calls, all_stats.rays,
+                  all_stats.world_ticks);
+        total.map = 0;
+
+        FILE *out = opt.out ? fopen(opt.out, "w") : stdout;
+        if (out) {
+            write_json(out, results, done, &total);
+            if (out != stdout) fclose(out);
+            rc = 0;
+        } else {
+            fprintf(stderr, "BENCH: cannot write %s\n", opt.out);
+        }
+    }
+
+    free(all_ms);
+    free(path);
+    headless_close(&target);
+    return rc;
+}
@@ -0,0 +1,207 @@
+#include <math.h>
+#include <string.h>
+
+#include "boss.h"
+#include "enemy.h"
+#include "player.h"
+#include "map.h"
+#include "flowfield.h"
+#include "pathfind.h"
+
+/* Bosses tracked at once; any beyond this just chase. */
+#define BOSS_SLOTS 8
+
+#define BOSS_REPLAN 1.0f            /* seconds between tactic choices */
+#define BOSS_ENGAGE_DIST 2.5f       /* closer than this, attack directly */
+#define BOSS_FLANK_TILES 2.0f       /* how far beside the player to flank */
+#define BOSS_RETREAT_TILES 4        /* how far a retreat may go */
+#define BOSS_RETREAT_TIME 3.0f      /* seconds a retreat lasts */
+#define BOSS_RETREAT_COOLDOWN 10.0f
+#define BOSS_WAYPOINT_REACH 0.1f    /* close enough to a path point */
+
+typedef enum {
+    TACTIC_CHASE = 0,
+    TACTIC_FLANK,
+    TACTIC_RETREAT
+} BossTactic;
+
+typedef struct {
+    EnemyHandle who;            /* 0 = free */
+    BossTactic tactic;
+    float replan;               /* seconds until the next choice */
+    float retreat_cooldown;
+    int goal_x, goal_y;         /* target tile */
+
+    int has_path;
+    Uint32 revision;            /* map_revision the path was found on */
+    int next;                   /* point being walked to */
+    int count;
+    PathPoint points[PATH_MAX_POINTS];
+} BossNav;
+
+static BossNav nav[BOSS_SLOTS];
+
+void boss_reset(void)
+{
+    memset(nav, 0, sizeof nav);
+}
+
+/* The boss's slot, claiming a free one (or one whose boss is gone) on
+ * first use. NULL if all are taken. */
+static BossNav *nav_for(EnemyHandle h)
+{
+    BossNav *unused = NULL;
+    for (int i = 0; i < BOSS_SLOTS; i++) {
+        if (nav[i].who == h) return &nav[i];
+        if (!unused && (nav[i].who == 0 || enemy_lookup(nav[i].who) < 0))
+            unused = &nav[i];
+    }
+    if (unused) {
+        memset(unused, 0, sizeof *unused);
+        unused->who = h;
+    }
+    return unused;
+}
+
+/* Nearby tile the player needs the most steps to reach, if it is further
+ * from the player than the boss's own tile. */
+static int find_retreat(int bx, int by, int *gx, int *gy)
+{
+    int best = flowfield_distance(bx, by);
+    if (best < 0) return 0;
+
+    int found = 0;
+    for (int y = by - BOSS_RETREAT_TILES; y <= by + BOSS_RETREAT_TILES; y++) {
+        for (int x = bx - BOSS_RETREAT_TILES; x <= bx + BOSS_RETREAT_TILES; x++) {
+            int d = flowfield_distance(x, y);
+            if (d > best) {
+                best = d;
+                *gx = x;
+                *gy = y;
+                found = 1;
+            }
+        }
+    }
+    return found;
+}
+
+/* Open tile beside the player on the boss's side (else the other side,
+ * else behind the player) that can be reached. */
+static int find_flank(float ex, float ey, int *gx, int *gy)
+{
+    float fx = cosf(angle), fy = sinf(angle);
+    float sx = -fy * BOSS_FLANK_TILES, sy = fx * BOSS_FLANK_TILES;
+    if ((ex - px) * sx + (ey - py) * sy < 0.0f) {
+        sx = -sx;
+        sy = -sy;
+    }
+
+    const float cand[3][2] = {
+        { px + sx, py + sy },
+        { px - sx, py - sy },
+        { px - fx * BOSS_FLANK_TILES, py - fy * BOSS_FLANK_TILES },
+    };
+    for (int k = 0; k < 3; k++) {
+        int x = (int)floorf(cand[k][0]), y = (int)floorf(cand[k][1]);
+        if (x == (int)ex && y == (int)ey) continue;
+        if (flowfield_distance(x, y) < 0) continue;
+        *gx = x;
+        *gy = y;
+        return 1;
+    }
+    return 0;
+}
+
+static void choose_tactic(BossNav *b, int i)
+{
+    float ex = enemies.x[i], ey = enemies.y[i];
+    float dx = px - ex, dy = py - ey;
+    float dist = sqrtf(dx * dx + dy * dy);
+    int hurt = enemies.hp[i] * 3 <= enemy_max_hp((EnemyKind)enemies.kind[i]);
+    int gx, gy;
+
+    BossTactic tactic = TACTIC_CHASE;
+    b->replan = BOSS_REPLAN;
+    if (hurt && b->retreat_cooldown <= 0.0f && dist < (float)BOSS_RETREAT_TILES &&
+        find_retreat((int)ex, (int)ey, &gx, &gy)) {
+        tactic = TACTIC_RETREAT;
+        b->replan = BOSS_RETREAT_TIME;
+        b->retreat_cooldown = BOSS_RETREAT_COOLDOWN;
+    } else if (dist > BOSS_ENGAGE_DIST && find_flank(ex, ey, &gx, &gy)) {
+        tactic = TACTIC_FLANK;
+    }
+
+    /* Keep walking the current path if the target did not move. */
+    if (tactic == TACTIC_CHASE || tactic != b->tactic || gx != b->goal_x || gy != b->goal_y ||
+        b->revision != map_revision)
+        b->has_path = 0;
+    b->tactic = tactic;
+    if (tactic != TACTIC_CHASE) {
+        b->goal_x = gx;
+        b->goal_y = gy;
+    }
+}
+
+void boss_aim(int i, float dt, float *ax, float *ay)
+{
+    float ex = enemies.x[i], ey = enemies.y[i];
+
+    BossNav *b = nav_for(enemies.handle[i]);
+    if (!b) {
+        flowfield_aim(ex, ey, px, py, ax, ay);
+        return;
+    }
+
+    b->replan -= dt;
+    b->retreat_cooldown -= dt;
+    if (b->replan <= 0.0f || (b->has_path && b->revision != map_revision))
+        choose_tactic(b, i);
+
+    if (b->tactic != TACTIC_CHASE && !b->has_path) {
+        const PathPoint *points;
+        int count;
+        PathStatus st = pathfind_query((int)ex, (int)ey, b->goal_x, b->goal_y, &points, &count);
+        if (st == PATH_FOUND && count > 0) {
+            memcpy(b->points, points, (size_t)count * sizeof *points);
+            b->count = count;
+            /* The first point is the boss's own tile. Every line of the
+             * path runs through open 2x2 blocks, so heading straight for
+             * the next point from anywhere in that tile is clear. */
+            b->next = count > 1 ? 1 : 0;
+            b->has_path = 1;
+            b->revision = map_revision;
+        } else if (st == PATH_NO_PATH) {
+            b->tactic = TACTIC_CHASE;
+        }
+    }
+
+    if (b->tactic == TACTIC_CHASE || !b->has_path) {
+        flowfield_aim(ex, ey, px, py, ax, ay);
+        return;
+    }
+
+    while (b->next < b->count &&
+           fabsf(b->points[b->next].x + 0.5f - ex) <= BOSS_WAYPOINT_REACH &&
+           fabsf(b->points[b->next].y + 0.5f - ey) <= BOSS_WAYPOINT_REACH)
+        b->next++;
+
+    if (b->next < b->count) {
+        *ax = b->points[b->next].x + 0.5f;
+        *ay = b->points[b->next].y + 0.5f;
+        return;
+    }
+
+    const PathPoint *last = &b->points[b->count - 1];
+    if (last->x != b->goal_x || last->y != b->goal_y) {
+        /* A cut-short path: ask for the rest next update. */
+        b->has_path = 0;
+    } else if (b->tactic == TACTIC_FLANK) {
+        b->tactic = TACTIC_CHASE;
+        flowfield_aim(ex, ey, px, py, ax, ay);
+        return;
+    }
+
+    /* At a retreat spot, wait there until the next choice. */
+    *ax = ex;
+    *ay = ey;
+}
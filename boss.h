@@ -0,0 +1,26 @@
+#ifndef BOSS_H
+#define BOSS_H
+
+/*
+ * Boss tactics.
+ *
+ * Minibosses and final bosses do not just run at the player. About once a
+ * second each one picks a tactic and walks to its target along a path
+ * from the path service (pathfind.h):
+ *   - retreat: when down to a third of its health and close to the
+ *     player, to the nearby tile furthest from the player (at most once
+ *     every few seconds);
+ *   - flank: when further off, to a tile beside the player, so it comes
+ *     in from the side rather than head-on;
+ *   - chase: otherwise, after reaching a flanking tile, or while a path is
+ *     still being searched for, the flow field like every other enemy.
+ */
+
+/* Forget every boss (the enemy pool was cleared). */
+void boss_reset(void);
+
+/* Point the ALIVE boss at index i should walk towards this update. A
+ * point equal to the boss's own position means it holds still. */
+void boss_aim(int i, float dt, float *ax, float *ay);
+
+#endif /* BOSS_H */
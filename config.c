@@ -159,6 +159,18 @@ void config_set_defaults(GameConfig *cfg)
     cfg->sfx_enabled = 1;
     cfg->sfx_volume = 128;
 
+    cfg->software_renderer = 0;
+    cfg->floor_casting = 1;
+    cfg->render_threads = 0;
+
+    cfg->target_fps = 0;
+    cfg->vsync = 1;
+
+    cfg->ai_lod = 1;
+    cfg->ai_near_tiles = 8;
+    cfg->ai_far_tiles = 20;
+    cfg->ai_mid_interval = 4;
+
     cfg->binds[ACTION_MOVE_FORWARD] = SDL_SCANCODE_W;
     cfg->binds[ACTION_MOVE_BACK]    = SDL_SCANCODE_S;
     cfg->binds[ACTION_STRAFE_LEFT]  = SDL_SCANCODE_A;
@@ -231,6 +243,18 @@ int config_load_or_create(void)
     if (json_get_int(buf, "sfx_enabled", &iv)) g_cfg.sfx_enabled = (iv != 0);
     if (json_get_int(buf, "sfx_volume", &iv)) g_cfg.sfx_volume = iv;
 
+    if (json_get_int(buf, "software_renderer", &iv)) g_cfg.software_renderer = (iv != 0);
+    if (json_get_int(buf, "floor_casting", &iv)) g_cfg.floor_casting = (iv != 0);
+    if (json_get_int(buf, "render_threads", &iv)) g_cfg.render_threads = iv;
+
+    if (json_get_int(buf, "target_fps", &iv)) g_cfg.target_fps = iv;
+    if (json_get_int(buf, "vsync", &iv)) g_cfg.vsync = (iv != 0);
+
+    if (json_get_int(buf, "ai_lod", &iv)) g_cfg.ai_lod = (iv != 0);
+    if (json_get_int(buf, "ai_near_tiles", &iv)) g_cfg.ai_near_tiles = iv;
+    if (json_get_int(buf, "ai_far_tiles", &iv)) g_cfg.ai_far_tiles = iv;
+    if (json_get_int(buf, "ai_mid_interval", &iv)) g_cfg.ai_mid_interval = iv;
+
     parse_bind(buf, "move_forward", ACTION_MOVE_FORWARD);
     parse_bind(buf, "move_back", ACTION_MOVE_BACK);
     parse_bind(buf, "strafe_left", ACTION_STRAFE_LEFT);
@@ -251,6 +275,11 @@ int config_load_or_create(void)
     g_cfg.master_volume = clampi(g_cfg.master_volume, 0, 128);
     g_cfg.bgm_volume = clampi(g_cfg.bgm_volume, 0, 128);
     g_cfg.sfx_volume = clampi(g_cfg.sfx_volume, 0, 128);
+    g_cfg.render_threads = clampi(g_cfg.render_threads, 0, 64);
+    g_cfg.target_fps = clampi(g_cfg.target_fps, 0, 1000);
+    g_cfg.ai_near_tiles = clampi(g_cfg.ai_near_tiles, 1, 1024);
+    g_cfg.ai_far_tiles = clampi(g_cfg.ai_far_tiles, g_cfg.ai_near_tiles, 4096);
+    g_cfg.ai_mid_interval = clampi(g_cfg.ai_mid_interval, 1, 60);
 
     return 0;
 }
@@ -270,6 +299,11 @@ int config_save(void)
     g_cfg.master_volume = clampi(g_cfg.master_volume, 0, 128);
     g_cfg.bgm_volume = clampi(g_cfg.bgm_volume, 0, 128);
     g_cfg.sfx_volume = clampi(g_cfg.sfx_volume, 0, 128);
+    g_cfg.render_threads = clampi(g_cfg.render_threads, 0, 64);
+    g_cfg.target_fps = clampi(g_cfg.target_fps, 0, 1000);
+    g_cfg.ai_near_tiles = clampi(g_cfg.ai_near_tiles, 1, 1024);
+    g_cfg.ai_far_tiles = clampi(g_cfg.ai_far_tiles, g_cfg.ai_near_tiles, 4096);
+    g_cfg.ai_mid_interval = clampi(g_cfg.ai_mid_interval, 1, 60);
 
     fprintf(fp, "{\n");
     fprintf(fp, "  \"version\": %d,\n", CONFIG_VERSION);
@@ -282,6 +316,18 @@ int config_save(void)
     fprintf(fp, "  \"sfx_enabled\": %d,\n", g_cfg.sfx_enabled ? 1 : 0);
     fprintf(fp, "  \"sfx_volume\": %d,\n", g_cfg.sfx_volume);
 
+    fprintf(fp, "  \"software_renderer\": %d,\n", g_cfg.software_renderer ? 1 : 0);
+    fprintf(fp, "  \"floor_casting\": %d,\n", g_cfg.floor_casting ? 1 : 0);
+    fprintf(fp, "  \"render_threads\": %d,\n", g_cfg.render_threads);
+
+    fprintf(fp, "  \"target_fps\": %d,\n", g_cfg.target_fps);
+    fprintf(fp, "  \"vsync\": %d,\n", g_cfg.vsync ? 1 : 0);
+
+    fprintf(fp, "  \"ai_lod\": %d,\n", g_cfg.ai_lod ? 1 : 0);
+    fprintf(fp, "  \"ai_near_tiles\": %d,\n", g_cfg.ai_near_tiles);
+    fprintf(fp, "  \"ai_far_tiles\": %d,\n", g_cfg.ai_far_tiles);
+    fprintf(fp, "  \"ai_mid_interval\": %d,\n", g_cfg.ai_mid_interval);
+
     fprintf(fp, "  \"bindings\": {\n");
     fprintf(fp, "    \"move_forward\": %d,\n", (int)g_cfg.binds[ACTION_MOVE_FORWARD]);
     fprintf(fp, "    \"move_back\": %d,\n", (int)g_cfg.binds[ACTION_MOVE_BACK]);
@@ -345,3 +391,30 @@ void config_set_sfx_enabled(int v) { g_cfg.sfx_enabled = (v != 0); }
 int config_get_sfx_volume(void) { return g_cfg.sfx_volume; }
 void config_set_sfx_volume(int v) { g_cfg.sfx_volume = clampi(v, 0, 128); }
 
+int config_get_software_renderer(void) { return g_cfg.software_renderer ? 1 : 0; }
+void config_set_software_renderer(int v) { g_cfg.software_renderer = (v != 0); }
+
+int config_get_floor_casting(void) { return g_cfg.floor_casting ? 1 : 0; }
+void config_set_floor_casting(int v) { g_cfg.floor_casting = (v != 0); }
+
+int config_get_render_threads(void) { return g_cfg.render_threads; }
+void config_set_render_threads(int v) { g_cfg.render_threads = (v < 0) ? 0 : v; }
+
+int config_get_target_fps(void) { return g_cfg.target_fps; }
+void config_set_target_fps(int v) { g_cfg.target_fps = clampi(v, 0, 1000); }
+
+int config_get_vsync(void) { return g_cfg.vsync ? 1 : 0; }
+void config_set_vsync(int v) { g_cfg.vsync = (v != 0); }
+
+int config_get_ai_lod(void) { return g_cfg.ai_lod ? 1 : 0; }
+void config_set_ai_lod(int v) { g_cfg.ai_lod = (v != 0); }
+
+int config_get_ai_near_tiles(void) { return g_cfg.ai_near_tiles; }
+void config_set_ai_near_tiles(int v) { g_cfg.ai_near_tiles = clampi(v, 1, 1024); }
+
+int config_get_ai_far_tiles(void) { return g_cfg.ai_far_tiles; }
+void config_set_ai_far_tiles(int v) { g_cfg.ai_far_tiles = clampi(v, 1, 4096); }
+
+int config_get_ai_mid_interval(void) { return g_cfg.ai_mid_interval; }
+void config_set_ai_mid_interval(int v) { g_cfg.ai_mid_interval = clampi(v, 1, 60); }
+
@@ -37,6 +37,18 @@ typedef struct {
     int sfx_enabled;   /* 0/1 */
     int sfx_volume;    /* 0..128 */
 
+    int software_renderer; /* 0/1: draw the world through the CPU framebuffer */
+    int floor_casting;     /* 0/1: software path casts floor/ceiling per row */
+    int render_threads;    /* software path worker count, 0 = one per CPU */
+
+    int target_fps;        /* frame cap, 0 = display refresh rate */
+    int vsync;             /* 0/1 */
+
+    int ai_lod;            /* 0/1: update distant enemies less often */
+    int ai_near_tiles;     /* steps from the player updated every tick */
+    int ai_far_tiles;      /* steps beyond which enemies go dormant */
+    int ai_mid_interval;   /* ticks between updates in between */
+
     SDL_Scancode binds[ACTION_COUNT];
 } GameConfig;
 
@@ -73,4 +85,31 @@ void config_set_sfx_enabled(int v);
 int config_get_sfx_volume(void);
 void config_set_sfx_volume(int v);
 
+int config_get_software_renderer(void);
+void config_set_software_renderer(int v);
+
+int config_get_floor_casting(void);
+void config_set_floor_casting(int v);
+
+int config_get_render_threads(void);
+void config_set_render_threads(int v);
+
+int config_get_target_fps(void);
+void config_set_target_fps(int v);
+
+int config_get_vsync(void);
+void config_set_vsync(int v);
+
+int config_get_ai_lod(void);
+void config_set_ai_lod(int v);
+
+int config_get_ai_near_tiles(void);
+void config_set_ai_near_tiles(int v);
+
+int config_get_ai_far_tiles(void);
+void config_set_ai_far_tiles(int v);
+
+int config_get_ai_mid_interval(void);
+void config_set_ai_mid_interval(int v);
+
 #endif
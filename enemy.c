@@ -1,12 +1,58 @@
+#include <float.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "enemy.h"
 #include "player.h"
 #include "map.h"
 #include "audio.h"
+#include "spatial.h"
+#include "flowfield.h"
+#include "pathfind.h"
+#include "boss.h"
+#include "render.h"
+#include "profiler.h"
 
-Enemy enemies[MAX_ENEMIES];
-int enemy_count = 0;
+/* The batched update must round like the scalar one so both give the same
+ * positions, which rules out x87 excess precision. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#define ENEMY_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+EnemyPool enemies;
+
+/* Bosses still ALIVE; kept in step with damage_enemy(). */
+static int bosses_alive = 0;
+
+/* Longest melee reach of any kind (see attack_range_for_kind()). */
+#define MAX_ATTACK_RANGE 0.70f
+
+/* Level of detail tiers (enemies_set_lod_tiers()). */
+static int lod_enabled = 1;
+static int lod_near_tiles = 8;
+static int lod_far_tiles = 20;
+static int lod_mid_interval = 4;
+
+/* Player tile and map_revision the FAR enemies were last checked against;
+ * -1 = check them all next update. */
+static int lod_tile_x = -1, lod_tile_y = -1;
+static Uint32 lod_revision = 0;
+static Uint32 lod_tick = 0;
+static int lod_counts[ENEMY_LOD_COUNT];
+
+static int is_boss(EnemyKind k)
+{
+    return k == ENEMY_MINIBOSS1 || k == ENEMY_FINALBOSS;
+}
+
+static int index_asc(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
 
 static int hp_for_kind(EnemyKind k)
 {
@@ -61,138 +107,735 @@ static float attack_range_for_kind(EnemyKind k)
     }
 }
 
+/* ------------------------------------------------------------
+ * Pool storage and handles
+ *
+ * A handle is a slot number plus the slot's generation. Slots map to the
+ * enemy's current index and are recycled through a free list; freeing a
+ * slot bumps its generation, so old handles stop matching.
+ * ------------------------------------------------------------ */
+#define HANDLE_SLOT_BITS 20
+#define HANDLE_SLOT_MASK ((1u << HANDLE_SLOT_BITS) - 1u)
+#define HANDLE_GEN_MASK  (0xFFFFFFFFu >> HANDLE_SLOT_BITS)
+
+static int *slot_index;         /* slot -> index, -1 = free */
+static Uint32 *slot_gen;        /* slot -> generation, never 0 */
+static int *free_slots;         /* stack of free slots */
+static int free_count = 0;
+static int slot_count = 0;      /* slots handed out so far */
+
+/* Level of detail, kept per enemy (see assign_lod()). */
+static Uint8 *lod_tier;         /* EnemyLod */
+static float *lod_dt;           /* time since the last update while MID */
+
+/* Per-enemy input and output of the batched step (see update_enemies()). */
+static float *step_dt;          /* time to advance by, 0 = skip this update */
+static float *aim_x, *aim_y;    /* point to walk towards (flowfield_aim()) */
+static float *step_x, *step_y;  /* proposed position */
+static Uint8 *step_move;        /* 1 = wants to move there */
+
+/* Resize arr to n entries, or return -1 from the caller and leave it as
+ * it was. */
+#define GROW_ARRAY(arr, n) do {                                        \
+        void *grown_ = realloc((arr), (size_t)(n) * sizeof *(arr));    \
+        if (!grown_) return -1;                                        \
+        (arr) = grown_;                                                \
+    } while (0)
+
+/* Make room for need enemies. Every live enemy owns one slot, so the slot
+ * arrays grow with the pool. */
+static int reserve(int need)
+{
+    if (need <= enemies.capacity) return 0;
+    if (need > (int)HANDLE_SLOT_MASK) return -1;
+
+    int cap = enemies.capacity ? enemies.capacity : 64;
+    while (cap < need) cap *= 2;
+    if (cap > (int)HANDLE_SLOT_MASK) cap = (int)HANDLE_SLOT_MASK;
+
+    /* Arrays that did grow stay grown; capacity only moves once all did. */
+    GROW_ARRAY(enemies.x, cap);
+    GROW_ARRAY(enemies.y, cap);
+    GROW_ARRAY(enemies.prev_x, cap);
+    GROW_ARRAY(enemies.prev_y, cap);
+    GROW_ARRAY(enemies.hp, cap);
+    GROW_ARRAY(enemies.state, cap);
+    GROW_ARRAY(enemies.kind, cap);
+    GROW_ARRAY(enemies.touch_cooldown, cap);
+    GROW_ARRAY(enemies.dying_timer, cap);
+    GROW_ARRAY(enemies.attack_timer, cap);
+    GROW_ARRAY(enemies.handle, cap);
+    GROW_ARRAY(slot_index, cap);
+    GROW_ARRAY(slot_gen, cap);
+    GROW_ARRAY(free_slots, cap);
+    GROW_ARRAY(lod_tier, cap);
+    GROW_ARRAY(lod_dt, cap);
+    GROW_ARRAY(step_dt, cap);
+    GROW_ARRAY(aim_x, cap);
+    GROW_ARRAY(aim_y, cap);
+    GROW_ARRAY(step_x, cap);
+    GROW_ARRAY(step_y, cap);
+    GROW_ARRAY(step_move, cap);
+    if (spatial_reserve(SPATIAL_ENEMIES, cap) != 0) return -1;
+
+    enemies.capacity = cap;
+    return 0;
+}
+
+static EnemyHandle alloc_handle(int index)
+{
+    int slot;
+    if (free_count > 0) {
+        slot = free_slots[--free_count];
+    } else {
+        slot = slot_count++;
+        slot_gen[slot] = 1;
+    }
+    slot_index[slot] = index;
+    return (slot_gen[slot] << HANDLE_SLOT_BITS) | (Uint32)slot;
+}
+
+static void free_handle(EnemyHandle h)
+{
+    int slot = (int)(h & HANDLE_SLOT_MASK);
+    slot_index[slot] = -1;
+    slot_gen[slot] = (slot_gen[slot] + 1) & HANDLE_GEN_MASK;
+    if (slot_gen[slot] == 0) slot_gen[slot] = 1;
+    free_slots[free_count++] = slot;
+}
+
+EnemyHandle enemy_handle(int i)
+{
+    return (i >= 0 && i < enemies.count) ? enemies.handle[i] : 0;
+}
+
+int enemy_lookup(EnemyHandle h)
+{
+    int slot = (int)(h & HANDLE_SLOT_MASK);
+    if (h == 0 || slot >= slot_count) return -1;
+    if (slot_gen[slot] != (h >> HANDLE_SLOT_BITS)) return -1;
+    return slot_index[slot];
+}
+
+/* Swap-remove enemy i: the last enemy takes its index. */
+static void remove_enemy(int i)
+{
+    int last = enemies.count - 1;
+    if (enemies.state[i] == ENEMY_ALIVE && is_boss((EnemyKind)enemies.kind[i]))
+        bosses_alive--;
+
+    free_handle(enemies.handle[i]);
+    spatial_swap_remove(SPATIAL_ENEMIES, i, last);
+
+    if (i != last) {
+        enemies.x[i] = enemies.x[last];
+        enemies.y[i] = enemies.y[last];
+        enemies.prev_x[i] = enemies.prev_x[last];
+        enemies.prev_y[i] = enemies.prev_y[last];
+        enemies.hp[i] = enemies.hp[last];
+        enemies.state[i] = enemies.state[last];
+        enemies.kind[i] = enemies.kind[last];
+        enemies.touch_cooldown[i] = enemies.touch_cooldown[last];
+        enemies.dying_timer[i] = enemies.dying_timer[last];
+        enemies.attack_timer[i] = enemies.attack_timer[last];
+        enemies.handle[i] = enemies.handle[last];
+        lod_tier[i] = lod_tier[last];
+        lod_dt[i] = lod_dt[last];
+        slot_index[enemies.handle[i] & HANDLE_SLOT_MASK] = i;
+    }
+    enemies.count = last;
+}
+
+void enemies_clear(void)
+{
+    enemies.count = 0;
+    free_count = 0;
+    slot_count = 0;
+    bosses_alive = 0;
+    lod_tile_x = -1;
+    lod_tick = 0;   /* same MID-tier schedule every time a level starts */
+    boss_reset();
+    (void)spatial_reset(SPATIAL_ENEMIES, enemies.capacity);
+}
+
+void enemies_shutdown(void)
+{
+    free(enemies.x);
+    free(enemies.y);
+    free(enemies.prev_x);
+    free(enemies.prev_y);
+    free(enemies.hp);
+    free(enemies.state);
+    free(enemies.kind);
+    free(enemies.touch_cooldown);
+    free(enemies.dying_timer);
+    free(enemies.attack_timer);
+    free(enemies.handle);
+    free(slot_index);
+    free(slot_gen);
+    free(free_slots);
+    free(lod_tier);
+    free(lod_dt);
+    free(step_dt);
+    free(aim_x);
+    free(aim_y);
+    free(step_x);
+    free(step_y);
+    free(step_move);
+    enemies = (EnemyPool){0};
+    slot_index = NULL;
+    slot_gen = NULL;
+    free_slots = NULL;
+    lod_tier = NULL;
+    lod_dt = NULL;
+    step_dt = NULL;
+    aim_x = NULL;
+    aim_y = NULL;
+    step_x = NULL;
+    step_y = NULL;
+    step_move = NULL;
+    free_count = 0;
+    slot_count = 0;
+    bosses_alive = 0;
+}
+
+int enemy_spawn(EnemyKind kind, float x, float y)
+{
+    if (reserve(enemies.count + 1) != 0) return -1;
+
+    int i = enemies.count++;
+    enemies.x[i] = x;
+    enemies.y[i] = y;
+    enemies.prev_x[i] = x;
+    enemies.prev_y[i] = y;
+    enemies.hp[i] = hp_for_kind(kind);
+    enemies.state[i] = ENEMY_ALIVE;
+    enemies.kind[i] = (Uint8)kind;
+    enemies.touch_cooldown[i] = 0.0f;
+    enemies.dying_timer[i] = 0.0f;
+    enemies.attack_timer[i] = 0.0f;
+    enemies.handle[i] = alloc_handle(i);
+    lod_tier[i] = ENEMY_LOD_NEAR;
+    lod_dt[i] = 0.0f;
+
+    spatial_insert(SPATIAL_ENEMIES, i, x, y);
+    if (is_boss(kind)) bosses_alive++;
+    return i;
+}
+
 void init_enemies(void)
 {
-    enemy_count = 0;
+    enemies_clear();
     if (!worldmap || worldWidth <= 0 || worldHeight <= 0)
         return;
 
     for (int y = 0; y < worldHeight; y++) {
         for (int x = 0; x < worldWidth; x++) {
-            int t = worldmap[y][x];
-            EnemyKind kind;
-            int spawn = 1;
-
-            if (t == 9) kind = ENEMY_KIND1;
-            else if (t == 10) kind = ENEMY_KIND2;
-            else if (t == 12) kind = ENEMY_MINIBOSS1;
-            else if (t == 13) kind = ENEMY_FINALBOSS;
-            else spawn = 0;
-
-            if (spawn && enemy_count < MAX_ENEMIES) {
-                enemies[enemy_count++] = (Enemy){
-                    .x = x + 0.5f,
-                    .y = y + 0.5f,
-                    .state = ENEMY_ALIVE,
-                    .kind = kind,
-                    .hp = hp_for_kind(kind),
-                    .touch_cooldown = 0.0f,
-                    .dying_timer = 0.0f,
-                    .attack_timer = 0.0f
-                };
-                worldmap[y][x] = 0;
+            int t = map_tile(x, y);
+            if (!tile_is(t, TILE_SPAWN)) continue;
+            EnemyKind kind = (EnemyKind)tile_info[t].spawn;
+
+            if (enemy_spawn(kind, x + 0.5f, y + 0.5f) < 0) {
+                fprintf(stderr, "ENEMY: out of memory, spawn at %d,%d dropped\n", x, y);
+                continue;
             }
+            map_set_tile(x, y, 0);
         }
     }
 }
 
+void enemies_reindex(void)
+{
+    (void)spatial_reset(SPATIAL_ENEMIES, enemies.capacity);
+    bosses_alive = 0;
+
+    lod_tile_x = -1;
+    for (int i = 0; i < enemies.count; i++) {
+        lod_tier[i] = ENEMY_LOD_NEAR;
+        lod_dt[i] = 0.0f;
+        enemies.prev_x[i] = enemies.x[i];
+        enemies.prev_y[i] = enemies.y[i];
+        spatial_insert(SPATIAL_ENEMIES, i, enemies.x[i], enemies.y[i]);
+        if (enemies.state[i] == ENEMY_ALIVE && is_boss((EnemyKind)enemies.kind[i]))
+            bosses_alive++;
+    }
+}
+
 void damage_enemy(int i, int dmg)
 {
-    if (i < 0 || i >= enemy_count) return;
+    if (i < 0 || i >= enemies.count) return;
     if (dmg <= 0) return;
+    if (enemies.state[i] != ENEMY_ALIVE) return;
 
-    Enemy *e = &enemies[i];
-    if (e->state != ENEMY_ALIVE) return;
-
-    e->hp -= dmg;
-    if (e->hp <= 0) {
-        e->state = ENEMY_DYING;
-        e->dying_timer = (e->kind == ENEMY_MINIBOSS1 || e->kind == ENEMY_FINALBOSS) ? 0.85f : 0.45f;
-        e->attack_timer = 0.0f;
+    enemies.hp[i] -= dmg;
+    if (enemies.hp[i] <= 0) {
+        EnemyKind kind = (EnemyKind)enemies.kind[i];
+        enemies.state[i] = ENEMY_DYING;
+        enemies.dying_timer[i] = is_boss(kind) ? 0.85f : 0.45f;
+        enemies.attack_timer[i] = 0.0f;
+        if (is_boss(kind)) bosses_alive--;
         audio_play_sfx(SFX_ENEMY_DIE);
     }
 }
 
+int enemy_max_hp(EnemyKind kind)
+{
+    return hp_for_kind(kind);
+}
+
 int enemy_boss_alive(void)
 {
-    for (int i = 0; i < enemy_count; i++) {
-        if (enemies[i].state != ENEMY_ALIVE) continue;
-        if (enemies[i].kind == ENEMY_MINIBOSS1 || enemies[i].kind == ENEMY_FINALBOSS)
-            return 1;
-    }
-    return 0;
+    return bosses_alive > 0;
 }
 
-void update_enemies(float dt)
+/* ------------------------------------------------------------
+ * Batched update
+ *
+ * Each enemy is first given the time it advances by this update (its
+ * level of detail, assign_lod()), and each one that advances gets its aim
+ * point from the flow field, or from its tactics if it is a boss. The next
+ * pass runs over the pool arrays several enemies at a time: it counts
+ * down the timers, measures the distance to the player and works out
+ * where each chasing enemy wants to step. Collision needs
+ * lookups into the map, so a scalar pass then applies the steps one by
+ * one. Every kernel rounds exactly like step_scalar(), so the choice of
+ * kernel does not change gameplay.
+ * ------------------------------------------------------------ */
+typedef void (*StepFn)(int first, int end, float tx, float ty);
+
+/* Speed and stopping distance per EnemyKind for the wide kernels, filled
+ * from the *_for_kind() tables by select_step_kernel(). */
+static float kind_speed[ENEMY_FINALBOSS + 1];
+static float kind_stop[ENEMY_FINALBOSS + 1];
+
+/* Reference kernel, also used for the tail the wide kernels leave over. */
+static void step_scalar(int first, int end, float tx, float ty)
 {
-    for (int i = 0; i < enemy_count; i++) {
-        Enemy *e = &enemies[i];
-        if (e->state == ENEMY_DEAD) continue;
+    for (int i = first; i < end; i++) {
+        float dt = step_dt[i];
+        step_move[i] = 0;
+        if (dt <= 0.0f) continue;
 
-        if (e->attack_timer > 0.0f) {
-            e->attack_timer -= dt;
-            if (e->attack_timer < 0.0f) e->attack_timer = 0.0f;
+        if (enemies.attack_timer[i] > 0.0f) {
+            enemies.attack_timer[i] -= dt;
+            if (enemies.attack_timer[i] < 0.0f) enemies.attack_timer[i] = 0.0f;
         }
 
-        if (e->state == ENEMY_DYING) {
-            if (e->dying_timer > 0.0f)
-                e->dying_timer -= dt;
-            if (e->dying_timer <= 0.0f)
-                e->state = ENEMY_DEAD;
+        if (enemies.state[i] == ENEMY_DYING) {
+            if (enemies.dying_timer[i] > 0.0f)
+                enemies.dying_timer[i] -= dt;
             continue;
         }
+        if (enemies.state[i] != ENEMY_ALIVE) continue;
 
-        /* Simple chase movement (no wall collision). */
-        float dx = px - e->x;
-        float dy = py - e->y;
+        /* Chase the player, stopping just inside attack range. */
+        EnemyKind kind = (EnemyKind)enemies.kind[i];
+        float dx = tx - enemies.x[i];
+        float dy = ty - enemies.y[i];
         float dist = sqrtf(dx * dx + dy * dy);
+        float stop = attack_range_for_kind(kind) * 0.9f;
 
-        float speed = move_speed_for_kind(e->kind);
-        if (dist > 0.01f) {
-            float stop = attack_range_for_kind(e->kind) * 0.9f;
-            if (dist > stop) {
-                /* Proposed new position towards player. */
-                float inv = 1.0f / dist;
-                float mv = dt * speed;
-                float nx = e->x + dx * inv * mv;
-                float ny = e->y + dy * inv * mv;
-
-                /* Prevent enemies from walking through walls by checking collisions.
-                 * We update X and Y separately to allow sliding along walls. */
-                if (worldmap && worldWidth > 0 && worldHeight > 0) {
-                    int curY = (int)e->y;
-                    int curX = (int)e->x;
-                    /* Attempt to move along X axis if next tile is free. */
-                    int mx = (int)nx;
-                    if (mx >= 0 && mx < worldWidth && curY >= 0 && curY < worldHeight && worldmap[curY][mx] < 2) {
-                        e->x = nx;
-                    }
-                    /* Attempt to move along Y axis if next tile is free. */
-                    int my = (int)ny;
-                    mx = (int)e->x; /* use potentially updated x coordinate */
-                    if (mx >= 0 && mx < worldWidth && my >= 0 && my < worldHeight && worldmap[my][mx] < 2) {
-                        e->y = ny;
-                    }
-                } else {
-                    /* Fallback if map is invalid. */
-                    e->x = nx;
-                    e->y = ny;
-                }
+        /* Aiming at the player, stop just inside attack range; any other
+         * aim point is walked all the way to. */
+        float ax = aim_x[i] - enemies.x[i];
+        float ay = aim_y[i] - enemies.y[i];
+        float alen = sqrtf(ax * ax + ay * ay);
+        int chase = (aim_x[i] == tx && aim_y[i] == ty);
+        if (chase ? (dist > 0.01f && dist > stop) : alen > 0.01f) {
+            float inv = 1.0f / alen;
+            float mv = dt * move_speed_for_kind(kind);
+            step_x[i] = enemies.x[i] + ax * inv * mv;
+            step_y[i] = enemies.y[i] + ay * inv * mv;
+            step_move[i] = 1;
+        }
+
+        if (enemies.touch_cooldown[i] > 0.0f) {
+            enemies.touch_cooldown[i] -= dt;
+            if (enemies.touch_cooldown[i] < 0.0f) enemies.touch_cooldown[i] = 0.0f;
+        }
+    }
+}
+
+#ifdef ENEMY_X86_SIMD
+/* mask ? a : b */
+__attribute__((target("sse2")))
+static inline __m128 sel4(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* Four bytes widened to 32-bit lanes. */
+__attribute__((target("sse2")))
+static inline __m128i load_u8x4(const Uint8 *p)
+{
+    int bytes;
+    memcpy(&bytes, p, sizeof bytes);
+    __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+    return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+}
+
+/* Per-kind constant for each lane; unknown kinds get ENEMY_KIND1's, which
+ * matches the defaults of the *_for_kind() tables. */
+__attribute__((target("sse2")))
+static inline __m128 kind_select4(__m128i kind, const float *table)
+{
+    __m128 v = _mm_set1_ps(table[ENEMY_KIND1]);
+    for (int k = ENEMY_KIND2; k <= ENEMY_FINALBOSS; k++) {
+        __m128 is_k = _mm_castsi128_ps(_mm_cmpeq_epi32(kind, _mm_set1_epi32(k)));
+        v = sel4(is_k, _mm_set1_ps(table[k]), v);
+    }
+    return v;
+}
+
+__attribute__((target("sse2")))
+static void step_sse2(int first, int end, float tx, float ty)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 vtx = _mm_set1_ps(tx);
+    const __m128 vty = _mm_set1_ps(ty);
+    const __m128 near_eps = _mm_set1_ps(0.01f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i alive_id = _mm_set1_epi32(ENEMY_ALIVE);
+    const __m128i dying_id = _mm_set1_epi32(ENEMY_DYING);
+
+    int i = first;
+    for (; i + 4 <= end; i += 4) {
+        __m128i state = load_u8x4(enemies.state + i);
+        __m128i kind = load_u8x4(enemies.kind + i);
+        __m128 alive = _mm_castsi128_ps(_mm_cmpeq_epi32(state, alive_id));
+        __m128 dying = _mm_castsi128_ps(_mm_cmpeq_epi32(state, dying_id));
+        /* A lane with dt 0 keeps its timers as they are. */
+        __m128 vdt = _mm_loadu_ps(step_dt + i);
+        __m128 awake = _mm_cmpgt_ps(vdt, zero);
+
+        __m128 at = _mm_loadu_ps(enemies.attack_timer + i);
+        at = sel4(_mm_cmpgt_ps(at, zero), _mm_max_ps(_mm_sub_ps(at, vdt), zero), at);
+        _mm_storeu_ps(enemies.attack_timer + i, at);
+
+        __m128 dtm = _mm_loadu_ps(enemies.dying_timer + i);
+        dtm = sel4(_mm_and_ps(dying, _mm_cmpgt_ps(dtm, zero)), _mm_sub_ps(dtm, vdt), dtm);
+        _mm_storeu_ps(enemies.dying_timer + i, dtm);
+
+        __m128 tc = _mm_loadu_ps(enemies.touch_cooldown + i);
+        tc = sel4(_mm_and_ps(alive, _mm_cmpgt_ps(tc, zero)), _mm_max_ps(_mm_sub_ps(tc, vdt), zero), tc);
+        _mm_storeu_ps(enemies.touch_cooldown + i, tc);
+
+        __m128 ex = _mm_loadu_ps(enemies.x + i);
+        __m128 ey = _mm_loadu_ps(enemies.y + i);
+        __m128 dx = _mm_sub_ps(vtx, ex);
+        __m128 dy = _mm_sub_ps(vty, ey);
+        __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 aimx = _mm_loadu_ps(aim_x + i);
+        __m128 aimy = _mm_loadu_ps(aim_y + i);
+        __m128 ax = _mm_sub_ps(aimx, ex);
+        __m128 ay = _mm_sub_ps(aimy, ey);
+        __m128 alen = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)));
+
+        __m128 chase = _mm_and_ps(_mm_cmpeq_ps(aimx, vtx), _mm_cmpeq_ps(aimy, vty));
+        __m128 chase_move = _mm_and_ps(_mm_cmpgt_ps(dist, near_eps),
+                                       _mm_cmpgt_ps(dist, kind_select4(kind, kind_stop)));
+        __m128 move = _mm_and_ps(_mm_and_ps(alive, awake),
+                                 sel4(chase, chase_move, _mm_cmpgt_ps(alen, near_eps)));
+
+        /* Lanes that do not move may divide by zero; their result is unused. */
+        __m128 inv = _mm_div_ps(one, alen);
+        __m128 mv = _mm_mul_ps(vdt, kind_select4(kind, kind_speed));
+        _mm_storeu_ps(step_x + i, _mm_add_ps(ex, _mm_mul_ps(_mm_mul_ps(ax, inv), mv)));
+        _mm_storeu_ps(step_y + i, _mm_add_ps(ey, _mm_mul_ps(_mm_mul_ps(ay, inv), mv)));
+
+        int bits = _mm_movemask_ps(move);
+        for (int k = 0; k < 4; k++)
+            step_move[i + k] = (Uint8)((bits >> k) & 1);
+    }
+
+    if (i < end)
+        step_scalar(i, end, tx, ty);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 kind_select8(__m256i kind, const float *table)
+{
+    __m256 v = _mm256_set1_ps(table[ENEMY_KIND1]);
+    for (int k = ENEMY_KIND2; k <= ENEMY_FINALBOSS; k++) {
+        __m256 is_k = _mm256_castsi256_ps(_mm256_cmpeq_epi32(kind, _mm256_set1_epi32(k)));
+        v = _mm256_blendv_ps(v, _mm256_set1_ps(table[k]), is_k);
+    }
+    return v;
+}
+
+__attribute__((target("avx2")))
+static void step_avx2(int first, int end, float tx, float ty)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 vtx = _mm256_set1_ps(tx);
+    const __m256 vty = _mm256_set1_ps(ty);
+    const __m256 near_eps = _mm256_set1_ps(0.01f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i alive_id = _mm256_set1_epi32(ENEMY_ALIVE);
+    const __m256i dying_id = _mm256_set1_epi32(ENEMY_DYING);
+
+    int i = first;
+    for (; i + 8 <= end; i += 8) {
+        __m256i state = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(enemies.state + i)));
+        __m256i kind = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(enemies.kind + i)));
+        __m256 alive = _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, alive_id));
+        __m256 dying = _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, dying_id));
+        __m256 vdt = _mm256_loadu_ps(step_dt + i);
+        __m256 awake = _mm256_cmp_ps(vdt, zero, _CMP_GT_OQ);
+
+        __m256 at = _mm256_loadu_ps(enemies.attack_timer + i);
+        at = _mm256_blendv_ps(at, _mm256_max_ps(_mm256_sub_ps(at, vdt), zero),
+                              _mm256_cmp_ps(at, zero, _CMP_GT_OQ));
+        _mm256_storeu_ps(enemies.attack_timer + i, at);
+
+        __m256 dtm = _mm256_loadu_ps(enemies.dying_timer + i);
+        dtm = _mm256_blendv_ps(dtm, _mm256_sub_ps(dtm, vdt),
+                               _mm256_and_ps(dying, _mm256_cmp_ps(dtm, zero, _CMP_GT_OQ)));
+        _mm256_storeu_ps(enemies.dying_timer + i, dtm);
+
+        __m256 tc = _mm256_loadu_ps(enemies.touch_cooldown + i);
+        tc = _mm256_blendv_ps(tc, _mm256_max_ps(_mm256_sub_ps(tc, vdt), zero),
+                              _mm256_and_ps(alive, _mm256_cmp_ps(tc, zero, _CMP_GT_OQ)));
+        _mm256_storeu_ps(enemies.touch_cooldown + i, tc);
+
+        __m256 ex = _mm256_loadu_ps(enemies.x + i);
+        __m256 ey = _mm256_loadu_ps(enemies.y + i);
+        __m256 dx = _mm256_sub_ps(vtx, ex);
+        __m256 dy = _mm256_sub_ps(vty, ey);
+        __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        __m256 aimx = _mm256_loadu_ps(aim_x + i);
+        __m256 aimy = _mm256_loadu_ps(aim_y + i);
+        __m256 ax = _mm256_sub_ps(aimx, ex);
+        __m256 ay = _mm256_sub_ps(aimy, ey);
+        __m256 alen = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(ax, ax), _mm256_mul_ps(ay, ay)));
+
+        __m256 chase = _mm256_and_ps(_mm256_cmp_ps(aimx, vtx, _CMP_EQ_OQ), _mm256_cmp_ps(aimy, vty, _CMP_EQ_OQ));
+        __m256 chase_move = _mm256_and_ps(_mm256_cmp_ps(dist, near_eps, _CMP_GT_OQ),
+                                          _mm256_cmp_ps(dist, kind_select8(kind, kind_stop), _CMP_GT_OQ));
+        __m256 move = _mm256_and_ps(_mm256_and_ps(alive, awake),
+                                    _mm256_blendv_ps(_mm256_cmp_ps(alen, near_eps, _CMP_GT_OQ),
+                                                     chase_move, chase));
+
+        __m256 inv = _mm256_div_ps(one, alen);
+        __m256 mv = _mm256_mul_ps(vdt, kind_select8(kind, kind_speed));
+        _mm256_storeu_ps(step_x + i, _mm256_add_ps(ex, _mm256_mul_ps(_mm256_mul_ps(ax, inv), mv)));
+        _mm256_storeu_ps(step_y + i, _mm256_add_ps(ey, _mm256_mul_ps(_mm256_mul_ps(ay, inv), mv)));
+
+        int bits = _mm256_movemask_ps(move);
+        for (int k = 0; k < 8; k++)
+            step_move[i + k] = (Uint8)((bits >> k) & 1);
+    }
+
+    if (i < end)
+        step_scalar(i, end, tx, ty);
+}
+#endif /* ENEMY_X86_SIMD */
+
+static StepFn step_wide = NULL;
+static const char *step_kernel = NULL;
+static int simd_enabled = 1;
+
+static void select_step_kernel(void)
+{
+    if (step_kernel) return;
+
+    for (int k = ENEMY_KIND1; k <= ENEMY_FINALBOSS; k++) {
+        kind_speed[k] = move_speed_for_kind((EnemyKind)k);
+        kind_stop[k] = attack_range_for_kind((EnemyKind)k) * 0.9f;
+    }
+
+    step_kernel = "SCALAR";
+#ifdef ENEMY_X86_SIMD
+    if (SDL_HasAVX2()) {
+        step_wide = step_avx2;
+        step_kernel = "AVX2";
+    } else if (SDL_HasSSE2()) {
+        step_wide = step_sse2;
+        step_kernel = "SSE2";
+    }
+#endif
+}
+
+const char *enemy_kernel_name(void)
+{
+    select_step_kernel();
+    return simd_enabled ? step_kernel : "SCALAR";
+}
+
+void enemies_set_simd(int enabled)
+{
+    simd_enabled = enabled ? 1 : 0;
+}
+
+/* Move enemy i towards (nx, ny). X and Y are tried separately so enemies
+ * slide along walls. */
+static void apply_step(int i, float nx, float ny)
+{
+    float ex = enemies.x[i];
+    float ey = enemies.y[i];
+
+    if (worldmap && worldWidth > 0 && worldHeight > 0) {
+        int curY = (int)ey;
+        int mx = (int)nx;
+        if (mx >= 0 && mx < worldWidth && curY >= 0 && curY < worldHeight && !map_is(mx, curY, TILE_SOLID))
+            ex = nx;
+
+        int my = (int)ny;
+        mx = (int)ex; /* use potentially updated x coordinate */
+        if (mx >= 0 && mx < worldWidth && my >= 0 && my < worldHeight && !map_is(mx, my, TILE_SOLID))
+            ey = ny;
+    } else {
+        /* Fallback if map is invalid. */
+        ex = nx;
+        ey = ny;
+    }
+
+    enemies.x[i] = ex;
+    enemies.y[i] = ey;
+    spatial_move(SPATIAL_ENEMIES, i, ex, ey);
+}
+
+/* Sort the enemies into tiers by how far they have to walk to the player
+ * and fill step_dt: NEAR enemies and those in view advance by dt, MID ones
+ * by the time gathered since their last update every lod_mid_interval-th
+ * update (spread over the updates by handle), and FAR ones sleep. Only
+ * ALIVE enemies are tiered; the rest always count down their timers. */
+static void assign_lod(float dt, int have_field)
+{
+    int tile_x = (int)floorf(px), tile_y = (int)floorf(py);
+    int recheck = tile_x != lod_tile_x || tile_y != lod_tile_y || lod_revision != map_revision;
+    lod_tile_x = tile_x;
+    lod_tile_y = tile_y;
+    lod_revision = map_revision;
+    lod_tick++;
+
+    /* Without the field there are no walking distances to go by. */
+    int tiered = lod_enabled && have_field;
+
+    for (int i = 0; i < enemies.count; i++) {
+        EnemyLod tier = ENEMY_LOD_NEAR;
+        if (tiered && enemies.state[i] == ENEMY_ALIVE) {
+            if (lod_tier[i] == ENEMY_LOD_FAR && !recheck) {
+                tier = ENEMY_LOD_FAR;
+            } else {
+                int d = flowfield_distance((int)floorf(enemies.x[i]), (int)floorf(enemies.y[i]));
+                if (d < 0 || d > lod_far_tiles) tier = ENEMY_LOD_FAR;
+                else if (d > lod_near_tiles) tier = ENEMY_LOD_MID;
             }
         }
+        lod_tier[i] = (Uint8)tier;
+    }
+
+    /* Whatever the player can see stays at full rate. */
+    if (tiered) {
+        int *seen;
+        int n = spatial_query_cone(SPATIAL_ENEMIES, px, py, cosf(angle), sinf(angle),
+                                   FOV * 0.5f, (float)lod_far_tiles, &seen);
+        for (int k = 0; k < n; k++) {
+            int i = seen[k];
+            if (lod_tier[i] != ENEMY_LOD_NEAR && map_line_clear(px, py, enemies.x[i], enemies.y[i]))
+                lod_tier[i] = ENEMY_LOD_NEAR;
+        }
+    }
 
-        if (e->touch_cooldown > 0.0f) {
-            e->touch_cooldown -= dt;
-            if (e->touch_cooldown < 0.0f) e->touch_cooldown = 0.0f;
+    memset(lod_counts, 0, sizeof lod_counts);
+    for (int i = 0; i < enemies.count; i++) {
+        switch ((EnemyLod)lod_tier[i]) {
+            case ENEMY_LOD_NEAR:
+                step_dt[i] = lod_dt[i] + dt;
+                lod_dt[i] = 0.0f;
+                break;
+            case ENEMY_LOD_MID:
+                lod_dt[i] += dt;
+                step_dt[i] = 0.0f;
+                if ((lod_tick + (enemies.handle[i] & HANDLE_SLOT_MASK)) % (Uint32)lod_mid_interval == 0) {
+                    step_dt[i] = lod_dt[i];
+                    lod_dt[i] = 0.0f;
+                }
+                break;
+            default:
+                /* Dormant time is not made up on waking. */
+                step_dt[i] = 0.0f;
+                lod_dt[i] = 0.0f;
+                break;
         }
+        lod_counts[lod_tier[i]]++;
+    }
 
-        float range = attack_range_for_kind(e->kind);
-        if (!player_dead && dist < range && e->touch_cooldown <= 0.0f) {
-            e->touch_cooldown = attack_cooldown_for_kind(e->kind);
-            e->attack_timer = 0.22f;
+    profiler_count(PROF_COUNT_AI_NEAR, lod_counts[ENEMY_LOD_NEAR]);
+    profiler_count(PROF_COUNT_AI_MID, lod_counts[ENEMY_LOD_MID]);
+    profiler_count(PROF_COUNT_AI_FAR, lod_counts[ENEMY_LOD_FAR]);
+}
+
+void enemies_set_lod(int enabled)
+{
+    lod_enabled = enabled ? 1 : 0;
+}
+
+void enemies_set_lod_tiers(int near_tiles, int far_tiles, int mid_interval)
+{
+    lod_near_tiles = near_tiles < 1 ? 1 : near_tiles;
+    lod_far_tiles = far_tiles < lod_near_tiles ? lod_near_tiles : far_tiles;
+    lod_mid_interval = mid_interval < 1 ? 1 : mid_interval;
+    lod_tile_x = -1;
+}
+
+void enemy_lod_counts(int counts[ENEMY_LOD_COUNT])
+{
+    memcpy(counts, lod_counts, sizeof lod_counts);
+}
+
+void update_enemies(float dt)
+{
+    select_step_kernel();
+
+    if (enemies.count > 0) {
+        memcpy(enemies.prev_x, enemies.x, (size_t)enemies.count * sizeof(float));
+        memcpy(enemies.prev_y, enemies.y, (size_t)enemies.count * sizeof(float));
+    }
+
+    /* Without a field (out of memory) every aim is the player itself. */
+    int have_field = flowfield_update(px, py) == 0;
+    assign_lod(dt, have_field);
+
+    pathfind_new_frame();
+    for (int i = 0; i < enemies.count; i++) {
+        if (step_dt[i] <= 0.0f) {
+            aim_x[i] = enemies.x[i];
+            aim_y[i] = enemies.y[i];
+            continue;
+        }
+        if (enemies.state[i] == ENEMY_ALIVE && is_boss((EnemyKind)enemies.kind[i]))
+            boss_aim(i, step_dt[i], &aim_x[i], &aim_y[i]);
+        else
+            flowfield_aim(enemies.x[i], enemies.y[i], px, py, &aim_x[i], &aim_y[i]);
+    }
+
+    if (step_wide && simd_enabled)
+        step_wide(0, enemies.count, px, py);
+    else
+        step_scalar(0, enemies.count, px, py);
+
+    /* Melee, from where the enemies stood at the start of the update: only
+     * those within the longest reach of the player can hit, in index
+     * order as a full scan would. */
+    int *nearby;
+    int n = spatial_query_radius(SPATIAL_ENEMIES, px, py, MAX_ATTACK_RANGE, &nearby);
+    qsort(nearby, (size_t)n, sizeof nearby[0], index_asc);
+    for (int k = 0; k < n; k++) {
+        int i = nearby[k];
+        if (enemies.state[i] != ENEMY_ALIVE) continue;
+
+        EnemyKind kind = (EnemyKind)enemies.kind[i];
+        float dx = px - enemies.x[i];
+        float dy = py - enemies.y[i];
+        float range = attack_range_for_kind(kind);
+        if (!player_dead && dx * dx + dy * dy < range * range && enemies.touch_cooldown[i] <= 0.0f) {
+            enemies.touch_cooldown[i] = attack_cooldown_for_kind(kind);
+            enemies.attack_timer[i] = 0.22f;
 
             if (!godmode_enabled) {
-                hp -= attack_damage_for_kind(e->kind);
+                hp -= attack_damage_for_kind(kind);
                 player_damage_timer = 0.30f;
                 if (hp <= 0) {
                     hp = 0;
@@ -201,4 +844,19 @@ void update_enemies(float dt)
             }
         }
     }
+
+    for (int i = 0; i < enemies.count; i++) {
+        if (step_move[i]) apply_step(i, step_x[i], step_y[i]);
+    }
+
+    /* Removing an enemy moves the last one into slot i, so i only advances
+     * past enemies that stay. */
+    for (int i = 0; i < enemies.count; ) {
+        if (enemies.state[i] == ENEMY_DYING && enemies.dying_timer[i] <= 0.0f) {
+            enemies.state[i] = ENEMY_DEAD;
+            remove_enemy(i);
+            continue;
+        }
+        i++;
+    }
 }
@@ -1,7 +1,7 @@
 #ifndef ENEMY_H
 #define ENEMY_H
 
-#define MAX_ENEMIES 64
+#include <SDL2/SDL.h>
 
 typedef enum {
     ENEMY_ALIVE = 0,
@@ -9,6 +9,14 @@ typedef enum {
     ENEMY_DEAD  = 2
 } EnemyState;
 
+/* AI level of detail; see enemies_set_lod_tiers(). */
+typedef enum {
+    ENEMY_LOD_NEAR = 0,         /* every update */
+    ENEMY_LOD_MID,              /* every few updates */
+    ENEMY_LOD_FAR,              /* dormant */
+    ENEMY_LOD_COUNT
+} EnemyLod;
+
 typedef enum {
     ENEMY_KIND1 = 0,
     ENEMY_KIND2 = 1,
@@ -16,24 +24,88 @@ typedef enum {
     ENEMY_FINALBOSS = 3
 } EnemyKind;
 
+/*
+ * Enemies are stored as a structure of arrays: entry i of every array
+ * belongs to the same enemy and entries 0..count-1 are in use. The arrays
+ * grow as needed. An enemy that reaches ENEMY_DEAD is swap-removed (the
+ * last entry moves into its place), so an index is only good until the
+ * next update_enemies(). To refer to an enemy across frames, keep its
+ * EnemyHandle; enemy_lookup() gives the current index, or -1 once the
+ * enemy is gone.
+ */
+typedef Uint32 EnemyHandle;     /* 0 = no enemy */
+
 typedef struct {
-    float x, y;
-    EnemyState state;
-    EnemyKind kind;
-    int hp;
+    int count;
+    int capacity;
+
+    float *x, *y;
+    float *prev_x, *prev_y;     /* position before the last update, for drawing */
+    int *hp;
+    Uint8 *state;               /* EnemyState */
+    Uint8 *kind;                /* EnemyKind */
 
-    float touch_cooldown;   /* seconds until next melee hit */
-    float dying_timer;      /* seconds remaining in dying animation */
-    float attack_timer;     /* seconds remaining to display attack sprite */
-} Enemy;
+    float *touch_cooldown;      /* seconds until next melee hit */
+    float *dying_timer;         /* seconds remaining in dying animation */
+    float *attack_timer;        /* seconds remaining to display attack sprite */
 
-extern Enemy enemies[MAX_ENEMIES];
-extern int enemy_count;
+    EnemyHandle *handle;
+} EnemyPool;
 
+extern EnemyPool enemies;
+
+/* Replace the pool with the spawns found in the current map. */
 void init_enemies(void);
+
+/* Remove every enemy (memory is kept) / release the pool's memory. */
+void enemies_clear(void);
+void enemies_shutdown(void);
+
+/* Add a full-health ALIVE enemy. Returns its index, or -1 if out of
+ * memory. */
+int enemy_spawn(EnemyKind kind, float x, float y);
+
+/* Rebuild the spatial index and boss count after fields were changed
+ * directly (e.g. restored from a save). */
+void enemies_reindex(void);
+
+EnemyHandle enemy_handle(int i);
+int enemy_lookup(EnemyHandle h);
+
+/* Count down timers, chase the player along the flow field (flowfield.h)
+ * or, for bosses, towards their tactical targets (boss.h), and apply melee
+ * hits. Runs the
+ * enemies through the widest SIMD kernel the CPU has; results are the same
+ * as the scalar kernel's. Distant enemies are updated less often, see
+ * enemies_set_lod_tiers(). */
 void update_enemies(float dt);
+
+/* Name of the update kernel in use ("AVX2", "SSE2" or "SCALAR"). */
+const char *enemy_kernel_name(void);
+
+/* Use the SIMD kernels when available (default) or force the scalar one. */
+void enemies_set_simd(int enabled);
+
+/* AI level of detail. Each update puts every ALIVE enemy in a tier by the
+ * number of steps it has to walk to the player:
+ *   NEAR: at most near_tiles steps, or inside the player's view with no
+ *         opaque tile in between; updated every time;
+ *   MID:  at most far_tiles steps; updated every mid_interval-th time
+ *         with all the time since its last update;
+ *   FAR:  further or cut off; dormant, and only looked at again once the
+ *         player enters another tile or the tiles change.
+ * Dying enemies always count as NEAR. Defaults are 8, 20 and 4; with LOD
+ * off (enemies_set_lod(0)) every enemy is NEAR. */
+void enemies_set_lod(int enabled);
+void enemies_set_lod_tiers(int near_tiles, int far_tiles, int mid_interval);
+
+/* Enemies in each tier at the last update_enemies(). */
+void enemy_lod_counts(int counts[ENEMY_LOD_COUNT]);
 void damage_enemy(int i, int dmg);
 
+/* Health a new enemy of this kind starts with. */
+int enemy_max_hp(EnemyKind kind);
+
 /* Returns 1 if any miniboss/final boss is still alive on this map. */
 int enemy_boss_alive(void);
 
@@ -0,0 +1,235 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flowfield.h"
+#include "map.h"
+#include "trace.h"
+
+/* dist[] values besides step counts. */
+#define FLOW_UNREACHED -1
+#define FLOW_BLOCKED   -2
+
+/* One field. The arrays have a blocked border one tile wide around the
+ * map, so the search needs no bounds checks; a map tile (x, y) is entry
+ * (y + 1) * stride + x + 1. */
+typedef struct {
+    int source;         /* entry the field leads to, -1 = no field */
+    Uint32 revision;    /* map_revision the field was built on */
+    int *dist;          /* steps to source, or FLOW_UNREACHED / FLOW_BLOCKED */
+    int *next;          /* neighbour one step closer, -1 at the source */
+} Field;
+
+/* Enemies steer by fields[live] while the other one is rebuilt, a budget
+ * of tiles per update at a time, and the two swap once it is done. */
+typedef struct {
+    int w, h;           /* map tiles, copied from the map when allocated */
+    int stride;         /* w + 2 */
+    Field fields[2];
+    int live;
+    int *queue;         /* BFS queue, one entry per tile */
+
+    int building;       /* fields[!live] holds a rebuild in progress */
+    int row;            /* next map row it has to mark walls in */
+    int started;        /* the search from its source has begun */
+    int head, tail;     /* queue range still to expand */
+} FlowState;
+
+static FlowState flow = { 0, 0, 0, { { -1, 0, NULL, NULL }, { -1, 0, NULL, NULL } }, 0, NULL, 0, 0, 0, 0, 0 };
+
+static int budget = FLOW_DEFAULT_BUDGET;
+
+void flowfield_set_budget(int tiles)
+{
+    budget = tiles < 1 ? 1 : tiles;
+}
+
+void flowfield_shutdown(void)
+{
+    for (int i = 0; i < 2; i++) {
+        free(flow.fields[i].dist);
+        free(flow.fields[i].next);
+    }
+    free(flow.queue);
+    memset(&flow, 0, sizeof flow);
+    flow.fields[0].source = -1;
+    flow.fields[1].source = -1;
+}
+
+static int field_alloc(int w, int h)
+{
+    flowfield_shutdown();
+
+    size_t n = (size_t)(w + 2) * (size_t)(h + 2);
+    int ok = 1;
+    for (int i = 0; i < 2; i++) {
+        Field *f = &flow.fields[i];
+        f->dist = (int *)malloc(n * sizeof *f->dist);
+        f->next = (int *)malloc(n * sizeof *f->next);
+        if (!f->dist || !f->next) ok = 0;
+    }
+    flow.queue = (int *)malloc(n * sizeof *flow.queue);
+    if (!ok || !flow.queue) {
+        flowfield_shutdown();
+        return -1;
+    }
+    flow.w = w;
+    flow.h = h;
+    flow.stride = w + 2;
+
+    for (int i = 0; i < 2; i++)
+        for (size_t k = 0; k < n; k++) flow.fields[i].dist[k] = FLOW_BLOCKED;
+    return 0;
+}
+
+static void build_begin(int src)
+{
+    Field *f = &flow.fields[!flow.live];
+    f->source = src;
+    f->revision = map_revision;
+    flow.building = 1;
+    flow.row = 0;
+    flow.started = 0;
+    flow.head = 0;
+    flow.tail = 0;
+}
+
+/* Carry the rebuild on for about n tiles. Returns 1 once it is done. */
+static int build_step(int n)
+{
+    Field *f = &flow.fields[!flow.live];
+    const int s = flow.stride;
+    /* Orthogonal neighbours first, so ties prefer straight steps. */
+    const int step[8] = { 1, -1, s, -s, s + 1, -s + 1, s - 1, -s - 1 };
+    /* The two orthogonal entries a diagonal step squeezes between. */
+    const int side_x[8] = { 0, 0, 0, 0, 1, 1, -1, -1 };
+    const int side_y[8] = { 0, 0, 0, 0, s, -s, s, -s };
+
+    int *dist = f->dist;
+    int *next = f->next;
+    int *queue = flow.queue;
+
+    /* Walls are marked up front so the search itself only touches the
+     * flat arrays. The border stays FLOW_BLOCKED from field_alloc(). */
+    for (; flow.row < flow.h; flow.row++) {
+        if (n <= 0) return 0;
+        const Uint16 *row = worldmap + flow.row * worldStride;
+        int *d = dist + (flow.row + 1) * s + 1;
+        for (int x = 0; x < flow.w; x++)
+            d[x] = tile_is(row[x], TILE_SOLID) ? FLOW_BLOCKED : FLOW_UNREACHED;
+        n -= flow.w;
+    }
+
+    if (!flow.started) {
+        flow.started = 1;
+        if (dist[f->source] == FLOW_BLOCKED) return 1;
+        dist[f->source] = 0;
+        next[f->source] = -1;
+        queue[0] = f->source;
+        flow.tail = 1;
+    }
+
+    int head = flow.head, tail = flow.tail;
+    while (head < tail) {
+        if (n-- <= 0) break;
+        int c = queue[head++];
+        int d = dist[c] + 1;
+
+        for (int k = 0; k < 8; k++) {
+            int id = c + step[k];
+            if (dist[id] != FLOW_UNREACHED) continue;
+            /* A diagonal step needs both tiles it squeezes between open. */
+            if (k >= 4 && (dist[c + side_x[k]] == FLOW_BLOCKED || dist[c + side_y[k]] == FLOW_BLOCKED))
+                continue;
+
+            dist[id] = d;
+            next[id] = c;
+            queue[tail++] = id;
+        }
+    }
+    flow.head = head;
+    flow.tail = tail;
+    return head == tail;
+}
+
+int flowfield_update(float x, float y)
+{
+    if (!worldmap || worldWidth <= 0 || worldHeight <= 0) {
+        flow.fields[flow.live].source = -1;
+        flow.building = 0;
+        return 0;
+    }
+
+    if (!flow.queue || flow.w != worldWidth || flow.h != worldHeight) {
+        if (field_alloc(worldWidth, worldHeight) != 0) return -1;
+    }
+
+    Field *live = &flow.fields[flow.live];
+    int tx = (int)floorf(x), ty = (int)floorf(y);
+    if (tx < 0 || ty < 0 || tx >= flow.w || ty >= flow.h) {
+        live->source = -1;
+        flow.building = 0;
+        return 0;
+    }
+
+    int src = (ty + 1) * flow.stride + tx + 1;
+    if (src == live->source && live->revision == map_revision) {
+        flow.building = 0;
+        return 0;
+    }
+
+    /* A rebuild for a tile the player has since left still finishes (the
+     * player could otherwise outrun it); one on old tiles starts over. */
+    if (flow.building && flow.fields[!flow.live].revision != map_revision)
+        flow.building = 0;
+    if (!flow.building)
+        build_begin(src);
+
+    /* With no field at all yet there is nothing to steer by meanwhile. */
+    int n = live->source < 0 ? INT_MAX : budget;
+    int done;
+    TRACE_SCOPE("flowfield_build", done = build_step(n));
+    if (done) {
+        flow.live = !flow.live;
+        flow.building = 0;
+    }
+    return 0;
+}
+
+int flowfield_rebuilding(void)
+{
+    return flow.building;
+}
+
+/* Field entry for the tile holding (x, y), or -1 when off the field. */
+static int entry_at(float x, float y)
+{
+    if (flow.fields[flow.live].source < 0) return -1;
+    int tx = (int)floorf(x), ty = (int)floorf(y);
+    if (tx < 0 || ty < 0 || tx >= flow.w || ty >= flow.h) return -1;
+    return (ty + 1) * flow.stride + tx + 1;
+}
+
+void flowfield_aim(float x, float y, float tx, float ty, float *ax, float *ay)
+{
+    *ax = tx;
+    *ay = ty;
+
+    /* Within one step the straight line to the player is clear. */
+    const Field *f = &flow.fields[flow.live];
+    int c = entry_at(x, y);
+    if (c < 0 || f->dist[c] <= 1) return;
+
+    int n = f->next[c];
+    *ax = (float)(n % flow.stride - 1) + 0.5f;
+    *ay = (float)(n / flow.stride - 1) + 0.5f;
+}
+
+int flowfield_distance(int x, int y)
+{
+    const Field *f = &flow.fields[flow.live];
+    if (f->source < 0 || x < 0 || y < 0 || x >= flow.w || y >= flow.h) return -1;
+    int d = f->dist[(y + 1) * flow.stride + x + 1];
+    return d < 0 ? -1 : d;
+}
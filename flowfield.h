@@ -0,0 +1,51 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+/*
+ * Flow field towards the player.
+ *
+ * A breadth-first search from the player's tile over the tiles enemies can
+ * walk on (not TILE_SOLID) gives every reachable tile its number of steps to
+ * the player and the neighbouring tile one step closer. Steps go to the 8
+ * neighbours, but never diagonally past a wall corner. Enemies look up
+ * their own tile to find where to head, so steering costs the same however
+ * many enemies there are. The field is only rebuilt when the player enters
+ * another tile or the tiles change (map_revision).
+ *
+ * A rebuild scans at most a budget of tiles per update. The old field stays
+ * in use until the new one is complete, so on a large map enemies steer
+ * towards where the player was a few updates ago rather than the game
+ * stalling on every tile the player crosses. Marking a tile and expanding
+ * one both count against the budget, so maps of up to about half the
+ * budget in tiles (all the level maps) are still rebuilt within the
+ * update.
+ */
+
+/* Tiles a rebuild may scan per update unless flowfield_set_budget() says
+ * otherwise. */
+#define FLOW_DEFAULT_BUDGET 32768
+
+/* Bring the field up to date for a player at (x, y). Returns 0 on success,
+ * -1 if out of memory (the field is then empty and every enemy chases the
+ * player directly). */
+int flowfield_update(float x, float y);
+
+/* Tiles a rebuild may scan per update (at least 1). The first field after
+ * a map is loaded is always built in one go. */
+void flowfield_set_budget(int tiles);
+
+/* 1 while a rebuild is spread over updates (the field in use is stale). */
+int flowfield_rebuilding(void);
+
+/* Release the field (called when the map is freed). */
+void flowfield_shutdown(void);
+
+/* Point an enemy at (x, y) should walk towards to reach the player at
+ * (tx, ty): the centre of the next tile on its path, or the player itself
+ * once the enemy is within one step or has no path. */
+void flowfield_aim(float x, float y, float tx, float ty, float *ax, float *ay);
+
+/* Steps from tile (x, y) to the player's tile, or -1 if unreachable. */
+int flowfield_distance(int x, int y);
+
+#endif /* FLOWFIELD_H */
@@ -4,6 +4,8 @@
 #include <string.h>
 
 #include "font.h"
+#include "render.h"
+#include "trace.h"
 
 /*
  * Parse a BMFont text file to extract character metrics.  The file
@@ -61,7 +63,7 @@ static int parse_fnt(const char *path, BitmapFont *font)
     return 0;
 }
 
-int load_font(SDL_Renderer *renderer, const char *bmpFile, const char *fntFile, BitmapFont *font)
+static int load_font_files(SDL_Renderer *renderer, const char *bmpFile, const char *fntFile, BitmapFont *font)
 {
     if (!renderer || !bmpFile || !fntFile || !font)
         return -1;
@@ -103,6 +105,14 @@ int load_font(SDL_Renderer *renderer, const char *bmpFile, const char *fntFile,
     return 0;
 }
 
+int load_font(SDL_Renderer *renderer, const char *bmpFile, const char *fntFile, BitmapFont *font)
+{
+    trace_begin_detail("load_font", fntFile);
+    int rc = load_font_files(renderer, bmpFile, fntFile, font);
+    trace_end("load_font");
+    return rc;
+}
+
 void draw_text(SDL_Renderer *renderer, BitmapFont *font, int x, int y, const char *text, float scale)
 {
     if (!renderer || !font || !font->texture || !text)
@@ -133,8 +143,10 @@ void draw_text(SDL_Renderer *renderer, BitmapFont *font, int x, int y, const cha
         /* Some BMFont exports may omit metrics for certain characters
          * (notably space).  Render if we have a non-zero glyph size.
          */
-        if (src.w > 0 && src.h > 0)
+        if (src.w > 0 && src.h > 0) {
             SDL_RenderCopy(renderer, font->texture, &src, &dst);
+            render_stats.draw_calls++;
+        }
 
         int adv = font->chars[c].xadvance;
         if (adv <= 0) {
@@ -14,6 +14,13 @@
 #include "audio.h"
 #include "savegame.h"
 #include "config.h"
+#include "swrender.h"
+#include "pacing.h"
+#include "profiler.h"
+#include "trace.h"
+#include "timestep.h"
+#include "input.h"
+#include "hitscan.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -92,8 +99,13 @@ static GameState slot_return_state = STATE_MENU;
 static char cheat_buf[16] = "";
 static int cheat_len = 0;
 
+/* Input journal given on the command line (see input.h). */
+static const char *record_path = NULL;  /* record from the next new game */
+static const char *replay_path = NULL;  /* play when the loop starts */
+
 /* Forward declarations */
 static void refresh_slot_meta(void);
+static int  loads_locked(void);
 static int  load_slot_and_enter(int slot, SDL_Window *win, SDL_Renderer *renderer);
 static int  save_current_to_slot(int slot);
 static void begin_new_game(int startLevel, SDL_Window *win, SDL_Renderer *renderer);
@@ -136,6 +148,8 @@ static void apply_fullscreen(SDL_Window *win, SDL_Renderer *renderer, int enable
 
 static void toggle_fullscreen(SDL_Window *win, SDL_Renderer *renderer)
 {
+    if (!win) return;
+
     Uint32 flags = SDL_GetWindowFlags(win);
     int currently_fs = ((flags & SDL_WINDOW_FULLSCREEN_DESKTOP) || (flags & SDL_WINDOW_FULLSCREEN)) ? 1 : 0;
     apply_fullscreen(win, renderer, !currently_fs);
@@ -145,6 +159,54 @@ static void toggle_fullscreen(SDL_Window *win, SDL_Renderer *renderer)
     (void)config_save();
 }
 
+static void toggle_render_path(void)
+{
+    int sw = (render_get_path() != RENDER_PATH_SOFTWARE);
+    render_set_path(sw ? RENDER_PATH_SOFTWARE : RENDER_PATH_SDL);
+    show_message(sw ? "RENDERER: SOFTWARE" : "RENDERER: SDL");
+
+    /* Persist */
+    config_set_software_renderer(sw);
+    (void)config_save();
+}
+
+/* F8: start a trace capture next to the executable, or stop and write the
+ * running one. */
+static void toggle_trace(void)
+{
+    if (trace_enabled()) {
+        show_message(trace_finish() == 0 ? "TRACE SAVED" : "TRACE FAILED");
+        return;
+    }
+
+    char path[512];
+    char *base = SDL_GetBasePath();
+    if (base) {
+        snprintf(path, sizeof path, "%strace_%u.json", base, (unsigned)SDL_GetTicks());
+        SDL_free(base);
+    } else {
+        snprintf(path, sizeof path, "trace_%u.json", (unsigned)SDL_GetTicks());
+    }
+
+    trace_capture(path, 0);
+    show_message("TRACE STARTED");
+}
+
+static void toggle_floor_mode(void)
+{
+    int cast = (swr_get_floor_mode() != SWR_FLOOR_CAST);
+    swr_set_floor_mode(cast ? SWR_FLOOR_CAST : SWR_FLOOR_STRETCH);
+
+    char msg[64];
+    if (cast) snprintf(msg, sizeof msg, "FLOOR: CAST (%s)", swr_floor_kernel_name());
+    else snprintf(msg, sizeof msg, "FLOOR: STRETCH");
+    show_message(msg);
+
+    /* Persist */
+    config_set_floor_casting(cast);
+    (void)config_save();
+}
+
 static void adjust_sensitivity(int dir)
 {
     const float step = 0.0005f;
@@ -163,9 +225,20 @@ static void apply_config_to_runtime(SDL_Window *win, SDL_Renderer *renderer)
     /* Video */
     apply_fullscreen(win, renderer, config_get_fullscreen());
 
+    /* Renderer */
+    render_set_path(config_get_software_renderer() ? RENDER_PATH_SOFTWARE : RENDER_PATH_SDL);
+    swr_set_floor_mode(config_get_floor_casting() ? SWR_FLOOR_CAST : SWR_FLOOR_STRETCH);
+    swr_set_thread_count(config_get_render_threads());
+    pacing_configure(win, renderer, config_get_target_fps(), config_get_vsync());
+
     /* Input */
     mouse_sensitivity = config_get_mouse_sensitivity();
 
+    /* AI */
+    enemies_set_lod(config_get_ai_lod());
+    enemies_set_lod_tiers(config_get_ai_near_tiles(), config_get_ai_far_tiles(),
+                          config_get_ai_mid_interval());
+
     /* Audio */
     audio_set_master_volume(config_get_master_volume());
     audio_set_bgm_volume(config_get_bgm_volume());
@@ -222,13 +295,17 @@ static void ui_notice(const char *text, Uint32 ms)
     strncpy(menu_notice, text, sizeof menu_notice - 1);
     menu_notice[sizeof menu_notice - 1] = '\0';
     menu_notice_end_time = (ms == 0) ? 0 : (SDL_GetTicks() + ms);
+
+    /* Static screens must redraw to show and to clear the notice. */
+    pacing_invalidate();
+    pacing_redraw_at(menu_notice_end_time);
 }
 
 static void refresh_slot_meta(void)
 {
     for (int i = 0; i < 3; i++) {
         SaveMeta m;
-        if (savegame_peek(i + 1, &m) == 0 && m.exists) {
+        if (!loads_locked() && savegame_peek(i + 1, &m) == 0 && m.exists) {
             slot_meta[i] = m;
         } else {
             memset(&slot_meta[i], 0, sizeof slot_meta[i]);
@@ -237,6 +314,11 @@ static void refresh_slot_meta(void)
     }
 }
 
+#define SHOTGUN_PELLETS 6
+#define SHOTGUN_SPREAD 0.1f     /* radians either side of the aim */
+
+/* Damage per shot. The shotgun's is dealt a point per pellet hit, centre
+ * pellets first, until it is used up. */
 static int weapon_damage(WeaponType w)
 {
     switch (w) {
@@ -249,11 +331,23 @@ static int weapon_damage(WeaponType w)
     }
 }
 
-static int weapon_hitbox_size(WeaponType w)
+/* The rays one shot of weapon w fires from the view direction: a spread of
+ * pellets for the shotgun, ordered from the aim outwards, one ray otherwise.
+ * Returns how many. */
+static int weapon_rays(WeaponType w, HitscanRay *rays)
 {
-    if (w == WEAPON_SHOTGUN) return 280;
-    if (w == WEAPON_RRG) return 230;
-    return 200;
+    if (w != WEAPON_SHOTGUN) {
+        rays[0].angle = angle;
+        return 1;
+    }
+
+    for (int k = 0; k < SHOTGUN_PELLETS; k++) {
+        int ring = (SHOTGUN_PELLETS & 1) ? (k + 1) / 2 : k / 2;
+        float f = (float)(2 * ring + !(SHOTGUN_PELLETS & 1)) / (float)(SHOTGUN_PELLETS - 1);
+        if (k & 1) f = -f;
+        rays[k].angle = angle + f * SHOTGUN_SPREAD;
+    }
+    return SHOTGUN_PELLETS;
 }
 
 static void build_ammo_string(char *out, size_t out_sz)
@@ -288,9 +382,11 @@ static void build_ammo_string(char *out, size_t out_sz)
     }
 }
 
-static void snapshot_current(SaveGame *sg)
+/* Fill sg from the running game. Returns 0 on success, -1 if the entity
+ * arrays could not be allocated. Release with savegame_free(). */
+static int snapshot_current(SaveGame *sg)
 {
-    if (!sg) return;
+    if (!sg) return -1;
     memset(sg, 0, sizeof *sg);
 
     sg->version = SAVEGAME_VERSION;
@@ -315,34 +411,54 @@ static void snapshot_current(SaveGame *sg)
 
     sg->sensitivity = mouse_sensitivity;
 
-    sg->enemy_count = enemy_count;
-    if (sg->enemy_count < 0) sg->enemy_count = 0;
-    if (sg->enemy_count > MAX_ENEMIES) sg->enemy_count = MAX_ENEMIES;
+    /* Dead enemies and collected items are already gone from the pools,
+     * so the save lists exactly what is left. */
+    sg->has_entities = 1;
+    if (savegame_alloc(sg, enemies.count, items.count) != 0)
+        return -1;
+
     for (int i = 0; i < sg->enemy_count; i++) {
-        sg->enemy_x[i] = enemies[i].x;
-        sg->enemy_y[i] = enemies[i].y;
-        sg->enemy_kind[i] = (int)enemies[i].kind;
-        sg->enemy_state[i] = (int)enemies[i].state;
-        sg->enemy_hp[i] = enemies[i].hp;
-        sg->enemy_dying_timer[i] = enemies[i].dying_timer;
+        sg->enemy_x[i] = enemies.x[i];
+        sg->enemy_y[i] = enemies.y[i];
+        sg->enemy_kind[i] = (int)enemies.kind[i];
+        sg->enemy_state[i] = (int)enemies.state[i];
+        sg->enemy_hp[i] = enemies.hp[i];
+        sg->enemy_dying_timer[i] = enemies.dying_timer[i];
     }
 
-    sg->item_count = item_count;
-    if (sg->item_count < 0) sg->item_count = 0;
-    if (sg->item_count > MAX_ITEMS) sg->item_count = MAX_ITEMS;
     for (int i = 0; i < sg->item_count; i++) {
-        sg->item_x[i] = items[i].x;
-        sg->item_y[i] = items[i].y;
-        sg->item_type[i] = (int)items[i].type;
-        sg->item_collected[i] = items[i].collected ? 1 : 0;
+        sg->item_x[i] = items.x[i];
+        sg->item_y[i] = items.y[i];
+        sg->item_type[i] = (int)items.type[i];
+        sg->item_collected[i] = 0;
     }
+    return 0;
+}
+
+/* Replays and scripted runs play someone else's game: keep them off the
+ * player's save slots. */
+static int saves_locked(void)
+{
+    return input_mode() == INPUT_REPLAYING || input_mode() == INPUT_SCRIPTED;
+}
+
+/* A loaded save comes from whatever is on disk, which a journal does not
+ * carry: loading is off while recording too, so a replay refuses the same
+ * loads its recording did. */
+static int loads_locked(void)
+{
+    return saves_locked() || input_mode() == INPUT_RECORDING;
 }
 
 static int save_current_to_slot(int slot)
 {
     SaveGame sg;
-    snapshot_current(&sg);
-    if (savegame_write(slot, &sg) != 0) return -1;
+    if (snapshot_current(&sg) != 0) return -1;
+
+    /* Act as if saved so the menus go the same way as when recorded. */
+    int rc = saves_locked() ? 0 : savegame_write(slot, &sg);
+    savegame_free(&sg);
+    if (rc != 0) return -1;
     active_slot = slot;
     refresh_slot_meta();
     return 0;
@@ -382,7 +498,7 @@ static int save_progress_to_slot(int slot)
     sg.enemy_count = 0;
     sg.item_count = 0;
 
-    if (savegame_write(slot, &sg) != 0) return -1;
+    if (!saves_locked() && savegame_write(slot, &sg) != 0) return -1;
     active_slot = slot;
     refresh_slot_meta();
     return 0;
@@ -402,7 +518,7 @@ static void apply_player_pos_safely(float in_x, float in_y, float in_angle)
         int tx = (int)nx;
         int ty = (int)ny;
         if (tx < 0 || ty < 0 || tx >= worldWidth || ty >= worldHeight) ok = 0;
-        else if (worldmap[ty][tx] >= 2) ok = 0; /* wall/door */
+        else if (map_is(tx, ty, TILE_SOLID)) ok = 0; /* wall/door */
     }
 
     if (!ok) {
@@ -418,6 +534,8 @@ static void apply_player_pos_safely(float in_x, float in_y, float in_angle)
     const float two_pi = (float)(M_PI * 2.0);
     if (angle >= two_pi || angle <= -two_pi) angle = fmodf(angle, two_pi);
     if (angle < 0.0f) angle += two_pi;
+
+    player_snap_view();
 }
 
 static WeaponType sanitize_weapon(int w)
@@ -436,6 +554,11 @@ static WeaponType sanitize_weapon(int w)
 
 static int load_slot_and_enter(int slot, SDL_Window *win, SDL_Renderer *renderer)
 {
+    if (loads_locked()) {
+        ui_notice("NO LOADING WHILE RECORDING", 1600);
+        return -1;
+    }
+
     SaveGame sg;
     if (savegame_read(slot, &sg) != 0) {
         ui_notice("SAVE SLOT IS EMPTY", 1600);
@@ -492,52 +615,37 @@ static int load_slot_and_enter(int slot, SDL_Window *win, SDL_Renderer *renderer
 
     apply_player_pos_safely(sg.px, sg.py, sg.angle);
 
-    /* Restore enemies (best-effort). */
-    int nE = sg.enemy_count;
-    if (nE > enemy_count) nE = enemy_count;
-    if (nE > MAX_ENEMIES) nE = MAX_ENEMIES;
-    for (int i = 0; i < nE; i++) {
-        enemies[i].x = sg.enemy_x[i];
-        enemies[i].y = sg.enemy_y[i];
-
-        int k = sg.enemy_kind[i];
-        if (k < 0) k = 0;
-        if (k > 3) k = 0;
-        enemies[i].kind = (EnemyKind)k;
-
-        int st = sg.enemy_state[i];
-        if (st < (int)ENEMY_ALIVE) st = (int)ENEMY_ALIVE;
-        if (st > (int)ENEMY_DEAD) st = (int)ENEMY_DEAD;
-        enemies[i].state = (EnemyState)st;
-
-        enemies[i].hp = sg.enemy_hp[i];
-        if (enemies[i].hp < 0) enemies[i].hp = 0;
-
-        enemies[i].touch_cooldown = 0.0f;
-        enemies[i].attack_timer = 0.0f;
-        enemies[i].dying_timer = sg.enemy_dying_timer[i];
-        if (enemies[i].state != ENEMY_DYING) enemies[i].dying_timer = 0.0f;
-    }
+    /* Replace the map's spawns with what the save lists (progress saves
+     * keep the spawns). Older saves still list dead enemies and collected
+     * items; those are skipped. */
+    if (sg.has_entities) {
+        enemies_clear();
+        for (int si = 0; si < sg.enemy_count; si++) {
+            int st = sg.enemy_state[si];
+            if (st < (int)ENEMY_ALIVE) st = (int)ENEMY_ALIVE;
+            if (st >= (int)ENEMY_DEAD) continue;
+
+            int k = sg.enemy_kind[si];
+            if (k < 0) k = 0;
+            if (k > 3) k = 0;
+
+            int i = enemy_spawn((EnemyKind)k, sg.enemy_x[si], sg.enemy_y[si]);
+            if (i < 0) break;
+
+            enemies.state[i] = (Uint8)st;
+            enemies.hp[i] = sg.enemy_hp[si];
+            if (enemies.hp[i] < 0) enemies.hp[i] = 0;
+            if (st == (int)ENEMY_DYING) enemies.dying_timer[i] = sg.enemy_dying_timer[si];
+        }
+        enemies_reindex();
 
-    /* Restore items (match by type+position). */
-    int nI = sg.item_count;
-    if (nI > MAX_ITEMS) nI = MAX_ITEMS;
-    for (int si = 0; si < nI; si++) {
-        int stype = sg.item_type[si];
-        float sx = sg.item_x[si];
-        float sy = sg.item_y[si];
-        int scol = sg.item_collected[si] ? 1 : 0;
-
-        for (int li = 0; li < item_count; li++) {
-            if ((int)items[li].type != stype) continue;
-            float dx = items[li].x - sx;
-            float dy = items[li].y - sy;
-            if (dx*dx + dy*dy < 0.01f) {
-                items[li].collected = scol;
-                break;
-            }
+        items_clear();
+        for (int si = 0; si < sg.item_count; si++) {
+            if (sg.item_collected[si] || !item_type_valid(sg.item_type[si])) continue;
+            if (item_spawn((ItemType)sg.item_type[si], sg.item_x[si], sg.item_y[si]) < 0) break;
         }
     }
+    savegame_free(&sg);
 
     state = STATE_PLAYING;
 
@@ -549,11 +657,30 @@ static int load_slot_and_enter(int slot, SDL_Window *win, SDL_Renderer *renderer
     return 0;
 }
 
+/* Start the journal asked for with --record, once the level is known. */
+static void start_recording(int level)
+{
+    InputJournalHeader h;
+    h.level = level;
+    h.seed = (Uint32)SDL_GetPerformanceCounter();
+    h.mouse_sensitivity = mouse_sensitivity;
+    h.ai_lod = config_get_ai_lod();
+    h.ai_near_tiles = config_get_ai_near_tiles();
+    h.ai_far_tiles = config_get_ai_far_tiles();
+    h.ai_mid_interval = config_get_ai_mid_interval();
+
+    if (input_record_start(record_path, &h) == 0)
+        srand(h.seed);
+    record_path = NULL;
+}
+
 static void begin_new_game(int startLevel, SDL_Window *win, SDL_Renderer *renderer)
 {
     (void)renderer;
     if (startLevel < 1) startLevel = 1;
     if (startLevel > 9) startLevel = 9;
+    if (record_path && input_mode() == INPUT_LIVE)
+        start_recording(startLevel);
     currentLevel = startLevel;
     active_slot = 1;
     cutscene_index = 0;
@@ -605,6 +732,7 @@ void show_message(const char *text)
     strncpy(message_text, text, sizeof message_text - 1);
     message_text[sizeof message_text - 1] = '\0';
     message_end_time = SDL_GetTicks() + 2000;
+    pacing_invalidate();
 }
 
 static void cheat_feed_char(char c)
@@ -636,24 +764,8 @@ static void cheat_feed_char(char c)
     }
 }
 
-void game_loop(SDL_Window *win, SDL_Renderer *renderer)
+void game_load_assets(SDL_Renderer *renderer)
 {
-    SDL_Event e;
-    int running = 1;
-    Uint32 lastTick = SDL_GetTicks();
-
-    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
-    if (renderer) {
-        SDL_RenderSetLogicalSize(renderer, W, H);
-        SDL_RenderSetIntegerScale(renderer, SDL_TRUE);
-    }
-
-    /* Load/create persistent config (DATA/config/config.json) and apply it. */
-    (void)config_load_or_create();
-    apply_config_to_runtime(win, renderer);
-
-    (void)audio_init();
-
     load_textures(renderer);
 
     if (load_font(renderer, "pixel.bmp", "pixel.fnt", &fontPixel) != 0) {
@@ -661,761 +773,986 @@ void game_loop(SDL_Window *win, SDL_Renderer *renderer)
     }
     fontMenu = fontPixel;
     fontNumbers = fontPixel;
+}
 
-    state = STATE_MENU;
-    free_map();
-    item_count = 0;
-    enemy_count = 0;
+void game_start_level(int level)
+{
+    begin_new_game(level, NULL, NULL);
+}
 
-    SDL_StartTextInput();
+void game_record_to(const char *path)
+{
+    record_path = path;
+}
 
-    while (running) {
-        /* Toggle mouse capture depending on state */
-        static int mouse_lock = -1;
-        int want_lock = (state == STATE_PLAYING);
-        if (want_lock != mouse_lock) {
-            SDL_SetRelativeMouseMode(want_lock ? SDL_TRUE : SDL_FALSE);
-            SDL_ShowCursor(want_lock ? SDL_DISABLE : SDL_ENABLE);
-            mouse_lock = want_lock;
+void game_replay_from(const char *path)
+{
+    replay_path = path;
+}
+
+int game_start_replay(const char *path)
+{
+    InputJournalHeader h;
+    if (input_replay_start(path, &h) != 0) return -1;
+
+    mouse_sensitivity = h.mouse_sensitivity;
+    enemies_set_lod(h.ai_lod);
+    enemies_set_lod_tiers(h.ai_near_tiles, h.ai_far_tiles, h.ai_mid_interval);
+    srand(h.seed);
+
+    begin_new_game(h.level, NULL, NULL);
+    return currentLevel;
+}
+
+void game_render_playing(SDL_Renderer *renderer)
+{
+    PROF_SCOPE(PROF_WORLD, draw_world(renderer));
+    PROF_SCOPE(PROF_SPRITES, draw_sprites(renderer));
+
+    Uint64 hud_t0 = profiler_begin(PROF_HUD);
+    draw_hud(renderer);
+
+    char hpStr[32];
+    snprintf(hpStr, sizeof hpStr, "HP %d", hp);
+    draw_text(renderer, &fontPixel, 20, H - 112, hpStr, 2.0f);
+
+    char ammoStr[32];
+    build_ammo_string(ammoStr, sizeof ammoStr);
+    int aw = measure_text(&fontPixel, ammoStr, 2.0f);
+    draw_text(renderer, &fontPixel, W - 20 - aw, H - 112, ammoStr, 2.0f);
+
+    draw_gun(renderer);
+
+    if (SDL_GetTicks() < message_end_time && message_text[0]) {
+        draw_text(renderer, &fontPixel, 20, H - 160, message_text, 2.0f);
+    }
+    profiler_end(PROF_HUD, hud_t0);
+}
+
+/* One fixed step of gameplay (see timestep.h). */
+static void simulate_step(float dt)
+{
+    static int prev_player_dead = 0;
+
+    PROF_SCOPE(PROF_PLAYER, update_player(dt));
+    PROF_SCOPE(PROF_ENEMIES, update_enemies(dt));
+    PROF_SCOPE(PROF_ITEMS, update_items());
+
+    if (shot_fired) {
+        /* Play different sound depending on weapon type. */
+        SfxId sfx = SFX_GUN;
+        switch (current_weapon) {
+            case WEAPON_SHOTGUN:
+                sfx = SFX_SHOTGUN;
+                break;
+            case WEAPON_PLASMA:
+                sfx = SFX_PLASMA;
+                break;
+            case WEAPON_RRG:
+                sfx = SFX_RRG;
+                break;
+            default:
+                sfx = SFX_GUN;
+                break;
         }
+        audio_play_sfx(sfx);
+    }
 
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) {
-                running = 0;
-                continue;
-            }
+    if (!prev_player_dead && player_dead) {
+        audio_play_sfx(SFX_PLAYER_DIE);
+    }
+    prev_player_dead = player_dead;
+
+    if (shot_fired) {
+        HitscanRay rays[HITSCAN_MAX_RAYS];
+        int n = weapon_rays(current_weapon, rays);
+        hitscan_trace(px, py, rays, n);
+
+        int left = weapon_damage(current_weapon);
+        for (int k = 0; k < n && left > 0; k++) {
+            int i = rays[k].enemy;
+            if (i < 0 || enemies.state[i] != ENEMY_ALIVE) continue;
+            int dmg = n > 1 ? 1 : left;
+            damage_enemy(i, dmg);
+            left -= dmg;
+        }
+    }
 
-            if (e.type == SDL_TEXTINPUT) {
-                if (state == STATE_PLAYING && e.text.text[0]) {
-                    for (int i = 0; e.text.text[i]; i++) {
-                        cheat_feed_char(e.text.text[i]);
-                    }
-                }
-            }
+    if (escaped) {
+        escaped = 0;
 
-            if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
-                /* Alt+Enter toggles fullscreen (all states). */
-                if ((e.key.keysym.scancode == SDL_SCANCODE_RETURN || e.key.keysym.scancode == SDL_SCANCODE_KP_ENTER) &&
-                    (e.key.keysym.mod & KMOD_ALT)) {
-                    toggle_fullscreen(win, renderer);
-                    continue;
-                }
+        if (currentLevel < 9) {
+            /* Show cutscene currentLevel.bmp, then load next map. */
+            cutscene_index = currentLevel;
+            currentLevel++;
 
-                if (e.key.keysym.scancode == SDL_SCANCODE_F5) {
-                    toggle_fullscreen(win, renderer);
-                }
+            (void)save_progress_to_slot(active_slot);
+            audio_play_sfx(SFX_VICTORY);
 
-                if (state == STATE_MENU) {
-                    SDL_Scancode sc = e.key.keysym.scancode;
-                    if (sc == SDL_SCANCODE_UP) {
-                        if (menu_selection > 0) menu_selection--;
-                    } else if (sc == SDL_SCANCODE_DOWN) {
-                        if (menu_selection < 3) menu_selection++;
-                    } else if (sc == SDL_SCANCODE_RETURN) {
-                        if (menu_selection == 0) {
-                            episode_selection = 0;
-                            state = STATE_EPISODE_SELECT;
-                        } else if (menu_selection == 1) {
-                            refresh_slot_meta();
-                            slot_selection = 0;
-                            slot_return_state = STATE_MENU;
-                            state = STATE_LOADMENU;
-                        } else if (menu_selection == 2) {
-                            options_page = OPTPAGE_MAIN;
-                            opt_main_sel = 0;
-                            opt_audio_sel = 0;
-                            opt_keys_sel = 0;
-                            opt_capture_action = ACTION_COUNT;
-                            ui_notice("ARROWS: NAVIGATE", 0);
-                            state = STATE_OPTIONS;
-                        } else if (menu_selection == 3) {
-                            running = 0;
-                        }
-                    }
+            state = STATE_CUTSCENE;
+        } else {
+            state = STATE_END;
+            audio_bgm_set_enabled(0);
+            audio_play_sfx(SFX_ENDING);
+        }
+    }
+}
 
-                } else if (state == STATE_EPISODE_SELECT) {
-                    SDL_Scancode sc = e.key.keysym.scancode;
-                    if (sc == SDL_SCANCODE_UP) {
-                        if (episode_selection > 0) episode_selection--;
-                    } else if (sc == SDL_SCANCODE_DOWN) {
-                        if (episode_selection < 3) episode_selection++;
-                    } else if (sc == SDL_SCANCODE_ESCAPE) {
-                        state = STATE_MENU;
-                    } else if (sc == SDL_SCANCODE_RETURN) {
-                        if (episode_selection == 3) {
-                            state = STATE_MENU;
-                        } else {
-                            int startLevel = 1;
-                            if (episode_selection == 1) startLevel = 4;
-                            if (episode_selection == 2) startLevel = 7;
-                            begin_new_game(startLevel, win, renderer);
-                        }
-                    }
+/* Leave the cutscene for the level it leads to. */
+static void enter_next_level(void)
+{
+    free_map();
+    if (load_map(currentLevel) != 0) {
+        currentLevel = 1;
+        (void)load_map(currentLevel);
+    }
+    init_player();
+    init_enemies();
+    init_items();
+    hasKey = 0;
+    escaped = 0;
+    player_dead = 0;
+    player_damage_timer = 0.0f;
+    gun_recoil_timer = 0;
+    shot_fired = 0;
+    hp = 100;
+    state = STATE_PLAYING;
+}
 
-                } else if (state == STATE_OPTIONS) {
-                    SDL_Scancode sc = e.key.keysym.scancode;
+int game_step(void)
+{
+    if (state != STATE_PLAYING) return 0;
+    simulate_step(SIM_DT);
+    return state == STATE_PLAYING;
+}
 
-                    /* Key bind capture has priority. */
-                    if (options_page == OPTPAGE_BIND_CAPTURE) {
-                        if (sc == SDL_SCANCODE_ESCAPE) {
-                            options_page = OPTPAGE_KEYS;
-                            opt_capture_action = ACTION_COUNT;
-                            ui_notice("CANCELLED", 1200);
-                        } else {
-                            if (opt_capture_action < ACTION_COUNT) {
-                                SDL_Scancode old = config_get_bind(opt_capture_action);
-
-                                if (sc == SDL_SCANCODE_BACKSPACE || sc == SDL_SCANCODE_DELETE) {
-                                    config_set_bind(opt_capture_action, SDL_SCANCODE_UNKNOWN);
-                                    (void)config_save();
-                                    ui_notice("UNBOUND", 1200);
-                                } else {
-                                    /* Avoid duplicates by swapping if the key is already used. */
-                                    for (int a = 0; a < ACTION_COUNT; a++) {
-                                        if ((Action)a == opt_capture_action) continue;
-                                        if (config_get_bind((Action)a) == sc) {
-                                            config_set_bind((Action)a, old);
-                                            break;
-                                        }
-                                    }
-                                    config_set_bind(opt_capture_action, sc);
-                                    (void)config_save();
-                                    ui_notice("BOUND", 1200);
-                                }
-                            }
+int game_next_level(void)
+{
+    if (state != STATE_CUTSCENE) return -1;
+    enter_next_level();
+    return 0;
+}
 
-                            options_page = OPTPAGE_KEYS;
-                            opt_capture_action = ACTION_COUNT;
-                        }
-                        continue;
-                    }
+GamePhase game_phase(void)
+{
+    switch (state) {
+        case STATE_PLAYING:
+            return GAME_PHASE_PLAYING;
+        case STATE_CUTSCENE:
+            return GAME_PHASE_CUTSCENE;
+        case STATE_END:
+            return GAME_PHASE_END;
+        default:
+            return GAME_PHASE_MENU;
+    }
+}
 
-                    if (sc == SDL_SCANCODE_ESCAPE) {
-                        if (options_page == OPTPAGE_MAIN) {
-                            ui_notice("", 0);
-                            state = STATE_MENU;
-                        } else {
-                            options_page = OPTPAGE_MAIN;
-                            ui_notice("ARROWS: NAVIGATE", 0);
-                        }
-                        continue;
-                    }
+int game_level(void)
+{
+    return currentLevel;
+}
 
-                    if (options_page == OPTPAGE_MAIN) {
-                        if (sc == SDL_SCANCODE_UP) {
-                            if (opt_main_sel > 0) opt_main_sel--;
-                        } else if (sc == SDL_SCANCODE_DOWN) {
-                            if (opt_main_sel < 5) opt_main_sel++;
-                        } else if (sc == SDL_SCANCODE_LEFT || sc == SDL_SCANCODE_MINUS || sc == SDL_SCANCODE_KP_MINUS) {
-                            if (opt_main_sel == 1) adjust_sensitivity(-1);
-                        } else if (sc == SDL_SCANCODE_RIGHT || sc == SDL_SCANCODE_EQUALS || sc == SDL_SCANCODE_KP_PLUS) {
-                            if (opt_main_sel == 1) adjust_sensitivity(+1);
-                        } else if (sc == SDL_SCANCODE_RETURN) {
-                            if (opt_main_sel == 0) {
-                                toggle_fullscreen(win, renderer);
-                            } else if (opt_main_sel == 2) {
-                                options_page = OPTPAGE_AUDIO;
-                                opt_audio_sel = 0;
-                                ui_notice("LEFT/RIGHT: ADJUST", 0);
-                            } else if (opt_main_sel == 3) {
-                                options_page = OPTPAGE_KEYS;
-                                opt_keys_sel = 0;
-                                ui_notice("ENTER: REBIND", 0);
-                            } else if (opt_main_sel == 4) {
-                                GameConfig *cfg = config_mut();
-                                config_set_defaults(cfg);
-                                (void)config_save();
-                                apply_config_to_runtime(win, renderer);
-                                ui_notice("RESET TO DEFAULTS", 1600);
-                            } else if (opt_main_sel == 5) {
-                                ui_notice("", 0);
-                                state = STATE_MENU;
-                            }
-                        }
+/* FNV-1a */
+static Uint32 hash_bytes(Uint32 h, const void *data, size_t n)
+{
+    const Uint8 *p = (const Uint8 *)data;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
 
-                    } else if (options_page == OPTPAGE_AUDIO) {
-                        if (sc == SDL_SCANCODE_UP) {
-                            if (opt_audio_sel > 0) opt_audio_sel--;
-                        } else if (sc == SDL_SCANCODE_DOWN) {
-                            if (opt_audio_sel < 5) opt_audio_sel++;
-                        } else if (sc == SDL_SCANCODE_LEFT || sc == SDL_SCANCODE_MINUS || sc == SDL_SCANCODE_KP_MINUS) {
-                            if (opt_audio_sel == 0) {
-                                int v = audio_get_master_volume() - 8;
-                                audio_set_master_volume(v);
-                                config_set_master_volume(audio_get_master_volume());
-                                (void)config_save();
-                            } else if (opt_audio_sel == 2) {
-                                int v = audio_get_bgm_volume() - 8;
-                                audio_set_bgm_volume(v);
-                                config_set_bgm_volume(audio_get_bgm_volume());
-                                (void)config_save();
-                            } else if (opt_audio_sel == 4) {
-                                int v = audio_get_sfx_volume() - 8;
-                                audio_set_sfx_volume(v);
-                                config_set_sfx_volume(audio_get_sfx_volume());
-                                (void)config_save();
-                            }
-                        } else if (sc == SDL_SCANCODE_RIGHT || sc == SDL_SCANCODE_EQUALS || sc == SDL_SCANCODE_KP_PLUS) {
-                            if (opt_audio_sel == 0) {
-                                int v = audio_get_master_volume() + 8;
-                                audio_set_master_volume(v);
-                                config_set_master_volume(audio_get_master_volume());
-                                (void)config_save();
-                            } else if (opt_audio_sel == 2) {
-                                int v = audio_get_bgm_volume() + 8;
-                                audio_set_bgm_volume(v);
-                                config_set_bgm_volume(audio_get_bgm_volume());
-                                (void)config_save();
-                            } else if (opt_audio_sel == 4) {
-                                int v = audio_get_sfx_volume() + 8;
-                                audio_set_sfx_volume(v);
-                                config_set_sfx_volume(audio_get_sfx_volume());
-                                (void)config_save();
-                            }
-                        } else if (sc == SDL_SCANCODE_RETURN) {
-                            if (opt_audio_sel == 1) {
-                                int en = !audio_bgm_get_enabled();
-                                audio_bgm_set_enabled(en);
-                                config_set_bgm_enabled(en);
-                                (void)config_save();
-                            } else if (opt_audio_sel == 3) {
-                                int en = !audio_sfx_get_enabled();
-                                audio_sfx_set_enabled(en);
-                                config_set_sfx_enabled(en);
-                                (void)config_save();
-                            } else if (opt_audio_sel == 5) {
-                                options_page = OPTPAGE_MAIN;
-                                ui_notice("ARROWS: NAVIGATE", 0);
-                            }
-                        }
+static Uint32 hash_int(Uint32 h, int v)
+{
+    return hash_bytes(h, &v, sizeof v);
+}
 
-                    } else if (options_page == OPTPAGE_KEYS) {
-                        const int maxSel = ACTION_COUNT + 1;
-                        if (sc == SDL_SCANCODE_UP) {
-                            if (opt_keys_sel > 0) opt_keys_sel--;
-                        } else if (sc == SDL_SCANCODE_DOWN) {
-                            if (opt_keys_sel < maxSel) opt_keys_sel++;
-                        } else if (sc == SDL_SCANCODE_RETURN) {
-                            if (opt_keys_sel < ACTION_COUNT) {
-                                opt_capture_action = (Action)opt_keys_sel;
-                                options_page = OPTPAGE_BIND_CAPTURE;
-                                ui_notice("PRESS KEY (DEL/BKSP UNBIND)", 0);
-                            } else if (opt_keys_sel == ACTION_COUNT) {
-                                /* Reset only key bindings to defaults. */
-                                GameConfig d;
-                                config_set_defaults(&d);
-                                for (int a = 0; a < ACTION_COUNT; a++) {
-                                    config_set_bind((Action)a, d.binds[a]);
+static Uint32 hash_float(Uint32 h, float v)
+{
+    return hash_bytes(h, &v, sizeof v);
+}
+
+void game_state_hash(GameStateHash *out)
+{
+    const Uint32 basis = 2166136261u;
+
+    Uint32 h = basis;
+    h = hash_int(h, currentLevel);
+    h = hash_float(h, px);
+    h = hash_float(h, py);
+    h = hash_float(h, angle);
+    h = hash_int(h, hp);
+    h = hash_int(h, player_dead);
+    h = hash_int(h, ammo_bullets);
+    h = hash_int(h, ammo_shells);
+    h = hash_int(h, ammo_energy);
+    h = hash_int(h, (int)current_weapon);
+    h = hash_int(h, hasShotgun | hasSMG << 1 | hasPlasma << 2 | hasRRG << 3 | hasKey << 4);
+    out->player = h;
+
+    size_t n = (size_t)enemies.count;
+    h = hash_int(basis, enemies.count);
+    if (n > 0) {
+        h = hash_bytes(h, enemies.x, n * sizeof *enemies.x);
+        h = hash_bytes(h, enemies.y, n * sizeof *enemies.y);
+        h = hash_bytes(h, enemies.hp, n * sizeof *enemies.hp);
+        h = hash_bytes(h, enemies.state, n * sizeof *enemies.state);
+        h = hash_bytes(h, enemies.kind, n * sizeof *enemies.kind);
+    }
+    out->enemies = h;
+
+    n = (size_t)items.count;
+    h = hash_int(basis, items.count);
+    if (n > 0) {
+        h = hash_bytes(h, items.x, n * sizeof *items.x);
+        h = hash_bytes(h, items.y, n * sizeof *items.y);
+        h = hash_bytes(h, items.type, n * sizeof *items.type);
+    }
+    out->items = h;
+
+    h = hash_int(basis, worldWidth);
+    h = hash_int(h, worldHeight);
+    if (worldmap) {
+        for (int y = 0; y < worldHeight; y++)
+            h = hash_bytes(h, worldmap + y * worldStride, (size_t)worldWidth * sizeof *worldmap);
+    }
+    out->map = h;
+}
+
+/* Menus, pause, cutscenes, cheats and the function keys. Returns 0 when the
+ * event asks to quit. */
+static int handle_event(const SDL_Event *e, SDL_Window *win, SDL_Renderer *renderer)
+{
+    if (e->type == SDL_QUIT)
+        return 0;
+
+    if (e->type == SDL_TEXTINPUT) {
+        if (state == STATE_PLAYING && e->text.text[0]) {
+            for (int i = 0; e->text.text[i]; i++) {
+                cheat_feed_char(e->text.text[i]);
+            }
+        }
+    }
+
+    if (e->type == SDL_KEYDOWN && e->key.repeat == 0) {
+        /* Alt+Enter toggles fullscreen (all states). */
+        if ((e->key.keysym.scancode == SDL_SCANCODE_RETURN || e->key.keysym.scancode == SDL_SCANCODE_KP_ENTER) &&
+            (e->key.keysym.mod & KMOD_ALT)) {
+            toggle_fullscreen(win, renderer);
+            return 1;
+        }
+
+        if (e->key.keysym.scancode == SDL_SCANCODE_F5) {
+            toggle_fullscreen(win, renderer);
+        }
+
+        /* F6 switches between the SDL and software world renderers. */
+        if (e->key.keysym.scancode == SDL_SCANCODE_F6) {
+            toggle_render_path();
+        }
+
+        /* F3 shows the frame profiler. */
+        if (e->key.keysym.scancode == SDL_SCANCODE_F3) {
+            profiler_set_enabled(!profiler_enabled());
+            pacing_invalidate();
+        }
+
+        /* F8 starts/stops a trace capture. */
+        if (e->key.keysym.scancode == SDL_SCANCODE_F8) {
+            toggle_trace();
+        }
+
+        /* F7 switches floor/ceiling casting in the software renderer. */
+        if (e->key.keysym.scancode == SDL_SCANCODE_F7) {
+            toggle_floor_mode();
+        }
+
+        if (state == STATE_MENU) {
+            SDL_Scancode sc = e->key.keysym.scancode;
+            if (sc == SDL_SCANCODE_UP) {
+                if (menu_selection > 0) menu_selection--;
+            } else if (sc == SDL_SCANCODE_DOWN) {
+                if (menu_selection < 3) menu_selection++;
+            } else if (sc == SDL_SCANCODE_RETURN) {
+                if (menu_selection == 0) {
+                    episode_selection = 0;
+                    state = STATE_EPISODE_SELECT;
+                } else if (menu_selection == 1) {
+                    refresh_slot_meta();
+                    slot_selection = 0;
+                    slot_return_state = STATE_MENU;
+                    state = STATE_LOADMENU;
+                } else if (menu_selection == 2) {
+                    options_page = OPTPAGE_MAIN;
+                    opt_main_sel = 0;
+                    opt_audio_sel = 0;
+                    opt_keys_sel = 0;
+                    opt_capture_action = ACTION_COUNT;
+                    ui_notice("ARROWS: NAVIGATE", 0);
+                    state = STATE_OPTIONS;
+                } else if (menu_selection == 3) {
+                    return 0;
+                }
+            }
+
+        } else if (state == STATE_EPISODE_SELECT) {
+            SDL_Scancode sc = e->key.keysym.scancode;
+            if (sc == SDL_SCANCODE_UP) {
+                if (episode_selection > 0) episode_selection--;
+            } else if (sc == SDL_SCANCODE_DOWN) {
+                if (episode_selection < 3) episode_selection++;
+            } else if (sc == SDL_SCANCODE_ESCAPE) {
+                state = STATE_MENU;
+            } else if (sc == SDL_SCANCODE_RETURN) {
+                if (episode_selection == 3) {
+                    state = STATE_MENU;
+                } else {
+                    int startLevel = 1;
+                    if (episode_selection == 1) startLevel = 4;
+                    if (episode_selection == 2) startLevel = 7;
+                    begin_new_game(startLevel, win, renderer);
+                }
+            }
+
+        } else if (state == STATE_OPTIONS) {
+            SDL_Scancode sc = e->key.keysym.scancode;
+
+            /* Key bind capture has priority. */
+            if (options_page == OPTPAGE_BIND_CAPTURE) {
+                if (sc == SDL_SCANCODE_ESCAPE) {
+                    options_page = OPTPAGE_KEYS;
+                    opt_capture_action = ACTION_COUNT;
+                    ui_notice("CANCELLED", 1200);
+                } else {
+                    if (opt_capture_action < ACTION_COUNT) {
+                        SDL_Scancode old = config_get_bind(opt_capture_action);
+
+                        if (sc == SDL_SCANCODE_BACKSPACE || sc == SDL_SCANCODE_DELETE) {
+                            config_set_bind(opt_capture_action, SDL_SCANCODE_UNKNOWN);
+                            (void)config_save();
+                            ui_notice("UNBOUND", 1200);
+                        } else {
+                            /* Avoid duplicates by swapping if the key is already used. */
+                            for (int a = 0; a < ACTION_COUNT; a++) {
+                                if ((Action)a == opt_capture_action) continue;
+                                if (config_get_bind((Action)a) == sc) {
+                                    config_set_bind((Action)a, old);
+                                    break;
                                 }
-                                (void)config_save();
-                                ui_notice("KEYS RESET", 1600);
-                            } else {
-                                options_page = OPTPAGE_MAIN;
-                                ui_notice("ARROWS: NAVIGATE", 0);
                             }
+                            config_set_bind(opt_capture_action, sc);
+                            (void)config_save();
+                            ui_notice("BOUND", 1200);
                         }
                     }
 
-                } else if (state == STATE_END) {
-                    /* Any key exits after ending. */
-                    running = 0;
+                    options_page = OPTPAGE_KEYS;
+                    opt_capture_action = ACTION_COUNT;
+                }
+                return 1;
+            }
 
-                } else if (state == STATE_CUTSCENE) {
-                    /* Any key continues */
-                    SDL_Scancode sc = e.key.keysym.scancode;
-                    if (sc == SDL_SCANCODE_ESCAPE) {
-                        /* Allow skipping to menu */
-                        state = STATE_MENU;
-                    } else {
-                        /* Load next level */
-                        free_map();
-                        if (load_map(currentLevel) != 0) {
-                            currentLevel = 1;
-                            (void)load_map(currentLevel);
-                        }
-                        init_player();
-                        init_enemies();
-                        init_items();
-                        hasKey = 0;
-                        escaped = 0;
-                        player_dead = 0;
-                        player_damage_timer = 0.0f;
-                        gun_recoil_timer = 0;
-                        shot_fired = 0;
-                        hp = 100;
-                        state = STATE_PLAYING;
-                    }
+            if (sc == SDL_SCANCODE_ESCAPE) {
+                if (options_page == OPTPAGE_MAIN) {
+                    ui_notice("", 0);
+                    state = STATE_MENU;
+                } else {
+                    options_page = OPTPAGE_MAIN;
+                    ui_notice("ARROWS: NAVIGATE", 0);
+                }
+                return 1;
+            }
 
-                } else if (state == STATE_PLAYING) {
-                    SDL_Scancode sc = e.key.keysym.scancode;
-                    if (sc == config_get_bind(ACTION_PAUSE)) {
-                        pause_selection = 0;
-                        state = STATE_PAUSED;
+            if (options_page == OPTPAGE_MAIN) {
+                if (sc == SDL_SCANCODE_UP) {
+                    if (opt_main_sel > 0) opt_main_sel--;
+                } else if (sc == SDL_SCANCODE_DOWN) {
+                    if (opt_main_sel < 5) opt_main_sel++;
+                } else if (sc == SDL_SCANCODE_LEFT || sc == SDL_SCANCODE_MINUS || sc == SDL_SCANCODE_KP_MINUS) {
+                    if (opt_main_sel == 1) adjust_sensitivity(-1);
+                } else if (sc == SDL_SCANCODE_RIGHT || sc == SDL_SCANCODE_EQUALS || sc == SDL_SCANCODE_KP_PLUS) {
+                    if (opt_main_sel == 1) adjust_sensitivity(+1);
+                } else if (sc == SDL_SCANCODE_RETURN) {
+                    if (opt_main_sel == 0) {
+                        toggle_fullscreen(win, renderer);
+                    } else if (opt_main_sel == 2) {
+                        options_page = OPTPAGE_AUDIO;
+                        opt_audio_sel = 0;
+                        ui_notice("LEFT/RIGHT: ADJUST", 0);
+                    } else if (opt_main_sel == 3) {
+                        options_page = OPTPAGE_KEYS;
+                        opt_keys_sel = 0;
+                        ui_notice("ENTER: REBIND", 0);
+                    } else if (opt_main_sel == 4) {
+                        GameConfig *cfg = config_mut();
+                        config_set_defaults(cfg);
+                        (void)config_save();
+                        apply_config_to_runtime(win, renderer);
+                        ui_notice("RESET TO DEFAULTS", 1600);
+                    } else if (opt_main_sel == 5) {
                         ui_notice("", 0);
+                        state = STATE_MENU;
                     }
+                }
 
-                } else if (state == STATE_PAUSED) {
-                    SDL_Scancode sc = e.key.keysym.scancode;
-                    if (sc == SDL_SCANCODE_UP) {
-                        if (pause_selection > 0) pause_selection--;
-                    } else if (sc == SDL_SCANCODE_DOWN) {
-                        if (pause_selection < 3) pause_selection++;
-                    } else if (sc == SDL_SCANCODE_ESCAPE) {
-                        state = STATE_PLAYING;
-                    } else if (sc == SDL_SCANCODE_RETURN) {
-                        if (pause_selection == 0) {
-                            state = STATE_PLAYING;
-                        } else if (pause_selection == 1) {
-                            refresh_slot_meta();
-                            slot_selection = 0;
-                            slot_return_state = STATE_PAUSED;
-                            state = STATE_LOADMENU;
-                        } else if (pause_selection == 2) {
-                            refresh_slot_meta();
-                            slot_selection = 0;
-                            slot_return_state = STATE_PAUSED;
-                            state = STATE_SAVEMENU;
-                        } else if (pause_selection == 3) {
-                            state = STATE_MENU;
-                        }
+            } else if (options_page == OPTPAGE_AUDIO) {
+                if (sc == SDL_SCANCODE_UP) {
+                    if (opt_audio_sel > 0) opt_audio_sel--;
+                } else if (sc == SDL_SCANCODE_DOWN) {
+                    if (opt_audio_sel < 5) opt_audio_sel++;
+                } else if (sc == SDL_SCANCODE_LEFT || sc == SDL_SCANCODE_MINUS || sc == SDL_SCANCODE_KP_MINUS) {
+                    if (opt_audio_sel == 0) {
+                        int v = audio_get_master_volume() - 8;
+                        audio_set_master_volume(v);
+                        config_set_master_volume(audio_get_master_volume());
+                        (void)config_save();
+                    } else if (opt_audio_sel == 2) {
+                        int v = audio_get_bgm_volume() - 8;
+                        audio_set_bgm_volume(v);
+                        config_set_bgm_volume(audio_get_bgm_volume());
+                        (void)config_save();
+                    } else if (opt_audio_sel == 4) {
+                        int v = audio_get_sfx_volume() - 8;
+                        audio_set_sfx_volume(v);
+                        config_set_sfx_volume(audio_get_sfx_volume());
+                        (void)config_save();
                     }
-
-                } else if (state == STATE_LOADMENU) {
-                    SDL_Scancode sc = e.key.keysym.scancode;
-                    if (sc == SDL_SCANCODE_UP) {
-                        if (slot_selection > 0) slot_selection--;
-                    } else if (sc == SDL_SCANCODE_DOWN) {
-                        if (slot_selection < 3) slot_selection++;
-                    } else if (sc == SDL_SCANCODE_ESCAPE) {
-                        state = slot_return_state;
-                    } else if (sc == SDL_SCANCODE_RETURN) {
-                        if (slot_selection == 3) {
-                            state = slot_return_state;
-                        } else {
-                            (void)load_slot_and_enter(slot_selection + 1, win, renderer);
-                        }
+                } else if (sc == SDL_SCANCODE_RIGHT || sc == SDL_SCANCODE_EQUALS || sc == SDL_SCANCODE_KP_PLUS) {
+                    if (opt_audio_sel == 0) {
+                        int v = audio_get_master_volume() + 8;
+                        audio_set_master_volume(v);
+                        config_set_master_volume(audio_get_master_volume());
+                        (void)config_save();
+                    } else if (opt_audio_sel == 2) {
+                        int v = audio_get_bgm_volume() + 8;
+                        audio_set_bgm_volume(v);
+                        config_set_bgm_volume(audio_get_bgm_volume());
+                        (void)config_save();
+                    } else if (opt_audio_sel == 4) {
+                        int v = audio_get_sfx_volume() + 8;
+                        audio_set_sfx_volume(v);
+                        config_set_sfx_volume(audio_get_sfx_volume());
+                        (void)config_save();
+                    }
+                } else if (sc == SDL_SCANCODE_RETURN) {
+                    if (opt_audio_sel == 1) {
+                        int en = !audio_bgm_get_enabled();
+                        audio_bgm_set_enabled(en);
+                        config_set_bgm_enabled(en);
+                        (void)config_save();
+                    } else if (opt_audio_sel == 3) {
+                        int en = !audio_sfx_get_enabled();
+                        audio_sfx_set_enabled(en);
+                        config_set_sfx_enabled(en);
+                        (void)config_save();
+                    } else if (opt_audio_sel == 5) {
+                        options_page = OPTPAGE_MAIN;
+                        ui_notice("ARROWS: NAVIGATE", 0);
                     }
+                }
 
-                } else if (state == STATE_SAVEMENU) {
-                    SDL_Scancode sc = e.key.keysym.scancode;
-                    if (sc == SDL_SCANCODE_UP) {
-                        if (slot_selection > 0) slot_selection--;
-                    } else if (sc == SDL_SCANCODE_DOWN) {
-                        if (slot_selection < 3) slot_selection++;
-                    } else if (sc == SDL_SCANCODE_ESCAPE) {
-                        state = slot_return_state;
-                    } else if (sc == SDL_SCANCODE_RETURN) {
-                        if (slot_selection == 3) {
-                            state = slot_return_state;
-                        } else {
-                            int slot = slot_selection + 1;
-                            if (save_current_to_slot(slot) == 0) {
-                                ui_notice((slot == 1) ? "SAVED TO SLOT 1" : (slot == 2) ? "SAVED TO SLOT 2" : "SAVED TO SLOT 3", 1200);
-                                state = slot_return_state;
-                            } else {
-                                ui_notice("SAVE FAILED", 1400);
-                            }
+            } else if (options_page == OPTPAGE_KEYS) {
+                const int maxSel = ACTION_COUNT + 1;
+                if (sc == SDL_SCANCODE_UP) {
+                    if (opt_keys_sel > 0) opt_keys_sel--;
+                } else if (sc == SDL_SCANCODE_DOWN) {
+                    if (opt_keys_sel < maxSel) opt_keys_sel++;
+                } else if (sc == SDL_SCANCODE_RETURN) {
+                    if (opt_keys_sel < ACTION_COUNT) {
+                        opt_capture_action = (Action)opt_keys_sel;
+                        options_page = OPTPAGE_BIND_CAPTURE;
+                        ui_notice("PRESS KEY (DEL/BKSP UNBIND)", 0);
+                    } else if (opt_keys_sel == ACTION_COUNT) {
+                        /* Reset only key bindings to defaults. */
+                        GameConfig d;
+                        config_set_defaults(&d);
+                        for (int a = 0; a < ACTION_COUNT; a++) {
+                            config_set_bind((Action)a, d.binds[a]);
                         }
+                        (void)config_save();
+                        ui_notice("KEYS RESET", 1600);
+                    } else {
+                        options_page = OPTPAGE_MAIN;
+                        ui_notice("ARROWS: NAVIGATE", 0);
                     }
                 }
             }
-        }
 
-        Uint32 now = SDL_GetTicks();
-        float dt = (now - lastTick) / 1000.0f;
-        lastTick = now;
-
-        if (state == STATE_PLAYING) {
-            static int prev_player_dead = 0;
-
-            update_player(dt);
-            update_enemies(dt);
-            update_items();
-
-            if (shot_fired) {
-                /* Play different sound depending on weapon type. */
-                SfxId sfx = SFX_GUN;
-                switch (current_weapon) {
-                    case WEAPON_SHOTGUN:
-                        sfx = SFX_SHOTGUN;
-                        break;
-                    case WEAPON_PLASMA:
-                        sfx = SFX_PLASMA;
-                        break;
-                    case WEAPON_RRG:
-                        sfx = SFX_RRG;
-                        break;
-                    default:
-                        sfx = SFX_GUN;
-                        break;
-                }
-                audio_play_sfx(sfx);
+        } else if (state == STATE_END) {
+            /* Any key exits after ending. */
+            return 0;
+
+        } else if (state == STATE_CUTSCENE) {
+            /* Any key continues */
+            SDL_Scancode sc = e->key.keysym.scancode;
+            if (sc == SDL_SCANCODE_ESCAPE) {
+                /* Allow skipping to menu */
+                state = STATE_MENU;
+            } else {
+                enter_next_level();
             }
 
-            if (!prev_player_dead && player_dead) {
-                audio_play_sfx(SFX_PLAYER_DIE);
+        } else if (state == STATE_PLAYING) {
+            SDL_Scancode sc = e->key.keysym.scancode;
+            if (sc == config_get_bind(ACTION_PAUSE)) {
+                pause_selection = 0;
+                state = STATE_PAUSED;
+                ui_notice("", 0);
             }
-            prev_player_dead = player_dead;
-
-            if (shot_fired) {
-                int hitboxSize = weapon_hitbox_size(current_weapon);
-                int hx = W / 2 - hitboxSize / 2;
-                int hy = H / 2 - hitboxSize / 2;
-                int best = -1;
-                float bestDist = 1e9f;
-
-                const float fov = FOV;
-
-                for (int i = 0; i < enemy_count; i++) {
-                    if (enemies[i].state != ENEMY_ALIVE) continue;
-
-                    float dx = enemies[i].x - px;
-                    float dy = enemies[i].y - py;
-                    float dist = sqrtf(dx*dx + dy*dy);
-                    float dir = atan2f(dy, dx) - angle;
-
-                    while (dir >  M_PI) dir -= 2 * M_PI;
-                    while (dir < -M_PI) dir += 2 * M_PI;
-
-                    if (fabsf(dir) < fov * 0.5f) {
-                        float sx = (dir + fov * 0.5f) / fov * W;
-                        float sy = H / 2;
-                        if (sx >= hx && sx <= hx + hitboxSize && sy >= hy && sy <= hy + hitboxSize) {
-                            if (dist < bestDist) {
-                                bestDist = dist;
-                                best = i;
-                            }
-                        }
-                    }
-                }
 
-                if (best >= 0) {
-                    damage_enemy(best, weapon_damage(current_weapon));
+        } else if (state == STATE_PAUSED) {
+            SDL_Scancode sc = e->key.keysym.scancode;
+            if (sc == SDL_SCANCODE_UP) {
+                if (pause_selection > 0) pause_selection--;
+            } else if (sc == SDL_SCANCODE_DOWN) {
+                if (pause_selection < 3) pause_selection++;
+            } else if (sc == SDL_SCANCODE_ESCAPE) {
+                state = STATE_PLAYING;
+            } else if (sc == SDL_SCANCODE_RETURN) {
+                if (pause_selection == 0) {
+                    state = STATE_PLAYING;
+                } else if (pause_selection == 1) {
+                    refresh_slot_meta();
+                    slot_selection = 0;
+                    slot_return_state = STATE_PAUSED;
+                    state = STATE_LOADMENU;
+                } else if (pause_selection == 2) {
+                    refresh_slot_meta();
+                    slot_selection = 0;
+                    slot_return_state = STATE_PAUSED;
+                    state = STATE_SAVEMENU;
+                } else if (pause_selection == 3) {
+                    state = STATE_MENU;
                 }
             }
 
-            if (escaped) {
-                escaped = 0;
-
-                if (currentLevel < 9) {
-                    /* Show cutscene currentLevel.bmp, then load next map. */
-                    cutscene_index = currentLevel;
-                    currentLevel++;
-
-                    (void)save_progress_to_slot(active_slot);
-                    audio_play_sfx(SFX_VICTORY);
+        } else if (state == STATE_LOADMENU) {
+            SDL_Scancode sc = e->key.keysym.scancode;
+            if (sc == SDL_SCANCODE_UP) {
+                if (slot_selection > 0) slot_selection--;
+            } else if (sc == SDL_SCANCODE_DOWN) {
+                if (slot_selection < 3) slot_selection++;
+            } else if (sc == SDL_SCANCODE_ESCAPE) {
+                state = slot_return_state;
+            } else if (sc == SDL_SCANCODE_RETURN) {
+                if (slot_selection == 3) {
+                    state = slot_return_state;
+                } else {
+                    (void)load_slot_and_enter(slot_selection + 1, win, renderer);
+                }
+            }
 
-                    state = STATE_CUTSCENE;
+        } else if (state == STATE_SAVEMENU) {
+            SDL_Scancode sc = e->key.keysym.scancode;
+            if (sc == SDL_SCANCODE_UP) {
+                if (slot_selection > 0) slot_selection--;
+            } else if (sc == SDL_SCANCODE_DOWN) {
+                if (slot_selection < 3) slot_selection++;
+            } else if (sc == SDL_SCANCODE_ESCAPE) {
+                state = slot_return_state;
+            } else if (sc == SDL_SCANCODE_RETURN) {
+                if (slot_selection == 3) {
+                    state = slot_return_state;
                 } else {
-                    state = STATE_END;
-                    audio_bgm_set_enabled(0);
-                    audio_play_sfx(SFX_ENDING);
+                    int slot = slot_selection + 1;
+                    if (save_current_to_slot(slot) == 0) {
+                        ui_notice((slot == 1) ? "SAVED TO SLOT 1" : (slot == 2) ? "SAVED TO SLOT 2" : "SAVED TO SLOT 3", 1200);
+                        state = slot_return_state;
+                    } else {
+                        ui_notice("SAVE FAILED", 1400);
+                    }
                 }
             }
         }
+    }
+    return 1;
+}
 
-        /* Render */
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+int game_handle_event(const SDL_Event *e)
+{
+    return handle_event(e, NULL, NULL);
+}
 
-        if (state == STATE_MENU) {
-            if (texMenu) {
-                SDL_RenderCopy(renderer, texMenu, NULL, &(SDL_Rect){0, 0, W, H});
-            }
+/* Rendering half of a frame: the screen for the current state. */
+static void render_frame(SDL_Renderer *renderer)
+{
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
 
-            const char *itemsM[4] = { "START GAME", "LOAD GAME", "OPTIONS", "QUIT" };
-            for (int i = 0; i < 4; i++) {
-                float scale = (i == menu_selection) ? 3.0f : 2.0f;
-                int textWidth = measure_text(&fontPixel, itemsM[i], scale);
-                int x = (W - textWidth) / 2;
-                int y = H / 2 - 100 + i * 70;
-                draw_text(renderer, &fontPixel, x, y, itemsM[i], scale);
-            }
+    if (state == STATE_MENU) {
+        if (texMenu) {
+            SDL_RenderCopy(renderer, texMenu, NULL, &(SDL_Rect){0, 0, W, H});
+        }
 
-        } else if (state == STATE_EPISODE_SELECT) {
-            if (texMenu) {
-                SDL_RenderCopy(renderer, texMenu, NULL, &(SDL_Rect){0, 0, W, H});
-            }
+        const char *itemsM[4] = { "START GAME", "LOAD GAME", "OPTIONS", "QUIT" };
+        for (int i = 0; i < 4; i++) {
+            float scale = (i == menu_selection) ? 3.0f : 2.0f;
+            int textWidth = measure_text(&fontPixel, itemsM[i], scale);
+            int x = (W - textWidth) / 2;
+            int y = H / 2 - 100 + i * 70;
+            draw_text(renderer, &fontPixel, x, y, itemsM[i], scale);
+        }
+
+    } else if (state == STATE_EPISODE_SELECT) {
+        if (texMenu) {
+            SDL_RenderCopy(renderer, texMenu, NULL, &(SDL_Rect){0, 0, W, H});
+        }
+
+        const char *title = "SELECT EPISODE";
+        int tw = measure_text(&fontPixel, title, 3.0f);
+        draw_text(renderer, &fontPixel, (W - tw) / 2, 70, title, 3.0f);
+
+        const char *eps[4] = {
+            "ESCAPE THE ALIENS (MAP 1-3)",
+            "ALIEN INVASION ON EARTH (MAP 4-6)",
+            "FINAL CONFRONTATION (MAP 7-9)",
+            "BACK"
+        };
+
+        for (int i = 0; i < 4; i++) {
+            float scale = (i == episode_selection) ? 2.4f : 1.9f;
+            int w = measure_text(&fontPixel, eps[i], scale);
+            int x = (W - w) / 2;
+            int y = 190 + i * 70;
+            draw_text(renderer, &fontPixel, x, y, eps[i], scale);
+        }
 
-            const char *title = "SELECT EPISODE";
-            int tw = measure_text(&fontPixel, title, 3.0f);
-            draw_text(renderer, &fontPixel, (W - tw) / 2, 70, title, 3.0f);
+        const char *hint = "ENTER TO START  ESC TO BACK";
+        int hw = measure_text(&fontPixel, hint, 1.0f);
+        draw_text(renderer, &fontPixel, (W - hw) / 2, H - 70, hint, 1.0f);
 
-            const char *eps[4] = {
-                "ESCAPE THE ALIENS (MAP 1-3)",
-                "ALIEN INVASION ON EARTH (MAP 4-6)",
-                "FINAL CONFRONTATION (MAP 7-9)",
+    } else if (state == STATE_OPTIONS) {
+        if (texMenu) {
+            SDL_RenderCopy(renderer, texMenu, NULL, &(SDL_Rect){0, 0, W, H});
+        }
+
+        const char *title =
+            (options_page == OPTPAGE_MAIN) ? "OPTIONS" :
+            (options_page == OPTPAGE_AUDIO) ? "AUDIO" :
+            (options_page == OPTPAGE_KEYS) ? "KEY BINDINGS" :
+            "BIND KEY";
+
+        int tw = measure_text(&fontPixel, title, 3.0f);
+        draw_text(renderer, &fontPixel, (W - tw) / 2, 60, title, 3.0f);
+
+        if (options_page == OPTPAGE_MAIN) {
+            char line0[64];
+            snprintf(line0, sizeof line0, "FULLSCREEN: %s", isFullscreen ? "ON" : "OFF");
+            char line1[64];
+            int sensVal = (int)(mouse_sensitivity * 10000.0f + 0.5f);
+            snprintf(line1, sizeof line1, "MOUSE SENSITIVITY: %d", sensVal);
+
+            const char *lines[6] = {
+                line0,
+                line1,
+                "AUDIO...",
+                "KEY BINDINGS...",
+                "RESET TO DEFAULTS",
                 "BACK"
             };
 
-            for (int i = 0; i < 4; i++) {
-                float scale = (i == episode_selection) ? 2.4f : 1.9f;
-                int w = measure_text(&fontPixel, eps[i], scale);
+            for (int i = 0; i < 6; i++) {
+                float scale = (i == opt_main_sel) ? 2.5f : 2.0f;
+                int w = measure_text(&fontPixel, lines[i], scale);
                 int x = (W - w) / 2;
-                int y = 190 + i * 70;
-                draw_text(renderer, &fontPixel, x, y, eps[i], scale);
+                int y = 170 + i * 70;
+                draw_text(renderer, &fontPixel, x, y, lines[i], scale);
             }
 
-            const char *hint = "ENTER TO START  ESC TO BACK";
-            int hw = measure_text(&fontPixel, hint, 1.0f);
-            draw_text(renderer, &fontPixel, (W - hw) / 2, H - 70, hint, 1.0f);
+        } else if (options_page == OPTPAGE_AUDIO) {
+            int master = audio_get_master_volume();
+            int bgmV = audio_get_bgm_volume();
+            int sfxV = audio_get_sfx_volume();
+
+            int masterP = (master * 100) / 128;
+            int bgmP = (bgmV * 100) / 128;
+            int sfxP = (sfxV * 100) / 128;
+
+            char a0[64];
+            snprintf(a0, sizeof a0, "MASTER VOLUME: %d%%", masterP);
+            char a1[64];
+            snprintf(a1, sizeof a1, "BGM: %s", audio_bgm_get_enabled() ? "ON" : "OFF");
+            char a2[64];
+            snprintf(a2, sizeof a2, "BGM VOLUME: %d%%", bgmP);
+            char a3[64];
+            snprintf(a3, sizeof a3, "SFX: %s", audio_sfx_get_enabled() ? "ON" : "OFF");
+            char a4[64];
+            snprintf(a4, sizeof a4, "SFX VOLUME: %d%%", sfxP);
+
+            const char *lines[6] = { a0, a1, a2, a3, a4, "BACK" };
+
+            for (int i = 0; i < 6; i++) {
+                float scale = (i == opt_audio_sel) ? 2.4f : 1.95f;
+                int w = measure_text(&fontPixel, lines[i], scale);
+                int x = (W - w) / 2;
+                int y = 170 + i * 65;
+                draw_text(renderer, &fontPixel, x, y, lines[i], scale);
+            }
 
-        } else if (state == STATE_OPTIONS) {
-            if (texMenu) {
-                SDL_RenderCopy(renderer, texMenu, NULL, &(SDL_Rect){0, 0, W, H});
+        } else if (options_page == OPTPAGE_KEYS) {
+            /* 0..ACTION_COUNT-1: actions, ACTION_COUNT: reset keys, ACTION_COUNT+1: back */
+            for (int i = 0; i < ACTION_COUNT + 2; i++) {
+                char line[192];
+                if (i == ACTION_COUNT) {
+                    snprintf(line, sizeof line, "RESET KEYS TO DEFAULTS");
+                } else if (i == ACTION_COUNT + 1) {
+                    snprintf(line, sizeof line, "BACK");
+                } else {
+                    Action a = (Action)i;
+                    SDL_Scancode sc = config_get_bind(a);
+                    const char *key = SDL_GetScancodeName(sc);
+                    if (!key || !key[0]) key = "UNBOUND";
+                    snprintf(line, sizeof line, "%s: %s", config_action_label(a), key);
+                }
+
+                float scale = (i == opt_keys_sel) ? 1.9f : 1.5f;
+                int w = measure_text(&fontPixel, line, scale);
+                int x = (W - w) / 2;
+                int y = 140 + i * 40;
+                draw_text(renderer, &fontPixel, x, y, line, scale);
             }
 
-            const char *title =
-                (options_page == OPTPAGE_MAIN) ? "OPTIONS" :
-                (options_page == OPTPAGE_AUDIO) ? "AUDIO" :
-                (options_page == OPTPAGE_KEYS) ? "KEY BINDINGS" :
-                "BIND KEY";
+        } else { /* OPTPAGE_BIND_CAPTURE */
+            const char *p1 = "PRESS A KEY";
+            const char *p2 = (opt_capture_action < ACTION_COUNT) ? config_action_label(opt_capture_action) : "";
+            const char *p3 = "DEL/BKSP: UNBIND   ESC: CANCEL";
 
-            int tw = measure_text(&fontPixel, title, 3.0f);
-            draw_text(renderer, &fontPixel, (W - tw) / 2, 60, title, 3.0f);
+            float sc1 = 3.0f;
+            float sc2 = 2.4f;
+            float sc3 = 1.3f;
 
-            if (options_page == OPTPAGE_MAIN) {
-                char line0[64];
-                snprintf(line0, sizeof line0, "FULLSCREEN: %s", isFullscreen ? "ON" : "OFF");
-                char line1[64];
-                int sensVal = (int)(mouse_sensitivity * 10000.0f + 0.5f);
-                snprintf(line1, sizeof line1, "MOUSE SENSITIVITY: %d", sensVal);
-
-                const char *lines[6] = {
-                    line0,
-                    line1,
-                    "AUDIO...",
-                    "KEY BINDINGS...",
-                    "RESET TO DEFAULTS",
-                    "BACK"
-                };
-
-                for (int i = 0; i < 6; i++) {
-                    float scale = (i == opt_main_sel) ? 2.5f : 2.0f;
-                    int w = measure_text(&fontPixel, lines[i], scale);
-                    int x = (W - w) / 2;
-                    int y = 170 + i * 70;
-                    draw_text(renderer, &fontPixel, x, y, lines[i], scale);
-                }
+            int w1 = measure_text(&fontPixel, p1, sc1);
+            int w2 = measure_text(&fontPixel, p2, sc2);
+            int w3 = measure_text(&fontPixel, p3, sc3);
 
-            } else if (options_page == OPTPAGE_AUDIO) {
-                int master = audio_get_master_volume();
-                int bgmV = audio_get_bgm_volume();
-                int sfxV = audio_get_sfx_volume();
-
-                int masterP = (master * 100) / 128;
-                int bgmP = (bgmV * 100) / 128;
-                int sfxP = (sfxV * 100) / 128;
-
-                char a0[64];
-                snprintf(a0, sizeof a0, "MASTER VOLUME: %d%%", masterP);
-                char a1[64];
-                snprintf(a1, sizeof a1, "BGM: %s", audio_bgm_get_enabled() ? "ON" : "OFF");
-                char a2[64];
-                snprintf(a2, sizeof a2, "BGM VOLUME: %d%%", bgmP);
-                char a3[64];
-                snprintf(a3, sizeof a3, "SFX: %s", audio_sfx_get_enabled() ? "ON" : "OFF");
-                char a4[64];
-                snprintf(a4, sizeof a4, "SFX VOLUME: %d%%", sfxP);
-
-                const char *lines[6] = { a0, a1, a2, a3, a4, "BACK" };
-
-                for (int i = 0; i < 6; i++) {
-                    float scale = (i == opt_audio_sel) ? 2.4f : 1.95f;
-                    int w = measure_text(&fontPixel, lines[i], scale);
-                    int x = (W - w) / 2;
-                    int y = 170 + i * 65;
-                    draw_text(renderer, &fontPixel, x, y, lines[i], scale);
-                }
+            int y = H / 2 - 70;
+            draw_text(renderer, &fontPixel, (W - w1) / 2, y, p1, sc1);
+            draw_text(renderer, &fontPixel, (W - w2) / 2, y + 80, p2, sc2);
+            draw_text(renderer, &fontPixel, (W - w3) / 2, y + 150, p3, sc3);
+        }
 
-            } else if (options_page == OPTPAGE_KEYS) {
-                /* 0..ACTION_COUNT-1: actions, ACTION_COUNT: reset keys, ACTION_COUNT+1: back */
-                for (int i = 0; i < ACTION_COUNT + 2; i++) {
-                    char line[192];
-                    if (i == ACTION_COUNT) {
-                        snprintf(line, sizeof line, "RESET KEYS TO DEFAULTS");
-                    } else if (i == ACTION_COUNT + 1) {
-                        snprintf(line, sizeof line, "BACK");
-                    } else {
-                        Action a = (Action)i;
-                        SDL_Scancode sc = config_get_bind(a);
-                        const char *key = SDL_GetScancodeName(sc);
-                        if (!key || !key[0]) key = "UNBOUND";
-                        snprintf(line, sizeof line, "%s: %s", config_action_label(a), key);
-                    }
+        /* Bottom hint/notice (persistent if end_time == 0). */
+        if (menu_notice[0]) {
+            Uint32 now = SDL_GetTicks();
+            if (menu_notice_end_time == 0 || now < menu_notice_end_time) {
+                int nw = measure_text(&fontPixel, menu_notice, 1.0f);
+                draw_text(renderer, &fontPixel, (W - nw) / 2, H - 60, menu_notice, 1.0f);
+            }
+        }
 
-                    float scale = (i == opt_keys_sel) ? 1.9f : 1.5f;
-                    int w = measure_text(&fontPixel, line, scale);
-                    int x = (W - w) / 2;
-                    int y = 140 + i * 40;
-                    draw_text(renderer, &fontPixel, x, y, line, scale);
-                }
+    } else if (state == STATE_PAUSED || state == STATE_LOADMENU || state == STATE_SAVEMENU) {
+        draw_world(renderer);
+        draw_sprites(renderer);
+        draw_hud(renderer);
 
-            } else { /* OPTPAGE_BIND_CAPTURE */
-                const char *p1 = "PRESS A KEY";
-                const char *p2 = (opt_capture_action < ACTION_COUNT) ? config_action_label(opt_capture_action) : "";
-                const char *p3 = "DEL/BKSP: UNBIND   ESC: CANCEL";
+        char hpStr[32];
+        snprintf(hpStr, sizeof hpStr, "HP %d", hp);
+        draw_text(renderer, &fontPixel, 20, H - 112, hpStr, 2.0f);
 
-                float sc1 = 3.0f;
-                float sc2 = 2.4f;
-                float sc3 = 1.3f;
+        char ammoStr[32];
+        build_ammo_string(ammoStr, sizeof ammoStr);
+        int aw = measure_text(&fontPixel, ammoStr, 2.0f);
+        draw_text(renderer, &fontPixel, W - 20 - aw, H - 112, ammoStr, 2.0f);
+        draw_gun(renderer);
 
-                int w1 = measure_text(&fontPixel, p1, sc1);
-                int w2 = measure_text(&fontPixel, p2, sc2);
-                int w3 = measure_text(&fontPixel, p3, sc3);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
+        SDL_RenderFillRect(renderer, &(SDL_Rect){0, 0, W, H});
 
-                int y = H / 2 - 70;
-                draw_text(renderer, &fontPixel, (W - w1) / 2, y, p1, sc1);
-                draw_text(renderer, &fontPixel, (W - w2) / 2, y + 80, p2, sc2);
-                draw_text(renderer, &fontPixel, (W - w3) / 2, y + 150, p3, sc3);
-            }
+        const char *title = (state == STATE_PAUSED) ? "PAUSED" : (state == STATE_LOADMENU) ? "LOAD GAME" : "SAVE GAME";
+        int tww = measure_text(&fontPixel, title, 3.0f);
+        draw_text(renderer, &fontPixel, (W - tww) / 2, 70, title, 3.0f);
 
-            /* Bottom hint/notice (persistent if end_time == 0). */
-            if (menu_notice[0]) {
-                Uint32 now = SDL_GetTicks();
-                if (menu_notice_end_time == 0 || now < menu_notice_end_time) {
-                    int nw = measure_text(&fontPixel, menu_notice, 1.0f);
-                    draw_text(renderer, &fontPixel, (W - nw) / 2, H - 60, menu_notice, 1.0f);
-                }
+        if (state == STATE_PAUSED) {
+            const char *opts[4] = { "CONTINUE GAME", "LOAD GAME", "SAVE GAME", "QUIT GAME" };
+            for (int i = 0; i < 4; i++) {
+                float s = (i == pause_selection) ? 2.8f : 2.2f;
+                int w = measure_text(&fontPixel, opts[i], s);
+                int x = (W - w) / 2;
+                int y = 190 + i * 70;
+                draw_text(renderer, &fontPixel, x, y, opts[i], s);
             }
-
-        } else if (state == STATE_PAUSED || state == STATE_LOADMENU || state == STATE_SAVEMENU) {
-            draw_world(renderer);
-            draw_keys(renderer);
-            draw_items(renderer);
-            draw_enemies(renderer);
-            draw_hud(renderer);
-
-            char hpStr[32];
-            snprintf(hpStr, sizeof hpStr, "HP %d", hp);
-            draw_text(renderer, &fontPixel, 20, H - 112, hpStr, 2.0f);
-
-            char ammoStr[32];
-            build_ammo_string(ammoStr, sizeof ammoStr);
-            int aw = measure_text(&fontPixel, ammoStr, 2.0f);
-            draw_text(renderer, &fontPixel, W - 20 - aw, H - 112, ammoStr, 2.0f);
-            draw_gun(renderer);
-
-            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
-            SDL_RenderFillRect(renderer, &(SDL_Rect){0, 0, W, H});
-
-            const char *title = (state == STATE_PAUSED) ? "PAUSED" : (state == STATE_LOADMENU) ? "LOAD GAME" : "SAVE GAME";
-            int tww = measure_text(&fontPixel, title, 3.0f);
-            draw_text(renderer, &fontPixel, (W - tww) / 2, 70, title, 3.0f);
-
-            if (state == STATE_PAUSED) {
-                const char *opts[4] = { "CONTINUE GAME", "LOAD GAME", "SAVE GAME", "QUIT GAME" };
-                for (int i = 0; i < 4; i++) {
-                    float s = (i == pause_selection) ? 2.8f : 2.2f;
-                    int w = measure_text(&fontPixel, opts[i], s);
-                    int x = (W - w) / 2;
-                    int y = 190 + i * 70;
-                    draw_text(renderer, &fontPixel, x, y, opts[i], s);
-                }
-            } else {
-                for (int i = 0; i < 4; i++) {
-                    char line[160];
-                    if (i < 3) {
-                        const SaveMeta *m = &slot_meta[i];
-                        if (m->exists) {
-                            snprintf(line, sizeof line,
-                                     "SAVE %d (L%d HP%d B%d S%d E%d)%s",
-                                     i + 1, m->level, m->hp,
-                                     m->ammo_bullets, m->ammo_shells, m->ammo_energy,
-                                     (active_slot == i + 1) ? " *" : "");
-                        } else {
-                            snprintf(line, sizeof line, "SAVE %d (EMPTY)%s", i + 1, (active_slot == i + 1) ? " *" : "");
-                        }
+        } else {
+            for (int i = 0; i < 4; i++) {
+                char line[160];
+                if (i < 3) {
+                    const SaveMeta *m = &slot_meta[i];
+                    if (m->exists) {
+                        snprintf(line, sizeof line,
+                                 "SAVE %d (L%d HP%d B%d S%d E%d)%s",
+                                 i + 1, m->level, m->hp,
+                                 m->ammo_bullets, m->ammo_shells, m->ammo_energy,
+                                 (active_slot == i + 1) ? " *" : "");
                     } else {
-                        snprintf(line, sizeof line, "BACK");
+                        snprintf(line, sizeof line, "SAVE %d (EMPTY)%s", i + 1, (active_slot == i + 1) ? " *" : "");
                     }
-
-                    float s = (i == slot_selection) ? 2.6f : 2.1f;
-                    int w = measure_text(&fontPixel, line, s);
-                    int x = (W - w) / 2;
-                    int y = 190 + i * 70;
-                    draw_text(renderer, &fontPixel, x, y, line, s);
+                } else {
+                    snprintf(line, sizeof line, "BACK");
                 }
 
-                const char *hint = (state == STATE_LOADMENU) ? "ENTER TO LOAD  ESC TO BACK" : "ENTER TO SAVE  ESC TO BACK";
-                int hw = measure_text(&fontPixel, hint, 1.0f);
-                draw_text(renderer, &fontPixel, (W - hw) / 2, H - 70, hint, 1.0f);
+                float s = (i == slot_selection) ? 2.6f : 2.1f;
+                int w = measure_text(&fontPixel, line, s);
+                int x = (W - w) / 2;
+                int y = 190 + i * 70;
+                draw_text(renderer, &fontPixel, x, y, line, s);
             }
 
-            if (menu_notice[0]) {
-                Uint32 now = SDL_GetTicks();
-                if (menu_notice_end_time == 0 || now < menu_notice_end_time) {
-                    int nw = measure_text(&fontPixel, menu_notice, 1.8f);
-                    draw_text(renderer, &fontPixel, (W - nw) / 2, H - 120, menu_notice, 1.8f);
-                }
+            const char *hint = (state == STATE_LOADMENU) ? "ENTER TO LOAD  ESC TO BACK" : "ENTER TO SAVE  ESC TO BACK";
+            int hw = measure_text(&fontPixel, hint, 1.0f);
+            draw_text(renderer, &fontPixel, (W - hw) / 2, H - 70, hint, 1.0f);
+        }
+
+        if (menu_notice[0]) {
+            Uint32 now = SDL_GetTicks();
+            if (menu_notice_end_time == 0 || now < menu_notice_end_time) {
+                int nw = measure_text(&fontPixel, menu_notice, 1.8f);
+                draw_text(renderer, &fontPixel, (W - nw) / 2, H - 120, menu_notice, 1.8f);
             }
+        }
 
-            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
 
-        } else if (state == STATE_PLAYING) {
-            draw_world(renderer);
-            draw_keys(renderer);
-            draw_items(renderer);
-            draw_enemies(renderer);
-            draw_hud(renderer);
+    } else if (state == STATE_PLAYING) {
+        game_render_playing(renderer);
 
-            char hpStr[32];
-            snprintf(hpStr, sizeof hpStr, "HP %d", hp);
-            draw_text(renderer, &fontPixel, 20, H - 112, hpStr, 2.0f);
+    } else if (state == STATE_CUTSCENE) {
+        SDL_Texture *t = NULL;
+        if (cutscene_index >= 1 && cutscene_index <= 8) t = texCutscene[cutscene_index];
 
-            char ammoStr[32];
-            build_ammo_string(ammoStr, sizeof ammoStr);
-            int aw = measure_text(&fontPixel, ammoStr, 2.0f);
-            draw_text(renderer, &fontPixel, W - 20 - aw, H - 112, ammoStr, 2.0f);
+        if (t) {
+            SDL_RenderCopy(renderer, t, NULL, &(SDL_Rect){0, 0, W, H});
+        }
 
-            draw_gun(renderer);
+        const char *hint = "PRESS ANY KEY";
+        int hw = measure_text(&fontPixel, hint, 2.0f);
+        draw_text(renderer, &fontPixel, (W - hw) / 2, H - 80, hint, 2.0f);
 
-            if (SDL_GetTicks() < message_end_time && message_text[0]) {
-                draw_text(renderer, &fontPixel, 20, H - 160, message_text, 2.0f);
-            }
+    } else if (state == STATE_END) {
+        if (texEnding) {
+            SDL_RenderCopy(renderer, texEnding, NULL, &(SDL_Rect){0, 0, W, H});
+        }
+        const char *line1 = "YOU SAVED THE EARTH!";
+        const char *line2 = "SEE YOU IN PART 2!";
 
-        } else if (state == STATE_CUTSCENE) {
-            SDL_Texture *t = NULL;
-            if (cutscene_index >= 1 && cutscene_index <= 8) t = texCutscene[cutscene_index];
+        const float scale = 2.5f;
+        const int gap = 10;
+        const int lh = (int)(fontPixel.lineHeight * scale);
 
-            if (t) {
-                SDL_RenderCopy(renderer, t, NULL, &(SDL_Rect){0, 0, W, H});
-            }
+        int w1 = measure_text(&fontPixel, line1, scale);
+        int w2 = measure_text(&fontPixel, line2, scale);
 
-            const char *hint = "PRESS ANY KEY";
-            int hw = measure_text(&fontPixel, hint, 2.0f);
-            draw_text(renderer, &fontPixel, (W - hw) / 2, H - 80, hint, 2.0f);
+        int x1 = (W - w1) / 2;
+        int x2 = (W - w2) / 2;
 
-        } else if (state == STATE_END) {
-            if (texEnding) {
-                SDL_RenderCopy(renderer, texEnding, NULL, &(SDL_Rect){0, 0, W, H});
-            }
-            const char *line1 = "YOU SAVED THE EARTH!";
-            const char *line2 = "SEE YOU IN PART 2!";
+        int y1 = (H - (lh * 2 + gap)) / 2;
+        int y2 = y1 + lh + gap;
+
+        draw_text(renderer, &fontPixel, x1, y1, line1, scale);
+        draw_text(renderer, &fontPixel, x2, y2, line2, scale);
+    }
+
+    profiler_draw(renderer, &fontPixel);
+}
+
+void game_loop(SDL_Window *win, SDL_Renderer *renderer)
+{
+    SDL_Event e;
+    int running = 1;
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+    if (renderer) {
+        SDL_RenderSetLogicalSize(renderer, W, H);
+        SDL_RenderSetIntegerScale(renderer, SDL_TRUE);
+    }
 
-            const float scale = 2.5f;
-            const int gap = 10;
-            const int lh = (int)(fontPixel.lineHeight * scale);
+    /* Load/create persistent config (DATA/config/config.json) and apply it. */
+    (void)config_load_or_create();
+    apply_config_to_runtime(win, renderer);
 
-            int w1 = measure_text(&fontPixel, line1, scale);
-            int w2 = measure_text(&fontPixel, line2, scale);
+    (void)audio_init();
 
-            int x1 = (W - w1) / 2;
-            int x2 = (W - w2) / 2;
+    game_load_assets(renderer);
 
-            int y1 = (H - (lh * 2 + gap)) / 2;
-            int y2 = y1 + lh + gap;
+    state = STATE_MENU;
+    free_map();
+    items_clear();
+    enemies_clear();
 
-            draw_text(renderer, &fontPixel, x1, y1, line1, scale);
-            draw_text(renderer, &fontPixel, x2, y2, line2, scale);
+    SDL_StartTextInput();
+
+    if (replay_path && game_start_replay(replay_path) < 0)
+        ui_notice("CANNOT READ REPLAY", 2000);
+    replay_path = NULL;
+
+    while (running) {
+        /* Toggle mouse capture depending on state */
+        static int mouse_lock = -1;
+        int want_lock = (state == STATE_PLAYING);
+        if (want_lock != mouse_lock) {
+            SDL_SetRelativeMouseMode(want_lock ? SDL_TRUE : SDL_FALSE);
+            SDL_ShowCursor(want_lock ? SDL_DISABLE : SDL_ENABLE);
+            mouse_lock = want_lock;
+        }
+
+        /* Menus, cutscenes and the ending only change on input, so they
+         * sleep on the event queue; every state sleeps while the window is
+         * hidden, minimized or unfocused. */
+        int static_screen = (state != STATE_PLAYING && input_mode() != INPUT_REPLAYING);
+        if (pacing_wait(static_screen)) {
+            /* Do not feed the sleep into the next simulation step. */
+            timestep_reset();
         }
 
-        SDL_RenderPresent(renderer);
+        while (input_next_event(&e)) {
+            pacing_handle_event(&e);
+            if (!handle_event(&e, win, renderer))
+                running = 0;
+        }
+
+        if (state == STATE_PLAYING && !pacing_suspended()) {
+            /* Stop early if a step ends the level. A replay also stops
+             * where its next event is due, so it is handled on the same
+             * step as when it was recorded. */
+            int steps = timestep_advance();
+            int due = input_steps_until_event();
+            if (steps > due) {
+                timestep_defer(steps - due);
+                steps = due;
+            }
+            for (int s = 0; s < steps && state == STATE_PLAYING; s++)
+                simulate_step(SIM_DT);
+            render_set_alpha(timestep_alpha());
+        } else {
+            /* Time spent outside the game is not simulated. */
+            timestep_reset();
+        }
+
+        if (input_replay_done()) {
+            /* Hand control back to the player where the journal ends. */
+            input_stop();
+            show_message("REPLAY FINISHED");
+        }
+
+        /* Render (static screens only when something changed). */
+        if (!pacing_should_draw(state != STATE_PLAYING))
+            continue;
+
+        render_frame(renderer);
+
+        PROF_SCOPE(PROF_PRESENT, SDL_RenderPresent(renderer));
+        pacing_frame_done();
+        profiler_frame_end();
+        trace_poll();
     }
 
     SDL_StopTextInput();
+    input_stop();
+    if (trace_enabled()) (void)trace_finish();
 
+    swr_shutdown();
     audio_shutdown();
     free_map();
+    enemies_shutdown();
+    items_shutdown();
 }
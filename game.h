@@ -5,6 +5,64 @@
 
 void game_loop(SDL_Window *win, SDL_Renderer *renderer);
 
+/* Load world textures, sprites and fonts for renderer. */
+void game_load_assets(SDL_Renderer *renderer);
+
+/* Start a new game on the given map (1..9) and enter the playing state. */
+void game_start_level(int level);
+
+/* Record input into a journal from the next new game on (--record). */
+void game_record_to(const char *path);
+
+/* Play a journal back once game_loop() starts (--replay). */
+void game_replay_from(const char *path);
+
+/* Load a journal, apply the settings it was recorded with and start its
+ * level with input coming from it. Returns the level, or -1 if the journal
+ * cannot be read. */
+int game_start_replay(const char *path);
+
+/*
+ * Driving the game without game_loop() (headless simulation, benchmark).
+ * game_loop() is these same pieces plus pacing and drawing.
+ */
+typedef enum {
+    GAME_PHASE_MENU = 0,    /* menus, pause, load/save screens */
+    GAME_PHASE_PLAYING,
+    GAME_PHASE_CUTSCENE,    /* between two levels */
+    GAME_PHASE_END          /* the last level is done */
+} GamePhase;
+
+/* Hashes of the gameplay state, to compare two runs. */
+typedef struct {
+    Uint32 player;          /* level, position, view, health, ammo, weapons */
+    Uint32 enemies;         /* position, health and state of each enemy */
+    Uint32 items;           /* pickups left */
+    Uint32 map;             /* tiles (doors and keys change them) */
+} GameStateHash;
+
+GamePhase game_phase(void);
+
+/* Level being played or last played, 1..9. */
+int game_level(void);
+
+/* Handle an input event as the game loop does (menus, pause, cheats, the
+ * function keys). Returns 0 if it asks to quit. */
+int game_handle_event(const SDL_Event *e);
+
+/* Run one fixed step of gameplay (SIM_DT) if a level is being played.
+ * Returns 0 once the game has left the playing state. */
+int game_step(void);
+
+/* From the cutscene after a level, start the next one. Returns 0, or -1
+ * when not in a cutscene. */
+int game_next_level(void);
+
+void game_state_hash(GameStateHash *out);
+
+/* Draw one in-game frame: world, sprites, HUD, gun and HUD message. */
+void game_render_playing(SDL_Renderer *renderer);
+
 /* HUD message helper (defined in game.c). */
 void show_message(const char *text);
 
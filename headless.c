@@ -0,0 +1,322 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headless.h"
+#include "game.h"
+#include "render.h"
+#include "swrender.h"
+#include "player.h"
+#include "map.h"
+#include "enemy.h"
+#include "items.h"
+#include "config.h"
+#include "trace.h"
+#include "input.h"
+#include "spatial.h"
+#include "timestep.h"
+
+/* Steps simulated by default: five minutes of game time. */
+#define HEADLESS_SIM_TICKS (SIM_HZ * 60 * 5)
+
+int headless_parse_args(int argc, char *argv[], HeadlessOptions *opt)
+{
+    int headless = 0;
+
+    opt->level = 1;
+    opt->frames = 300;
+    opt->renderer = -1;
+    opt->dump_every = 0;
+    opt->dump_dir = ".";
+    opt->simulate = 0;
+    opt->ticks = HEADLESS_SIM_TICKS;
+    opt->replay = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(a, "--headless") == 0) {
+            headless = 1;
+        } else if (strcmp(a, "--level") == 0 && next) {
+            opt->level = atoi(next);
+            i++;
+        } else if (strcmp(a, "--frames") == 0 && next) {
+            opt->frames = atoi(next);
+            i++;
+        } else if (strcmp(a, "--renderer") == 0 && next) {
+            if (strcmp(next, "sdl") == 0) opt->renderer = RENDER_PATH_SDL;
+            else if (strcmp(next, "software") == 0) opt->renderer = RENDER_PATH_SOFTWARE;
+            else fprintf(stderr, "HEADLESS: unknown renderer '%s'\n", next);
+            i++;
+        } else if (strcmp(a, "--dump-every") == 0 && next) {
+            opt->dump_every = atoi(next);
+            i++;
+        } else if (strcmp(a, "--dump-dir") == 0 && next) {
+            opt->dump_dir = next;
+            i++;
+        } else if (strcmp(a, "--simulate") == 0) {
+            opt->simulate = 1;
+        } else if (strcmp(a, "--ticks") == 0 && next) {
+            opt->ticks = atoi(next);
+            i++;
+        } else if (strcmp(a, "--replay") == 0 && next) {
+            opt->replay = next;
+            i++;
+        }
+    }
+
+    if (opt->level < 1) opt->level = 1;
+    if (opt->level > 9) opt->level = 9;
+    if (opt->frames < 1) opt->frames = 1;
+    if (opt->dump_every < 0) opt->dump_every = 0;
+    if (opt->ticks < 1) opt->ticks = 1;
+    return headless;
+}
+
+static void dump_frame(SDL_Surface *surf, const char *dir, int frame)
+{
+    char path[512];
+    snprintf(path, sizeof path, "%s/frame_%05d.bmp", dir, frame);
+    if (SDL_SaveBMP(surf, path) != 0)
+        fprintf(stderr, "HEADLESS: cannot write %s: %s\n", path, SDL_GetError());
+}
+
+static void apply_ai_config(void)
+{
+    enemies_set_lod(config_get_ai_lod());
+    enemies_set_lod_tiers(config_get_ai_near_tiles(), config_get_ai_far_tiles(),
+                          config_get_ai_mid_interval());
+}
+
+int headless_open(HeadlessTarget *t)
+{
+    t->surface = NULL;
+    t->renderer = NULL;
+
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        fprintf(stderr, "HEADLESS: SDL_Init failed: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    t->surface = SDL_CreateRGBSurfaceWithFormat(0, W, H, 32, SDL_PIXELFORMAT_ARGB8888);
+    t->renderer = t->surface ? SDL_CreateSoftwareRenderer(t->surface) : NULL;
+    if (!t->renderer) {
+        fprintf(stderr, "HEADLESS: cannot create offscreen renderer: %s\n", SDL_GetError());
+        SDL_FreeSurface(t->surface);
+        t->surface = NULL;
+        SDL_Quit();
+        return -1;
+    }
+
+    /* Same renderer and AI settings as a windowed run; no window, pacing or
+     * audio. */
+    (void)config_load_or_create();
+    render_set_path(config_get_software_renderer() ? RENDER_PATH_SOFTWARE : RENDER_PATH_SDL);
+    swr_set_floor_mode(config_get_floor_casting() ? SWR_FLOOR_CAST : SWR_FLOOR_STRETCH);
+    swr_set_thread_count(config_get_render_threads());
+    apply_ai_config();
+
+    game_load_assets(t->renderer);
+    return 0;
+}
+
+void headless_close(HeadlessTarget *t)
+{
+    if (trace_enabled()) (void)trace_finish();
+    swr_shutdown();
+    free_map();
+    enemies_shutdown();
+    items_shutdown();
+    if (t->renderer) SDL_DestroyRenderer(t->renderer);
+    SDL_FreeSurface(t->surface);
+    t->renderer = NULL;
+    t->surface = NULL;
+    SDL_Quit();
+}
+
+/* ------------------------------------------------------------
+ * Simulation
+ * ------------------------------------------------------------ */
+#define BOT_TURN_STEPS 40       /* steps spent turning away from a wall */
+#define BOT_TURN_SPEED 12       /* mouse units per step while turning */
+#define BOT_AIM_HALF 0.08f      /* radians either side of the view to shoot */
+#define BOT_AIM_RANGE 10.0f     /* tiles */
+
+/* Scripted player: walks straight on and turns away when it stops moving,
+ * presses interact every half second, fires at any enemy right ahead and
+ * tries the next weapon every ten seconds. */
+typedef struct {
+    Uint32 seed;
+    float last_x, last_y;
+    int turn_steps;
+    int turn_dir;
+} Bot;
+
+static void bot_sample(Uint32 tick, InputSample *s, void *user)
+{
+    Bot *b = (Bot *)user;
+
+    if (fabsf(px - b->last_x) + fabsf(py - b->last_y) < 1e-4f && b->turn_steps <= 0) {
+        b->seed = b->seed * 1664525u + 1013904223u;
+        b->turn_dir = (b->seed >> 16) & 1 ? 1 : -1;
+        b->turn_steps = BOT_TURN_STEPS;
+    }
+    b->last_x = px;
+    b->last_y = py;
+
+    if (b->turn_steps > 0) {
+        b->turn_steps--;
+        s->mouse_dx = (Sint16)(b->turn_dir * BOT_TURN_SPEED);
+    }
+    s->actions |= 1u << ACTION_MOVE_FORWARD;
+
+    if (tick % (SIM_HZ / 2) == 0)
+        s->actions |= 1u << ACTION_INTERACT;
+    if (tick % (SIM_HZ * 10) == 0)
+        s->actions |= 1u << (ACTION_WEAPON_1 + (int)(tick / (SIM_HZ * 10)) % 5);
+
+    /* Pull the trigger on alternate steps, so single-shot weapons fire too. */
+    int *ahead;
+    int n = spatial_query_cone(SPATIAL_ENEMIES, px, py, cosf(angle), sinf(angle),
+                               BOT_AIM_HALF, BOT_AIM_RANGE, &ahead);
+    for (int k = 0; k < n; k++) {
+        if (enemies.state[ahead[k]] == ENEMY_ALIVE) {
+            if (tick & 1) s->buttons = SDL_BUTTON(SDL_BUTTON_LEFT);
+            break;
+        }
+    }
+}
+
+static int headless_simulate(const HeadlessOptions *opt)
+{
+    if (SDL_Init(SDL_INIT_EVENTS) != 0) {
+        fprintf(stderr, "HEADLESS: SDL_Init failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    (void)config_load_or_create();
+    apply_ai_config();
+
+    Bot bot;
+    memset(&bot, 0, sizeof bot);
+    bot.seed = 1u;
+    if (opt->replay) {
+        if (game_start_replay(opt->replay) < 0) {
+            SDL_Quit();
+            return -1;
+        }
+    } else {
+        game_start_level(opt->level);
+        input_script_start(bot_sample, &bot);
+    }
+    int start_level = game_level();
+
+    const char *why = "tick limit";
+    int ticks = 0;
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    while (ticks < opt->ticks) {
+        SDL_Event e;
+        int quit = 0;
+        while (input_next_event(&e)) {
+            if (!game_handle_event(&e)) quit = 1;
+        }
+        if (quit) {
+            why = "quit";
+            break;
+        }
+        if (input_replay_done()) {
+            why = "end of replay";
+            break;
+        }
+
+        GamePhase phase = game_phase();
+        if (phase == GAME_PHASE_CUTSCENE && !opt->replay) {
+            (void)game_next_level();
+            continue;
+        }
+        if (phase == GAME_PHASE_END) {
+            why = "game finished";
+            break;
+        }
+        if (phase != GAME_PHASE_PLAYING) {
+            /* Only the journal's events can leave the menus, and they are
+             * all handled already. */
+            why = "left the game";
+            break;
+        }
+
+        (void)game_step();
+        ticks++;
+        if (player_dead && !opt->replay) {
+            why = "player died";
+            break;
+        }
+    }
+    double sec = (double)(SDL_GetPerformanceCounter() - t0) / (double)SDL_GetPerformanceFrequency();
+
+    GameStateHash h;
+    game_state_hash(&h);
+    printf("HEADLESS: simulated %d ticks (%.1f s of game time) from level %d to %d in %.3f s: "
+           "%.0f ticks/s, stopped on %s\n",
+           ticks, (double)ticks / SIM_HZ, start_level, game_level(), sec,
+           sec > 0.0 ? (double)ticks / sec : 0.0, why);
+    printf("HEADLESS: state hash player %08x enemies %08x items %08x map %08x\n",
+           (unsigned)h.player, (unsigned)h.enemies, (unsigned)h.items, (unsigned)h.map);
+
+    input_stop();
+    if (trace_enabled()) (void)trace_finish();
+    free_map();
+    enemies_shutdown();
+    items_shutdown();
+    SDL_Quit();
+    return 0;
+}
+
+int headless_run(const HeadlessOptions *opt)
+{
+    if (opt->simulate)
+        return headless_simulate(opt);
+
+    HeadlessTarget target;
+    if (headless_open(&target) != 0)
+        return -1;
+
+    SDL_Renderer *renderer = target.renderer;
+    if (opt->renderer >= 0)
+        render_set_path((RenderPath)opt->renderer);
+    game_start_level(opt->level);
+
+    /* One full turn in place from the spawn point. */
+    const float startAngle = angle;
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    double total = 0.0, best = 1e30, worst = 0.0;
+
+    for (int f = 0; f < opt->frames; f++) {
+        angle = startAngle + 6.2831853f * (float)f / (float)opt->frames;
+
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        game_render_playing(renderer);
+        SDL_RenderPresent(renderer);
+        double ms = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq;
+
+        total += ms;
+        if (ms < best) best = ms;
+        if (ms > worst) worst = ms;
+
+        if (opt->dump_every > 0 && f % opt->dump_every == 0)
+            dump_frame(target.surface, opt->dump_dir, f);
+        trace_poll();
+    }
+
+    printf("HEADLESS: level %d, %s renderer, %d frames: avg %.3f ms, min %.3f ms, max %.3f ms\n",
+           opt->level, render_get_path() == RENDER_PATH_SOFTWARE ? "software" : "sdl",
+           opt->frames, total / opt->frames, best, worst);
+
+    headless_close(&target);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Headless mode.
+ *
+ * Renders in-game frames without a window or an audio device: SDL runs on
+ * the dummy video driver and the game draws through SDL's software
+ * renderer into an offscreen surface. The normal draw_world / sprite / HUD
+ * pipeline runs unchanged, so frame times are comparable between builds on
+ * machines without a display.
+ *
+ *   game --headless [--level N] [--frames N] [--renderer sdl|software]
+ *                   [--dump-every N] [--dump-dir DIR]
+ *
+ * With --simulate nothing is drawn and no window, renderer, texture or
+ * audio device is created: gameplay steps run back to back as fast as the
+ * CPU allows, with input from a journal (--replay, see input.h) or else
+ * from a scripted player that wanders the map, opens doors and shoots at
+ * what is ahead. Cutscenes are skipped. The run stops after N steps, when
+ * the journal ends, when the scripted player dies or when the game is
+ * over, and prints steps per second and hashes of the final game state:
+ *   game --headless --simulate [--ticks N] [--level N] [--replay FILE]
+ */
+typedef struct {
+    int level;       /* map to load, 1..9 */
+    int frames;      /* frames to render */
+    int renderer;    /* -1 = from config, else a RenderPath */
+    int dump_every;  /* save every Nth frame as a BMP, 0 = never */
+    const char *dump_dir;
+    int simulate;    /* 1 = simulate only, see above */
+    int ticks;       /* steps to simulate at most */
+    const char *replay; /* journal to simulate, NULL = scripted player */
+} HeadlessOptions;
+
+/* Offscreen render target shared with the benchmark (bench.c). */
+typedef struct {
+    SDL_Surface *surface;   /* W x H ARGB8888, holds the last presented frame */
+    SDL_Renderer *renderer;
+} HeadlessTarget;
+
+/* Start SDL on the dummy video driver without audio, create the offscreen
+ * renderer, apply the renderer settings from config.json and load the game
+ * assets. Returns 0 on success, -1 on failure. */
+int headless_open(HeadlessTarget *t);
+
+/* Release everything headless_open() created and quit SDL. */
+void headless_close(HeadlessTarget *t);
+
+/* Returns 1 if argv asks for headless mode and fills *opt, 0 otherwise. */
+int headless_parse_args(int argc, char *argv[], HeadlessOptions *opt);
+
+/* Render the frames into a headless target, or simulate, and print timings.
+ * Returns 0 on success, -1 on failure. */
+int headless_run(const HeadlessOptions *opt);
+
+#endif /* HEADLESS_H */
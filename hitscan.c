@@ -0,0 +1,73 @@
+#include <math.h>
+
+#include "hitscan.h"
+#include "enemy.h"
+#include "map.h"
+#include "spatial.h"
+
+/* Distance from (x, y) along the unit direction (dirX, dirY) to the first
+ * solid tile. The map's wall padding ends rays that reach the edge. */
+static float wall_distance(float x, float y, float dirX, float dirY)
+{
+    int mapX = (int)floorf(x);
+    int mapY = (int)floorf(y);
+
+    /* A player squeezed past an open edge stands in the padding. */
+    if (map_is(mapX, mapY, TILE_OPAQUE)) return 0.0f;
+
+    float deltaX = (dirX == 0.0f) ? 1e30f : fabsf(1.0f / dirX);
+    float deltaY = (dirY == 0.0f) ? 1e30f : fabsf(1.0f / dirY);
+    int stepX = dirX < 0.0f ? -1 : 1;
+    int stepY = dirY < 0.0f ? -1 : 1;
+    float sideX = (dirX < 0.0f ? x - (float)mapX : (float)mapX + 1.0f - x) * deltaX;
+    float sideY = (dirY < 0.0f ? y - (float)mapY : (float)mapY + 1.0f - y) * deltaY;
+
+    for (;;) {
+        float t;
+        if (sideX < sideY) {
+            t = sideX;
+            sideX += deltaX;
+            mapX += stepX;
+        } else {
+            t = sideY;
+            sideY += deltaY;
+            mapY += stepY;
+        }
+        if (map_is(mapX, mapY, TILE_OPAQUE)) return t;
+    }
+}
+
+void hitscan_trace(float x, float y, HitscanRay *rays, int n)
+{
+    SpatialRay segs[HITSCAN_MAX_RAYS];
+    if (n > HITSCAN_MAX_RAYS) n = HITSCAN_MAX_RAYS;
+
+    for (int k = 0; k < n; k++) {
+        segs[k].dirX = cosf(rays[k].angle);
+        segs[k].dirY = sinf(rays[k].angle);
+        segs[k].length = worldmap ? wall_distance(x, y, segs[k].dirX, segs[k].dirY) : 0.0f;
+        rays[k].wall = segs[k].length;
+        rays[k].enemy = -1;
+        rays[k].dist = segs[k].length;
+    }
+
+    int *near;
+    int m = spatial_query_rays(SPATIAL_ENEMIES, x, y, segs, n, HITSCAN_RADIUS, &near);
+    const float r2 = HITSCAN_RADIUS * HITSCAN_RADIUS;
+
+    for (int j = 0; j < m; j++) {
+        int i = near[j];
+        if (enemies.state[i] != ENEMY_ALIVE) continue;
+
+        float dx = enemies.x[i] - x;
+        float dy = enemies.y[i] - y;
+        float d2 = dx * dx + dy * dy;
+        for (int k = 0; k < n; k++) {
+            float along = dx * segs[k].dirX + dy * segs[k].dirY;
+            if (along <= 0.0f || along >= rays[k].dist) continue;
+            if (d2 - along * along > r2) continue;
+            rays[k].enemy = i;
+            rays[k].dist = along;
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef HITSCAN_H
+#define HITSCAN_H
+
+/*
+ * Hitscan shots.
+ *
+ * A shot is one or more rays from the player. Each ray runs through the
+ * grid like the renderer's rays and ends at the first solid tile
+ * (TILE_OPAQUE) or the edge of the map; it hits the nearest ALIVE enemy
+ * it passes within HITSCAN_RADIUS of before that, so walls stop shots.
+ * Enemies are found with the spatial index along the rays, so the cost
+ * follows how far the shot flies rather than how many enemies there are,
+ * and all the rays of a shot (shotgun pellets) share one query.
+ */
+
+/* How far off the ray an enemy's centre may be and still be hit. */
+#define HITSCAN_RADIUS 0.3f
+
+/* Rays traced together at most. */
+#define HITSCAN_MAX_RAYS 16
+
+typedef struct {
+    float angle;    /* in: direction, radians */
+    float wall;     /* out: distance to the first solid tile */
+    int enemy;      /* out: enemy index hit, -1 = none */
+    float dist;     /* out: distance along the ray to that enemy */
+} HitscanRay;
+
+/* Trace n rays (at most HITSCAN_MAX_RAYS) from (x, y). */
+void hitscan_trace(float x, float y, HitscanRay *rays, int n);
+
+#endif /* HITSCAN_H */
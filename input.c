@@ -0,0 +1,453 @@
+#include <SDL2/SDL.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input.h"
+#include "timestep.h"
+
+static const char journal_magic[4] = { 'E', 'T', 'A', 'J' };
+
+/* Record kinds. A sample record sets the bits of whatever it carries. */
+#define REC_ACTIONS 0x01    /* u16 actions */
+#define REC_BUTTONS 0x02    /* u8 buttons */
+#define REC_MOUSE   0x04    /* s16 dx, s16 dy */
+#define REC_SAMPLE_MASK 0x07
+#define REC_KEYDOWN 0x40    /* u16 scancode, u16 modifiers */
+#define REC_TEXT    0x41    /* u8 length, bytes */
+#define REC_END     0xFF    /* last step */
+
+typedef struct {
+    Uint32 tick;
+    Uint8 kind;
+    InputSample sample;     /* sample records: fields named by kind */
+    Uint16 scancode, mod;   /* REC_KEYDOWN */
+    char text[SDL_TEXTINPUTEVENT_TEXT_SIZE]; /* REC_TEXT */
+} JournalRecord;
+
+static InputMode mode = INPUT_LIVE;
+static Uint32 tick = 0;             /* samples taken since the start */
+
+/* Recording */
+static FILE *rec_file = NULL;
+static Uint32 rec_tick = 0;         /* step of the last record written */
+static InputSample rec_prev;
+
+/* Script */
+static InputScriptFn script_fn = NULL;
+static void *script_user = NULL;
+
+/* Replay */
+static JournalRecord *recs = NULL;
+static int rec_count = 0;
+static int sample_pos = 0;          /* next record for input_sample() */
+static int event_pos = 0;           /* next record for input_next_event() */
+static Uint32 end_tick = 0;
+static InputSample play_state;      /* actions and buttons held */
+
+InputMode input_mode(void)
+{
+    return mode;
+}
+
+/* ------------------------------------------------------------
+ * Writing
+ * ------------------------------------------------------------ */
+static void put_u8(unsigned v)
+{
+    fputc((int)(v & 0xFF), rec_file);
+}
+
+static void put_u16(unsigned v)
+{
+    put_u8(v);
+    put_u8(v >> 8);
+}
+
+static void put_u32(Uint32 v)
+{
+    put_u16(v & 0xFFFF);
+    put_u16(v >> 16);
+}
+
+static void put_varint(Uint32 v)
+{
+    while (v >= 0x80) {
+        put_u8((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    put_u8(v);
+}
+
+static void put_record(unsigned kind)
+{
+    put_u8(kind);
+    put_varint(tick - rec_tick);
+    rec_tick = tick;
+}
+
+int input_record_start(const char *path, const InputJournalHeader *h)
+{
+    input_stop();
+
+    rec_file = fopen(path, "wb");
+    if (!rec_file) {
+        fprintf(stderr, "INPUT: cannot create journal %s\n", path);
+        return -1;
+    }
+
+    Uint32 sens;
+    memcpy(&sens, &h->mouse_sensitivity, sizeof sens);
+
+    fwrite(journal_magic, 1, sizeof journal_magic, rec_file);
+    put_u16(INPUT_JOURNAL_VERSION);
+    put_u8((unsigned)h->level);
+    put_u32(h->seed);
+    put_u32(sens);
+    put_u8(h->ai_lod ? 1u : 0u);
+    put_u16((unsigned)h->ai_near_tiles);
+    put_u16((unsigned)h->ai_far_tiles);
+    put_u8((unsigned)h->ai_mid_interval);
+
+    mode = INPUT_RECORDING;
+    tick = 0;
+    rec_tick = 0;
+    memset(&rec_prev, 0, sizeof rec_prev);
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Reading
+ * ------------------------------------------------------------ */
+typedef struct {
+    const Uint8 *p, *end;
+    int ok;                 /* 0 once a read ran past the end */
+} Reader;
+
+static unsigned get_u8(Reader *r)
+{
+    if (r->p >= r->end) {
+        r->ok = 0;
+        return 0;
+    }
+    return *r->p++;
+}
+
+static unsigned get_u16(Reader *r)
+{
+    unsigned lo = get_u8(r);
+    return lo | (get_u8(r) << 8);
+}
+
+static Uint32 get_u32(Reader *r)
+{
+    Uint32 lo = get_u16(r);
+    return lo | ((Uint32)get_u16(r) << 16);
+}
+
+static Uint32 get_varint(Reader *r)
+{
+    Uint32 v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned b = get_u8(r);
+        v |= (Uint32)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+static Uint8 *read_file(const char *path, size_t *len)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    Uint8 *buf = NULL;
+    long sz = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) sz = ftell(fp);
+    if (sz >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        buf = (Uint8 *)malloc((size_t)sz + 1u);
+        if (buf) *len = fread(buf, 1, (size_t)sz, fp);
+    }
+    fclose(fp);
+    return buf;
+}
+
+/* Decode the records after the header. A journal cut short (the game
+ * crashed while recording) plays up to its last complete record. */
+static int parse_records(Reader *r)
+{
+    int cap = 0;
+    Uint32 t = 0;
+
+    while (r->p < r->end) {
+        JournalRecord rec;
+        memset(&rec, 0, sizeof rec);
+        rec.kind = (Uint8)get_u8(r);
+        t += get_varint(r);
+        rec.tick = t;
+
+        if (rec.kind == REC_END) {
+            if (r->ok) end_tick = t;
+            return 0;
+        } else if (rec.kind == REC_KEYDOWN) {
+            rec.scancode = (Uint16)get_u16(r);
+            rec.mod = (Uint16)get_u16(r);
+        } else if (rec.kind == REC_TEXT) {
+            unsigned n = get_u8(r);
+            if (n >= sizeof rec.text) r->ok = 0;
+            for (unsigned i = 0; r->ok && i < n; i++) rec.text[i] = (char)get_u8(r);
+        } else if (rec.kind != 0 && (rec.kind & ~REC_SAMPLE_MASK) == 0) {
+            if (rec.kind & REC_ACTIONS) rec.sample.actions = (Uint16)get_u16(r);
+            if (rec.kind & REC_BUTTONS) rec.sample.buttons = (Uint8)get_u8(r);
+            if (rec.kind & REC_MOUSE) {
+                rec.sample.mouse_dx = (Sint16)get_u16(r);
+                rec.sample.mouse_dy = (Sint16)get_u16(r);
+            }
+        } else {
+            r->ok = 0;
+        }
+        if (!r->ok) break;
+
+        if (rec_count == cap) {
+            int ncap = cap ? cap * 2 : 1024;
+            JournalRecord *grown = (JournalRecord *)realloc(recs, (size_t)ncap * sizeof *recs);
+            if (!grown) return -1;
+            recs = grown;
+            cap = ncap;
+        }
+        recs[rec_count++] = rec;
+        end_tick = t + 1;
+    }
+    return 0;
+}
+
+int input_replay_start(const char *path, InputJournalHeader *h)
+{
+    input_stop();
+
+    size_t len = 0;
+    Uint8 *buf = read_file(path, &len);
+    if (!buf) {
+        fprintf(stderr, "INPUT: cannot read journal %s\n", path);
+        return -1;
+    }
+
+    Reader r = { buf, buf + len, 1 };
+    int valid = len >= sizeof journal_magic && memcmp(buf, journal_magic, sizeof journal_magic) == 0;
+    r.p += sizeof journal_magic;
+    if (valid && get_u16(&r) != INPUT_JOURNAL_VERSION) valid = 0;
+
+    if (valid) {
+        h->level = (int)get_u8(&r);
+        h->seed = get_u32(&r);
+        Uint32 sens = get_u32(&r);
+        memcpy(&h->mouse_sensitivity, &sens, sizeof sens);
+        h->ai_lod = (int)get_u8(&r);
+        h->ai_near_tiles = (int)get_u16(&r);
+        h->ai_far_tiles = (int)get_u16(&r);
+        h->ai_mid_interval = (int)get_u8(&r);
+        valid = r.ok;
+    }
+
+    rec_count = 0;
+    end_tick = 0;
+    if (!valid || parse_records(&r) != 0) {
+        fprintf(stderr, "INPUT: %s is not a readable journal\n", path);
+        free(buf);
+        free(recs);
+        recs = NULL;
+        rec_count = 0;
+        return -1;
+    }
+    free(buf);
+
+    mode = INPUT_REPLAYING;
+    tick = 0;
+    sample_pos = 0;
+    event_pos = 0;
+    memset(&play_state, 0, sizeof play_state);
+    return 0;
+}
+
+void input_script_start(InputScriptFn fn, void *user)
+{
+    input_stop();
+    script_fn = fn;
+    script_user = user;
+    tick = 0;
+    mode = INPUT_SCRIPTED;
+}
+
+void input_stop(void)
+{
+    if (mode == INPUT_RECORDING && rec_file) {
+        put_record(REC_END);
+        fclose(rec_file);
+    }
+    rec_file = NULL;
+
+    if (mode == INPUT_REPLAYING || mode == INPUT_SCRIPTED) {
+        /* Do not turn the mouse moved meanwhile into one jump. */
+        SDL_GetRelativeMouseState(NULL, NULL);
+    }
+    script_fn = NULL;
+    script_user = NULL;
+
+    free(recs);
+    recs = NULL;
+    rec_count = 0;
+    mode = INPUT_LIVE;
+}
+
+int input_replay_done(void)
+{
+    return mode == INPUT_REPLAYING && tick >= end_tick && input_steps_until_event() == INT_MAX;
+}
+
+/* ------------------------------------------------------------
+ * Samples
+ * ------------------------------------------------------------ */
+static void sample_live(InputSample *s)
+{
+    const Uint8 *k = SDL_GetKeyboardState(NULL);
+    s->actions = 0;
+    for (int a = 0; a < ACTION_COUNT; a++) {
+        SDL_Scancode sc = config_get_bind((Action)a);
+        if (sc != SDL_SCANCODE_UNKNOWN && k[sc]) s->actions |= (Uint16)(1u << a);
+    }
+
+    int dx = 0, dy = 0;
+    s->buttons = (Uint8)SDL_GetRelativeMouseState(&dx, &dy);
+    s->mouse_dx = (Sint16)(dx < SHRT_MIN ? SHRT_MIN : (dx > SHRT_MAX ? SHRT_MAX : dx));
+    s->mouse_dy = (Sint16)(dy < SHRT_MIN ? SHRT_MIN : (dy > SHRT_MAX ? SHRT_MAX : dy));
+}
+
+static void record_sample(const InputSample *s)
+{
+    unsigned kind = 0;
+    if (s->actions != rec_prev.actions) kind |= REC_ACTIONS;
+    if (s->buttons != rec_prev.buttons) kind |= REC_BUTTONS;
+    if (s->mouse_dx || s->mouse_dy) kind |= REC_MOUSE;
+
+    if (kind) {
+        put_record(kind);
+        if (kind & REC_ACTIONS) put_u16(s->actions);
+        if (kind & REC_BUTTONS) put_u8(s->buttons);
+        if (kind & REC_MOUSE) {
+            put_u16((Uint16)s->mouse_dx);
+            put_u16((Uint16)s->mouse_dy);
+        }
+    }
+    rec_prev = *s;
+
+    /* Keep what a crash would lose to about a second. */
+    if (tick % SIM_HZ == 0) fflush(rec_file);
+}
+
+static void sample_replay(InputSample *s)
+{
+    *s = play_state;
+    s->mouse_dx = 0;
+    s->mouse_dy = 0;
+
+    for (; sample_pos < rec_count && recs[sample_pos].tick <= tick; sample_pos++) {
+        const JournalRecord *rec = &recs[sample_pos];
+        if (!(rec->kind & REC_SAMPLE_MASK) || rec->kind == REC_END) continue;
+        if (rec->kind & REC_ACTIONS) s->actions = rec->sample.actions;
+        if (rec->kind & REC_BUTTONS) s->buttons = rec->sample.buttons;
+        if (rec->kind & REC_MOUSE) {
+            s->mouse_dx = rec->sample.mouse_dx;
+            s->mouse_dy = rec->sample.mouse_dy;
+        }
+    }
+    play_state.actions = s->actions;
+    play_state.buttons = s->buttons;
+}
+
+void input_sample(InputSample *s)
+{
+    if (mode == INPUT_REPLAYING) {
+        sample_replay(s);
+    } else if (mode == INPUT_SCRIPTED) {
+        memset(s, 0, sizeof *s);
+        script_fn(tick, s, script_user);
+    } else {
+        sample_live(s);
+        if (mode == INPUT_RECORDING) record_sample(s);
+    }
+    tick++;
+}
+
+/* ------------------------------------------------------------
+ * Events
+ * ------------------------------------------------------------ */
+static int is_event_record(const JournalRecord *rec)
+{
+    return rec->kind == REC_KEYDOWN || rec->kind == REC_TEXT;
+}
+
+int input_steps_until_event(void)
+{
+    if (mode != INPUT_REPLAYING) return INT_MAX;
+    while (event_pos < rec_count && !is_event_record(&recs[event_pos])) event_pos++;
+    if (event_pos >= rec_count) return INT_MAX;
+    return recs[event_pos].tick > tick ? (int)(recs[event_pos].tick - tick) : 0;
+}
+
+static int is_live_input(const SDL_Event *e)
+{
+    switch (e->type) {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_TEXTINPUT:
+        case SDL_TEXTEDITING:
+        case SDL_MOUSEMOTION:
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+        case SDL_MOUSEWHEEL:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void record_event(const SDL_Event *e)
+{
+    if (e->type == SDL_KEYDOWN && e->key.repeat == 0) {
+        put_record(REC_KEYDOWN);
+        put_u16((unsigned)e->key.keysym.scancode);
+        put_u16(e->key.keysym.mod);
+    } else if (e->type == SDL_TEXTINPUT) {
+        size_t n = strlen(e->text.text);
+        put_record(REC_TEXT);
+        put_u8((unsigned)n);
+        fwrite(e->text.text, 1, n, rec_file);
+    }
+}
+
+int input_next_event(SDL_Event *e)
+{
+    if (mode == INPUT_REPLAYING && input_steps_until_event() == 0) {
+        const JournalRecord *rec = &recs[event_pos++];
+        memset(e, 0, sizeof *e);
+        if (rec->kind == REC_KEYDOWN) {
+            e->type = SDL_KEYDOWN;
+            e->key.state = SDL_PRESSED;
+            e->key.keysym.scancode = (SDL_Scancode)rec->scancode;
+            e->key.keysym.sym = SDL_GetKeyFromScancode((SDL_Scancode)rec->scancode);
+            e->key.keysym.mod = rec->mod;
+        } else {
+            e->type = SDL_TEXTINPUT;
+            memcpy(e->text.text, rec->text, sizeof rec->text);
+        }
+        return 1;
+    }
+
+    while (SDL_PollEvent(e)) {
+        if ((mode == INPUT_REPLAYING || mode == INPUT_SCRIPTED) && is_live_input(e)) continue;
+        if (mode == INPUT_RECORDING) record_event(e);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL2/SDL.h>
+
+#include "config.h"
+
+/*
+ * Player input, with recording and replay.
+ *
+ * Gameplay reads input in two places: update_player() takes one sample per
+ * simulation step (input_sample()), and the game loop handles key and text
+ * events between steps (input_next_event()). Both can be recorded into a
+ * journal file and played back from one. A replay gives the same events
+ * and samples on the same steps, so with the same map and settings the
+ * game runs exactly as it did when it was recorded. Samples can also come
+ * from a script (a function called once per step), for runs without a
+ * player.
+ *
+ * The journal is a small header followed by records. Each record holds its
+ * step as a varint delta from the one before. Samples are only written
+ * when something changed, and mouse deltas only when they are not zero.
+ * Actions are stored rather than scancodes, so a replay does not depend on
+ * the key bindings.
+ */
+
+#define INPUT_JOURNAL_VERSION 1
+
+typedef enum {
+    INPUT_LIVE = 0,
+    INPUT_RECORDING,
+    INPUT_REPLAYING,
+    INPUT_SCRIPTED
+} InputMode;
+
+/* One step's input. */
+typedef struct {
+    Uint16 actions;             /* bit (1 << Action) per held action */
+    Uint8 buttons;              /* SDL_BUTTON() mask */
+    Sint16 mouse_dx, mouse_dy;  /* relative motion since the last sample */
+} InputSample;
+
+/* Everything besides input that a replay needs to match the recording. */
+typedef struct {
+    int level;
+    Uint32 seed;
+    float mouse_sensitivity;
+    int ai_lod, ai_near_tiles, ai_far_tiles, ai_mid_interval;
+} InputJournalHeader;
+
+InputMode input_mode(void);
+
+/* Start writing a journal. Returns 0 on success, -1 if the file cannot be
+ * created. */
+int input_record_start(const char *path, const InputJournalHeader *h);
+
+/* Load a journal and start playing it back. Returns 0 and fills *h on
+ * success, -1 if the file cannot be read or is not a journal. */
+int input_replay_start(const char *path, InputJournalHeader *h);
+
+/* Fills in the sample for a step; tick counts the samples taken before. */
+typedef void (*InputScriptFn)(Uint32 tick, InputSample *s, void *user);
+
+/* Take samples from fn instead of the keyboard and mouse. */
+void input_script_start(InputScriptFn fn, void *user);
+
+/* Finish the recording, replay or script and go back to live input. */
+void input_stop(void);
+
+/* 1 once a replay has given out all of its steps. */
+int input_replay_done(void);
+
+/* Input for the next simulation step. */
+void input_sample(InputSample *s);
+
+/* 1 if the action is held in s. */
+static inline int input_held(const InputSample *s, Action a)
+{
+    return (s->actions >> a) & 1;
+}
+
+/* Next event for the game loop to handle, from the journal during a replay
+ * and from SDL otherwise. Live key and text input is dropped during a
+ * replay or script; while recording, key downs and text are written down.
+ * Returns 0 when there are no more events this frame. */
+int input_next_event(SDL_Event *e);
+
+/* Steps that may run before the replay's next event is due (INT_MAX if
+ * there is none, or when not replaying). */
+int input_steps_until_event(void);
+
+#endif /* INPUT_H */
@@ -1,5 +1,6 @@
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "items.h"
 #include "map.h"
@@ -7,57 +8,124 @@
 #include "player.h"
 #include "audio.h"
 #include "game.h"
+#include "spatial.h"
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-Item items[MAX_ITEMS];
-int item_count = 0;
+ItemPool items;
 
 /* Texture pointers live in render.c (declared in render.h). */
 
-static int is_item_tile(int v)
+int item_type_valid(int v)
 {
     return (v == ITEM_BULLETS || v == ITEM_MEDKIT || v == ITEM_SHOTGUN ||
             v == ITEM_SMG || v == ITEM_SHELLS || v == ITEM_ENERGY ||
             v == ITEM_PLASMA || v == ITEM_RRG);
 }
 
+/* Resize arr to n entries, or return -1 from the caller and leave it as
+ * it was. */
+#define GROW_ARRAY(arr, n) do {                                        \
+        void *grown_ = realloc((arr), (size_t)(n) * sizeof *(arr));    \
+        if (!grown_) return -1;                                        \
+        (arr) = grown_;                                                \
+    } while (0)
+
+static int reserve(int need)
+{
+    if (need <= items.capacity) return 0;
+
+    int cap = items.capacity ? items.capacity : 64;
+    while (cap < need) cap *= 2;
+
+    /* Arrays that did grow stay grown; capacity only moves once all did. */
+    GROW_ARRAY(items.x, cap);
+    GROW_ARRAY(items.y, cap);
+    GROW_ARRAY(items.type, cap);
+    if (spatial_reserve(SPATIAL_ITEMS, cap) != 0) return -1;
+
+    items.capacity = cap;
+    return 0;
+}
+
+/* Swap-remove item i: the last item takes its index. */
+static void remove_item(int i)
+{
+    int last = items.count - 1;
+    spatial_swap_remove(SPATIAL_ITEMS, i, last);
+    items.x[i] = items.x[last];
+    items.y[i] = items.y[last];
+    items.type[i] = items.type[last];
+    items.count = last;
+}
+
+void items_clear(void)
+{
+    items.count = 0;
+    (void)spatial_reset(SPATIAL_ITEMS, items.capacity);
+}
+
+void items_shutdown(void)
+{
+    free(items.x);
+    free(items.y);
+    free(items.type);
+    items = (ItemPool){0};
+}
+
+int item_spawn(ItemType type, float x, float y)
+{
+    if (reserve(items.count + 1) != 0) return -1;
+
+    int i = items.count++;
+    items.x[i] = x;
+    items.y[i] = y;
+    items.type[i] = (Uint8)type;
+    spatial_insert(SPATIAL_ITEMS, i, x, y);
+    return i;
+}
+
 void init_items(void)
 {
-    item_count = 0;
+    items_clear();
     if (!worldmap) return;
 
     for (int y = 0; y < worldHeight; y++) {
         for (int x = 0; x < worldWidth; x++) {
-            int v = worldmap[y][x];
-            if (is_item_tile(v) && item_count < MAX_ITEMS) {
-                items[item_count].x = x + 0.5f;
-                items[item_count].y = y + 0.5f;
-                items[item_count].type = (ItemType)v;
-                items[item_count].collected = 0;
-                worldmap[y][x] = 0;
-                item_count++;
+            int v = map_tile(x, y);
+            if (!tile_is(v, TILE_PICKUP)) continue;
+
+            if (item_spawn((ItemType)v, x + 0.5f, y + 0.5f) < 0) {
+                fprintf(stderr, "ITEMS: out of memory, item at %d,%d dropped\n", x, y);
+                continue;
             }
+            map_set_tile(x, y, 0);
         }
     }
 }
 
+/* Pickup reach from the player's position. */
+#define PICKUP_RADIUS 0.7f
+
+static int index_asc(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
 void update_items(void)
 {
-    for (int i = 0; i < item_count; i++) {
-        Item *it = &items[i];
-        if (it->collected) continue;
+    int *nearby;
+    int n = spatial_query_radius(SPATIAL_ITEMS, px, py, PICKUP_RADIUS, &nearby);
+    if (n == 0) return;
 
-        float dx = it->x - px;
-        float dy = it->y - py;
-        float dist = sqrtf(dx * dx + dy * dy);
-        if (dist >= 0.7f) continue;
+    /* Pick up in index order, as a full scan would: with two weapons in
+     * reach the later one is equipped and its message shown. */
+    qsort(nearby, (size_t)n, sizeof nearby[0], index_asc);
+
+    for (int k = 0; k < n; k++) {
+        int i = nearby[k];
 
         audio_play_sfx(SFX_ITEM);
 
-        switch (it->type) {
+        switch ((ItemType)items.type[i]) {
             case ITEM_BULLETS:
                 ammo_bullets += 3;
                 if (ammo_bullets > 999) ammo_bullets = 999;
@@ -106,85 +174,42 @@ void update_items(void)
                 show_message("RRG ACQUIRED");
                 break;
         }
-
-        it->collected = 1;
     }
+
+    /* Removing an item moves the last one into its place, so remove from
+     * the highest index down: the items still to go never move. */
+    for (int k = n - 1; k >= 0; k--)
+        remove_item(nearby[k]);
 }
 
-void draw_items(SDL_Renderer *renderer)
+void submit_items(const RayView *view)
 {
-    if (!renderer) return;
-
-    for (int i = 0; i < item_count; i++) {
-        Item *it = &items[i];
-        if (it->collected) continue;
-
-        float dx = it->x - px;
-        float dy = it->y - py;
-        float dir = atan2f(dy, dx) - angle;
-        while (dir >  M_PI) dir -= 2 * (float)M_PI;
-        while (dir < -M_PI) dir += 2 * (float)M_PI;
-
-        if (fabsf(dir) >= FOV / 2) continue;
-
-        float sx = (dir + FOV / 2) / FOV * W;
-        float size = 80.0f / sqrtf(dx * dx + dy * dy);
-
-        /* Cull items that are behind walls by performing a simple visibility test.
-         * March a ray from the player to the item and see if a wall is encountered
-         * before reaching the item's tile. This is similar to the function in
-         * render.c but duplicated here to avoid cross-file dependencies. */
-        {
-            float tx = it->x;
-            float ty = it->y;
-            float odx = tx - px;
-            float ody = ty - py;
-            float odist = sqrtf(odx * odx + ody * ody);
-            int occluded = 0;
-            if (odist > 0.0f) {
-                float invD = 1.0f / odist;
-                float vx = odx * invD;
-                float vy = ody * invD;
-                float t = 0.0f;
-                const float step = 0.05f;
-                while (t < odist) {
-                    float cx = px + vx * t;
-                    float cy = py + vy * t;
-                    int mx = (int)cx;
-                    int my = (int)cy;
-                    if (mx < 0 || my < 0 || mx >= worldWidth || my >= worldHeight) {
-                        occluded = 1;
-                        break;
-                    }
-                    if (mx == (int)tx && my == (int)ty) {
-                        break;
-                    }
-                    if (worldmap[my][mx] >= 2) {
-                        occluded = 1;
-                        break;
-                    }
-                    t += step;
-                }
-            }
-            if (occluded) {
-                continue;
-            }
-        }
-
-        SDL_Texture *tex = NULL;
-        switch (it->type) {
-            case ITEM_BULLETS: tex = texAmmo; break;
-            case ITEM_MEDKIT:  tex = texMedkit; break;
-            case ITEM_SHOTGUN: tex = texShotgunItem; break;
-            case ITEM_SMG:     tex = texSMGItem; break;
-            case ITEM_SHELLS:  tex = texShells; break;
-            case ITEM_ENERGY:  tex = texEnergy; break;
-            case ITEM_PLASMA:  tex = texPlasmaItem; break;
-            case ITEM_RRG:     tex = texRRGItem; break;
+    /* Only items whose centre is inside the view cone can project. */
+    int *visible;
+    int n = spatial_query_cone(SPATIAL_ITEMS, view->px, view->py, view->dirX, view->dirY,
+                               FOV * 0.5f, 0.0f, &visible);
+
+    for (int k = 0; k < n; k++) {
+        int i = visible[k];
+
+        /* Project with the same camera plane as the walls. */
+        float sx, depth;
+        if (!raycast_project(view, items.x[i], items.y[i], &sx, &depth)) continue;
+        float size = 80.0f / depth;
+
+        const SpriteHandle *spr = NULL;
+        switch ((ItemType)items.type[i]) {
+            case ITEM_BULLETS: spr = &sprAmmo; break;
+            case ITEM_MEDKIT:  spr = &sprMedkit; break;
+            case ITEM_SHOTGUN: spr = &sprShotgunItem; break;
+            case ITEM_SMG:     spr = &sprSMGItem; break;
+            case ITEM_SHELLS:  spr = &sprShells; break;
+            case ITEM_ENERGY:  spr = &sprEnergy; break;
+            case ITEM_PLASMA:  spr = &sprPlasmaItem; break;
+            case ITEM_RRG:     spr = &sprRRGItem; break;
         }
-        if (!tex) continue;
+        if (!spr) continue;
 
-        SDL_RenderCopy(renderer, tex, NULL,
-                       &(SDL_Rect){(int)(sx - size / 2), (int)(H / 2 - size / 2), (int)size, (int)size});
+        sprites_submit(spr, sx, depth, size);
     }
 }
@@ -3,6 +3,8 @@
 
 #include <SDL2/SDL.h>
 
+#include "raycast.h"
+
 /*
  * Collectible items.
  * The numeric values correspond to tile encodings in map files.
@@ -19,20 +21,34 @@ typedef enum {
     ITEM_RRG         = 17
 } ItemType;
 
+/*
+ * Items waiting to be picked up, as a structure of arrays (entries
+ * 0..count-1 are in use; the arrays grow as needed). A collected item is
+ * swap-removed, so indices change when items are picked up.
+ */
 typedef struct {
-    float x;
-    float y;
-    ItemType type;
-    int collected;
-} Item;
-
-#define MAX_ITEMS 96
+    int count;
+    int capacity;
+    float *x, *y;
+    Uint8 *type;                /* ItemType */
+} ItemPool;
 
-extern Item items[MAX_ITEMS];
-extern int item_count;
+extern ItemPool items;
 
+/* Replace the pool with the pickups found in the current map. */
 void init_items(void);
+
+/* Remove every item (memory is kept) / release the pool's memory. */
+void items_clear(void);
+void items_shutdown(void);
+
+/* 1 if v is one of the ItemType values. */
+int item_type_valid(int v);
+
+/* Add an item. Returns its index, or -1 if out of memory. */
+int item_spawn(ItemType type, float x, float y);
 void update_items(void);
-void draw_items(SDL_Renderer *renderer);
+/* Queue the uncollected items with the sprite stage (see render.h). */
+void submit_items(const RayView *view);
 
 #endif /* ITEMS_H */
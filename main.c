@@ -1,10 +1,48 @@
 #include <SDL2/SDL.h>
 #include "game.h"
+#include "headless.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* --trace FILE [--trace-seconds N]: capture the first N seconds (default 5),
+ * asset loading included. */
+static void start_trace_from_args(int argc, char *argv[])
+{
+    const char *path = NULL;
+    int seconds = 5;
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0) path = argv[++i];
+        else if (strcmp(argv[i], "--trace-seconds") == 0) seconds = atoi(argv[++i]);
+    }
+
+    if (path)
+        trace_capture(path, seconds > 0 ? (Uint32)seconds * 1000 : 0);
+}
+
+/* --record FILE: journal the input of the first game started.
+ * --replay FILE: play a journal back instead of taking live input. */
+static void journal_from_args(int argc, char *argv[])
+{
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0) game_record_to(argv[++i]);
+        else if (strcmp(argv[i], "--replay") == 0) game_replay_from(argv[++i]);
+    }
+}
 
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
+    trace_init();
+    trace_set_thread_name("main");
+    start_trace_from_args(argc, argv);
+
+    HeadlessOptions hopt;
+    if (headless_parse_args(argc, argv, &hopt))
+        return headless_run(&hopt) == 0 ? 0 : 1;
+
+    journal_from_args(argc, argv);
 
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
 
@@ -1,33 +1,179 @@
 #include <SDL2/SDL.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
 
 #include "map.h"
+#include "trace.h"
+#include "spatial.h"
+#include "flowfield.h"
+#include "pathfind.h"
 
 /*
- * The world map is a dynamically allocated 2D array. It is implemented as an
- * array of pointers to rows for convenient indexing.
+ * The world map is one block of tiles with MAP_PAD rows and columns of wall
+ * around it (see map.h). map_block is the allocation; worldmap points at
+ * tile (0, 0) inside it.
+ *
+ * opaque_bits has one bit per tile, padding included, set for TILE_OPAQUE
+ * tiles: bit (x + MAP_PAD) of row (y + MAP_PAD), each row starting on a
+ * new word.
  */
-int **worldmap = NULL;
+static Uint16 *map_block = NULL;
+static Uint64 *opaque_bits = NULL;
+static int opaque_words = 0;    /* per row */
+Uint16 *worldmap = NULL;
+int worldStride = 0;
 int worldWidth = 0;
 int worldHeight = 0;
 float player_spawn_x = 1.5f;
 float player_spawn_y = 1.5f;
 int map_current_level = 0;
+Uint32 map_revision = 0;
 
 void free_map(void)
 {
-    if (worldmap) {
-        for (int y = 0; y < worldHeight; y++)
-            free(worldmap[y]);
-        free(worldmap);
-        worldmap = NULL;
-    }
+    free(map_block);
+    free(opaque_bits);
+    map_block = NULL;
+    opaque_bits = NULL;
+    opaque_words = 0;
+    worldmap = NULL;
+    worldStride = 0;
     worldWidth = 0;
     worldHeight = 0;
     map_current_level = 0;
+    map_revision++;
+
+    /* The entity indexes and the path searches are sized to the map. */
+    spatial_shutdown();
+    flowfield_shutdown();
+    pathfind_shutdown();
+}
+
+static void set_opaque_bit(int x, int y, int opaque)
+{
+    int bx = x + MAP_PAD;
+    Uint64 *w = &opaque_bits[(size_t)(y + MAP_PAD) * opaque_words + (bx >> 6)];
+    Uint64 bit = (Uint64)1 << (bx & 63);
+    if (opaque) *w |= bit;
+    else *w &= ~bit;
+}
+
+void map_set_tile(int x, int y, int tile)
+{
+    if (!worldmap || x < 0 || y < 0 || x >= worldWidth || y >= worldHeight) return;
+    if (tile < 0 || tile >= TILE_IDS) return;
+    Uint16 *t = &worldmap[y * worldStride + x];
+    if (*t == tile) return;
+    *t = (Uint16)tile;
+    set_opaque_bit(x, y, tile_is(tile, TILE_OPAQUE));
+    map_revision++;
+}
+
+/* 1 if any of columns x0..x1 of row y is opaque. */
+static int span_opaque(int y, int x0, int x1)
+{
+    const Uint64 *row = opaque_bits + (size_t)(y + MAP_PAD) * opaque_words;
+    int a = x0 + MAP_PAD, b = x1 + MAP_PAD;
+    int wa = a >> 6, wb = b >> 6;
+    Uint64 first = ~(Uint64)0 << (a & 63);
+    Uint64 last = ~(Uint64)0 >> (63 - (b & 63));
+
+    if (wa == wb) return (row[wa] & first & last) != 0;
+    if (row[wa] & first) return 1;
+    for (int i = wa + 1; i < wb; i++)
+        if (row[i]) return 1;
+    return (row[wb] & last) != 0;
+}
+
+static int clamp_tile(int v, int size)
+{
+    if (v < -MAP_PAD) return -MAP_PAD;
+    if (v > size - 1 + MAP_PAD) return size - 1 + MAP_PAD;
+    return v;
+}
+
+int map_line_clear(float x0, float y0, float x1, float y1)
+{
+    if (!opaque_bits) return 1;
+
+    if (y0 > y1) {
+        float t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    int ya = clamp_tile((int)floorf(y0), worldHeight);
+    int yb = clamp_tile((int)floorf(y1), worldHeight);
+    float slope = (y1 > y0) ? (x1 - x0) / (y1 - y0) : 0.0f;
+
+    /* Within one row a segment covers a single run of columns: from where
+     * it enters the row to where it leaves. */
+    for (int y = ya; y <= yb; y++) {
+        float xa = (y == ya) ? x0 : x0 + ((float)y - y0) * slope;
+        float xb = (y == yb) ? x1 : x0 + ((float)(y + 1) - y0) * slope;
+        int ca = (int)floorf(xa < xb ? xa : xb);
+        int cb = (int)floorf(xa < xb ? xb : xa);
+        if (span_opaque(y, clamp_tile(ca, worldWidth), clamp_tile(cb, worldWidth)))
+            return 0;
+    }
+    return 1;
+}
+
+static void fill_walls(Uint16 *t, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        t[i] = 2;
+}
+
+/* Make block (width x height tiles in their padding) the current map and
+ * build its opaque bitset. Returns 0 on success, -1 (and frees block) if
+ * out of memory. */
+static int attach_block(Uint16 *block, int width, int height)
+{
+    int stride = width + 2 * MAP_PAD;
+    int rows = height + 2 * MAP_PAD;
+    int words = (stride + 63) / 64;
+    Uint64 *bits = (Uint64 *)calloc((size_t)rows * (size_t)words, sizeof *bits);
+    if (!bits) {
+        free(block);
+        return -1;
+    }
+
+    map_block = block;
+    opaque_bits = bits;
+    opaque_words = words;
+    worldStride = stride;
+    worldWidth = width;
+    worldHeight = height;
+    worldmap = block + MAP_PAD * worldStride + MAP_PAD;
+
+    for (int y = 0; y < rows; y++) {
+        const Uint16 *t = block + (size_t)y * stride;
+        Uint64 *w = bits + (size_t)y * words;
+        for (int x = 0; x < stride; x++)
+            w[x >> 6] |= (Uint64)tile_is(t[x], TILE_OPAQUE) << (x & 63);
+    }
+    map_revision++;
+    return 0;
+}
+
+int map_create(int width, int height)
+{
+    free_map();
+    tiles_init();
+    if (width <= 0 || height <= 0) return -1;
+
+    size_t stride = (size_t)width + 2 * MAP_PAD;
+    size_t rows = (size_t)height + 2 * MAP_PAD;
+    Uint16 *block = (Uint16 *)malloc(rows * stride * sizeof *block);
+    if (!block) return -1;
+
+    fill_walls(block, rows * stride);
+    for (int y = 0; y < height; y++) {
+        Uint16 *row = block + (y + MAP_PAD) * stride + MAP_PAD;
+        memset(row, 0, (size_t)width * sizeof *row);
+    }
+    return attach_block(block, width, height);
 }
 
 static void map_path(int level, char *out, size_t outsz)
@@ -48,133 +194,174 @@ static void map_path(int level, char *out, size_t outsz)
     }
 }
 
-/* Parse the next integer token from *p and advance *p.
- * Returns 1 on success, 0 if no more tokens on the line.
- * On parse failure, returns 1 and sets *out to a safe default.
+static char *read_file(const char *path, size_t *out_len)
+{
+    if (out_len) *out_len = 0;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); return NULL; }
+    long sz = ftell(fp);
+    if (sz < 0) { fclose(fp); return NULL; }
+    if (fseek(fp, 0, SEEK_SET) != 0) { fclose(fp); return NULL; }
+
+    char *buf = (char *)malloc((size_t)sz + 1u);
+    if (!buf) { fclose(fp); return NULL; }
+
+    size_t n = fread(buf, 1, (size_t)sz, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    if (out_len) *out_len = n;
+    return buf;
+}
+
+static int is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* Parse the next tile on the line at *p and advance *p. Returns 1 on
+ * success, 0 at the end of the line (*p is left on the '\n').
+ * A token that is not a number, or a number outside 0..99, reads as a wall.
+ * Like strtol, digits followed by other characters give the number and
+ * leave the rest as the next token.
  */
-static int parse_next_int(char **p, int *out)
+static int parse_next_tile(const char **p, const char *end, int *out)
 {
-    if (!p || !*p || !out)
+    const char *s = *p;
+    while (s < end && is_blank(*s))
+        s++;
+    if (s == end || *s == '\n') {
+        *p = s;
         return 0;
+    }
 
-    while (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n')
-        (*p)++;
+    const char *token = s;
+    int neg = 0;
+    if (*s == '+' || *s == '-') {
+        neg = (*s == '-');
+        s++;
+    }
 
-    if (**p == '\0')
-        return 0;
+    const char *digits = s;
+    int v = 0;
+    while (s < end && *s >= '0' && *s <= '9') {
+        if (v <= 99) v = v * 10 + (*s - '0');
+        s++;
+    }
 
-    errno = 0;
-    char *end = NULL;
-    long v = strtol(*p, &end, 10);
-    if (end == *p) {
+    if (s == digits) {
         /* Not a number: consume until next whitespace and substitute a wall. */
-        while (**p && **p != ' ' && **p != '\t' && **p != '\r' && **p != '\n')
-            (*p)++;
+        s = token;
+        while (s < end && !is_blank(*s) && *s != '\n')
+            s++;
         *out = 2;
-        return 1;
-    }
-
-    /* Allow a wider tile id range so we can extend the game without rewriting maps. */
-    if (errno != 0 || v < 0 || v > 99) {
+    } else if (v > 99 || (neg && v != 0)) {
+        /* Allow a wider tile id range so we can extend the game without rewriting maps. */
         *out = 2;
     } else {
-        *out = (int)v;
+        *out = v;
     }
 
-    *p = end;
+    *p = s;
     return 1;
 }
 
-int load_map(int level)
+/* Parse the map text in [p, end) in one pass. Rows go straight into a
+ * padded block, sized from the first row's width and the file size and
+ * grown if the guess was short. */
+static int parse_map(const char *p, const char *end)
 {
-    free_map();
-
-    /* Reset spawn defaults so a malformed map can't inherit old values. */
-    player_spawn_x = 1.5f;
-    player_spawn_y = 1.5f;
-
-    char path[512];
-    map_path(level, path, sizeof path);
+    Uint16 *block = NULL;
+    size_t stride = 0;
+    size_t cap = 0; /* rows the block holds, padding included */
+    int width = 0;
+    int height = 0;
 
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
-        fprintf(stderr, "Failed to load map: %s\n", path);
-        return -1;
-    }
+    while (p < end) {
+        /* Skip blank lines. */
+        while (p < end && (is_blank(*p) || *p == '\n'))
+            p++;
+        if (p == end) break;
 
-    /* First pass: determine width/height. */
-    char line[2048];
-    worldWidth = 0;
-    worldHeight = 0;
+        int v;
+        if (!block) {
+            /* The first row sets the width. A tile takes at least two
+             * characters, so the rest of the file holds about this many. */
+            const char *scan = p;
+            while (parse_next_tile(&scan, end, &v))
+                width++;
+            stride = (size_t)width + 2 * MAP_PAD;
+            cap = (size_t)(end - p) / (2u * (size_t)width) + 1 + 2 * MAP_PAD;
+            block = (Uint16 *)malloc(cap * stride * sizeof *block);
+            if (!block) return -1;
+            fill_walls(block, MAP_PAD * stride);
+        }
 
-    while (fgets(line, sizeof line, fp)) {
-        char *p = line;
-        while (*p && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
-        if (!*p) continue;
-
-        int cols = 0;
-        char *scan = p;
-        int tmp;
-        while (parse_next_int(&scan, &tmp))
-            cols++;
-        worldWidth = cols;
-        break;
-    }
+        /* Room for this row and the padding below it. */
+        size_t r = (size_t)height + MAP_PAD;
+        if (r + MAP_PAD >= cap) {
+            Uint16 *grown = (Uint16 *)realloc(block, 2 * cap * stride * sizeof *block);
+            if (!grown) {
+                free(block);
+                return -1;
+            }
+            block = grown;
+            cap *= 2;
+        }
 
-    fseek(fp, 0, SEEK_SET);
-    while (fgets(line, sizeof line, fp)) {
-        char *p = line;
-        while (*p && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
-        if (*p)
-            worldHeight++;
-    }
+        Uint16 *row = block + r * stride;
+        fill_walls(row, stride);
+        row += MAP_PAD;
+        for (int x = 0; x < width && parse_next_tile(&p, end, &v); x++) {
+            if (tile_is(v, TILE_START)) {
+                player_spawn_x = x + 0.5f;
+                player_spawn_y = height + 0.5f;
+                v = 0;
+            }
+            row[x] = (Uint16)v;
+        }
 
-    if (worldWidth <= 0 || worldHeight <= 0) {
-        fclose(fp);
-        return -1;
+        /* Tiles past the width are ignored. */
+        while (p < end && *p != '\n')
+            p++;
+        height++;
     }
 
-    worldmap = (int **)calloc((size_t)worldHeight, sizeof(int *));
-    if (!worldmap) {
-        fclose(fp);
-        return -1;
-    }
-    for (int y = 0; y < worldHeight; y++) {
-        worldmap[y] = (int *)calloc((size_t)worldWidth, sizeof(int));
-        if (!worldmap[y]) {
-            fclose(fp);
-            free_map();
-            return -1;
-        }
-    }
+    if (!block) return -1;
+    fill_walls(block + ((size_t)height + MAP_PAD) * stride, MAP_PAD * stride);
+    return attach_block(block, width, height);
+}
 
-    fseek(fp, 0, SEEK_SET);
-    int y = 0;
-    while (fgets(line, sizeof line, fp) && y < worldHeight) {
-        char *p = line;
-        while (*p && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
-        if (!*p) continue;
+int load_map_path(const char *path, int level)
+{
+    trace_begin("load_map");
+    free_map();
+    tiles_init();
 
-        for (int x = 0; x < worldWidth; x++) {
-            int v = 2; /* default wall */
-            (void)parse_next_int(&p, &v);
-            worldmap[y][x] = v;
+    /* Reset spawn defaults so a malformed map can't inherit old values. */
+    player_spawn_x = 1.5f;
+    player_spawn_y = 1.5f;
 
-            if (v == 8) {
-                player_spawn_x = x + 0.5f;
-                player_spawn_y = y + 0.5f;
-                worldmap[y][x] = 0;
-            }
-        }
-        y++;
+    size_t size = 0;
+    char *text = read_file(path, &size);
+    int rc = -1;
+    if (!text) {
+        fprintf(stderr, "Failed to load map: %s\n", path);
+    } else {
+        rc = parse_map(text, text + size);
+        free(text);
     }
 
-    for (; y < worldHeight; y++) {
-        for (int x = 0; x < worldWidth; x++)
-            worldmap[y][x] = 2;
-    }
+    if (rc == 0)
+        map_current_level = (level < 1) ? 1 : (level > 9) ? 9 : level;
+    trace_end("load_map");
+    return rc;
+}
 
-    fclose(fp);
-    map_current_level = (level < 1) ? 1 : (level > 9) ? 9 : level;
-    return 0;
+int load_map(int level)
+{
+    char path[512];
+    map_path(level, path, sizeof path);
+    return load_map_path(path, level);
 }
@@ -3,15 +3,19 @@
 
 #include <SDL2/SDL.h>
 
+#include "tiles.h"
+
 /*
  * Dynamic world map system.
  *
  * Map files live under DATA/maps/ as:
  *   map1.txt .. map9.txt
  *
- * Each file is whitespace-separated integers.
+ * Each file is whitespace-separated integers, one line per row of tiles.
+ * The first non-blank line sets the width; blank lines are skipped, short
+ * rows are filled with walls and values outside 0..99 become walls.
  *
- * Tile encodings:
+ * Tile encodings (their properties are in the registry, tiles.h):
  * 0  – empty floor (walkable)
  * 1  – key (collect with E)
  * 2  – wall (solid, wall1)
@@ -32,7 +36,16 @@
  * 17 – RRG pickup (weapon)
  */
 
-extern int **worldmap;
+/* Tiles outside the map on each side. They are walls (2), so a grid walk
+ * that starts on the map and stops at walls never leaves the padding. */
+#define MAP_PAD 1
+
+/* The tiles, row by row in one block: tile (x, y) is
+ * worldmap[y * worldStride + x]. worldmap points at tile (0, 0) inside the
+ * padding, so x and y may go MAP_PAD tiles past either edge. NULL when no
+ * map is loaded. */
+extern Uint16 *worldmap;
+extern int worldStride;
 extern int worldWidth;
 extern int worldHeight;
 extern float player_spawn_x;
@@ -41,9 +54,44 @@ extern float player_spawn_y;
 /* Last successfully loaded level number (1..9). */
 extern int map_current_level;
 
+/* Changes whenever the tiles do (a map is freed or loaded, or
+ * map_set_tile() changes a tile), so anything computed from the tiles can
+ * tell it is stale. */
+extern Uint32 map_revision;
+
 void free_map(void);
 
+/* Tile at (x, y), which must be on the map or in its padding. */
+static inline int map_tile(int x, int y)
+{
+    return worldmap[y * worldStride + x];
+}
+
+/* 1 if the tile at (x, y) has any of the TILE_* flags. */
+static inline int map_is(int x, int y, Uint8 flags)
+{
+    return tile_is(map_tile(x, y), flags);
+}
+
+/* 1 if the segment from (x0, y0) to (x1, y1), both on the map, passes
+ * through no TILE_OPAQUE tile. The map keeps a bitset of its opaque tiles,
+ * so each row the segment crosses is checked up to 64 tiles at a time. */
+int map_line_clear(float x0, float y0, float x1, float y1);
+
+/* Allocate a width x height map of floor (0) in its wall padding, in place
+ * of the current one. For maps that are generated rather than loaded.
+ * Returns 0 on success, -1 on failure. */
+int map_create(int width, int height);
+
+/* Change one tile during play (keys picked up, doors opened). Off-map
+ * coordinates are ignored. */
+void map_set_tile(int x, int y, int tile);
+
 /* Load map for the given level (1–9). Returns 0 on success, -1 on failure. */
 int load_map(int level);
 
+/* Load a map file from path, leaving map_current_level at level. Returns 0
+ * on success, -1 on failure. */
+int load_map_path(const char *path, int level);
+
 #endif /* MAP_H */
@@ -0,0 +1,68 @@
+#include <SDL2/SDL.h>
+
+#include "mipmap.h"
+
+SDL_Surface *mip_downsample(SDL_Surface *src)
+{
+    if (!src || src->format->format != SDL_PIXELFORMAT_ARGB8888) return NULL;
+    if (src->w <= 1 && src->h <= 1) return NULL;
+
+    int sw = src->w, sh = src->h;
+    int w = sw > 1 ? sw / 2 : 1;
+    int h = sh > 1 ? sh / 2 : 1;
+
+    SDL_Surface *dst = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!dst) return NULL;
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+    for (int y = 0; y < h; y++) {
+        /* Source footprint of this row; with odd sizes the last footprint
+         * takes the leftover texel. */
+        int y0 = y * sh / h, y1 = (y + 1) * sh / h;
+        Uint32 *out = (Uint32 *)((Uint8 *)dst->pixels + (size_t)y * (size_t)dst->pitch);
+
+        for (int x = 0; x < w; x++) {
+            int x0 = x * sw / w, x1 = (x + 1) * sw / w;
+            Uint32 sa = 0, sr = 0, sg = 0, sb = 0, n = 0;
+
+            for (int yy = y0; yy < y1; yy++) {
+                const Uint32 *row = (const Uint32 *)((const Uint8 *)src->pixels +
+                                                     (size_t)yy * (size_t)src->pitch);
+                for (int xx = x0; xx < x1; xx++) {
+                    Uint32 p = row[xx];
+                    Uint32 a = p >> 24;
+                    sa += a;
+                    sr += ((p >> 16) & 0xFF) * a;
+                    sg += ((p >> 8) & 0xFF) * a;
+                    sb += (p & 0xFF) * a;
+                    n++;
+                }
+            }
+
+            if (sa == 0) {
+                out[x] = 0;
+                continue;
+            }
+            Uint32 a = (sa + n / 2) / n;
+            Uint32 r = (sr + sa / 2) / sa;
+            Uint32 g = (sg + sa / 2) / sa;
+            Uint32 b = (sb + sa / 2) / sa;
+            out[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+
+    return dst;
+}
+
+int mip_level_for(float texels_per_pixel, int levels)
+{
+    int level = 0;
+    while (level + 1 < levels && texels_per_pixel >= 2.0f) {
+        texels_per_pixel *= 0.5f;
+        level++;
+    }
+    return level;
+}
@@ -0,0 +1,28 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Mip chains.
+ *
+ * Textures are minified at load time by repeated 2x2 box filtering, so
+ * distant walls, floor rows and sprites can sample a level whose texels are
+ * about one screen pixel in size instead of skipping through the full
+ * resolution image (which shimmers and touches more texture memory).
+ */
+
+/* 128x128 down to 1x1. */
+#define MIP_MAX_LEVELS 8
+
+/* Return a new ARGB8888 surface half the size of src (odd sizes round down,
+ * never below 1). Colour is weighted by alpha so transparent texels do not
+ * darken edges. src must be ARGB8888. Returns NULL if src is already 1x1
+ * or on allocation failure. */
+SDL_Surface *mip_downsample(SDL_Surface *src);
+
+/* Level to sample when texels_per_pixel texels of level 0 map onto one
+ * screen pixel: floor(log2(texels_per_pixel)), clamped to [0, levels - 1]. */
+int mip_level_for(float texels_per_pixel, int levels);
+
+#endif /* MIPMAP_H */
@@ -0,0 +1,157 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+
+#include "pacing.h"
+
+/* The limiter stops sleeping this long before the deadline and spins for
+ * the rest. */
+#define PACING_SPIN_MS 2
+
+/* Static screens still wake up this often, so a missed event can never
+ * leave the screen stale for long. */
+#define PACING_IDLE_MS 1000
+
+static int target_fps = 60;
+static Uint64 frame_period = 0;   /* performance counter ticks per frame */
+static Uint64 next_deadline = 0;
+
+static int dirty = 1;
+static Uint32 redraw_at = 0;      /* 0 = none pending */
+
+static int win_hidden = 0;
+static int win_minimized = 0;
+static int win_unfocused = 0;
+
+static int display_refresh_rate(SDL_Window *win)
+{
+    SDL_DisplayMode mode;
+    int idx = win ? SDL_GetWindowDisplayIndex(win) : 0;
+    if (idx < 0) idx = 0;
+    if (SDL_GetCurrentDisplayMode(idx, &mode) == 0 && mode.refresh_rate > 0)
+        return mode.refresh_rate;
+    return 60;
+}
+
+void pacing_configure(SDL_Window *win, SDL_Renderer *r, int fps, int vsync)
+{
+    if (r) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        if (SDL_RenderSetVSync(r, vsync ? 1 : 0) != 0)
+            fprintf(stderr, "PACING: SDL_RenderSetVSync failed: %s\n", SDL_GetError());
+#else
+        (void)vsync;
+#endif
+    }
+
+    target_fps = (fps > 0) ? fps : display_refresh_rate(win);
+    frame_period = SDL_GetPerformanceFrequency() / (Uint64)target_fps;
+    next_deadline = 0;
+    dirty = 1;
+}
+
+int pacing_get_target_fps(void)
+{
+    return target_fps;
+}
+
+void pacing_handle_event(const SDL_Event *e)
+{
+    if (e->type == SDL_WINDOWEVENT) {
+        switch (e->window.event) {
+            case SDL_WINDOWEVENT_HIDDEN:       win_hidden = 1; break;
+            case SDL_WINDOWEVENT_SHOWN:        win_hidden = 0; break;
+            case SDL_WINDOWEVENT_MINIMIZED:    win_minimized = 1; break;
+            case SDL_WINDOWEVENT_RESTORED:
+            case SDL_WINDOWEVENT_MAXIMIZED:    win_minimized = 0; break;
+            case SDL_WINDOWEVENT_FOCUS_LOST:   win_unfocused = 1; break;
+            case SDL_WINDOWEVENT_FOCUS_GAINED: win_unfocused = 0; break;
+            default: break;
+        }
+    }
+    dirty = 1;
+}
+
+void pacing_invalidate(void)
+{
+    dirty = 1;
+}
+
+void pacing_redraw_at(Uint32 ticks)
+{
+    if (ticks == 0) return;
+    if (redraw_at == 0 || SDL_TICKS_PASSED(redraw_at, ticks))
+        redraw_at = ticks;
+}
+
+int pacing_suspended(void)
+{
+    return win_hidden || win_minimized || win_unfocused;
+}
+
+static void check_redraw_time(void)
+{
+    if (redraw_at && SDL_TICKS_PASSED(SDL_GetTicks(), redraw_at)) {
+        redraw_at = 0;
+        dirty = 1;
+    }
+}
+
+int pacing_wait(int static_screen)
+{
+    check_redraw_time();
+
+    int suspended = pacing_suspended();
+    if (!suspended && (!static_screen || dirty))
+        return 0;
+
+    int timeout = PACING_IDLE_MS;
+    if (redraw_at) {
+        Sint32 left = (Sint32)(redraw_at - SDL_GetTicks());
+        if (left < timeout) timeout = left > 0 ? left : 0;
+    }
+
+    /* NULL only waits for an event; the caller polls it as usual. */
+    SDL_WaitEventTimeout(NULL, timeout);
+    check_redraw_time();
+
+    /* Frame deadlines are stale after a sleep of unknown length. */
+    next_deadline = 0;
+    return 1;
+}
+
+int pacing_should_draw(int static_screen)
+{
+    if (!pacing_suspended() && !static_screen) {
+        dirty = 0;
+        return 1;
+    }
+    /* Static or suspended: only redraw when something changed (this also
+     * repaints a window that is uncovered while unfocused). */
+    if (!dirty) return 0;
+    dirty = 0;
+    return 1;
+}
+
+void pacing_frame_done(void)
+{
+    if (frame_period == 0) return;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (next_deadline == 0 || now >= next_deadline + frame_period) {
+        /* First frame, or we fell more than a frame behind: do not try to
+         * catch up with a burst of short frames. */
+        next_deadline = now + frame_period;
+        return;
+    }
+
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    if (now < next_deadline) {
+        Uint64 left_ms = (next_deadline - now) * 1000 / freq;
+        if (left_ms > PACING_SPIN_MS)
+            SDL_Delay((Uint32)(left_ms - PACING_SPIN_MS));
+        while (SDL_GetPerformanceCounter() < next_deadline) {
+            /* spin */
+        }
+    }
+    next_deadline += frame_period;
+}
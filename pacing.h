@@ -0,0 +1,49 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Frame pacing.
+ *
+ * - Frames are capped at a target rate with a hybrid limiter: SDL_Delay()
+ *   covers most of the wait and the last couple of milliseconds are spun on
+ *   the performance counter, since OS sleeps are only accurate to ~1 ms.
+ * - Vsync is requested from the renderer when enabled.
+ * - Static screens (menus, cutscenes, ending) block on the event queue and
+ *   are only redrawn after an event or a requested redraw time.
+ * - While the window is hidden, minimized or unfocused the loop sleeps
+ *   until the window comes back.
+ */
+
+/* Apply settings. target_fps 0 follows the display refresh rate (60 Hz if
+ * unknown); vsync 0/1. */
+void pacing_configure(SDL_Window *win, SDL_Renderer *r, int target_fps, int vsync);
+
+/* Frames per second the limiter is currently aiming for. */
+int pacing_get_target_fps(void);
+
+/* Feed every polled event; window events drive suspension and any event
+ * makes a static screen redraw. */
+void pacing_handle_event(const SDL_Event *e);
+
+/* Force a redraw of a static screen now, or no later than SDL_GetTicks()
+ * reaches ticks (for timed notices). */
+void pacing_invalidate(void);
+void pacing_redraw_at(Uint32 ticks);
+
+/* 1 while the window is hidden, minimized or unfocused. */
+int pacing_suspended(void);
+
+/* Call at the top of each loop iteration. Blocks while suspended or, for a
+ * static screen, until there is something to redraw. Returns 1 if it
+ * blocked, so the caller can restart its frame timer. */
+int pacing_wait(int static_screen);
+
+/* Returns 1 if this iteration should render a frame. */
+int pacing_should_draw(int static_screen);
+
+/* Call after SDL_RenderPresent(); sleeps until the next frame is due. */
+void pacing_frame_done(void);
+
+#endif /* PACING_H */
@@ -0,0 +1,482 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pathfind.h"
+#include "map.h"
+#include "trace.h"
+
+#define COST_DIAG 1.41421356f
+
+typedef struct {
+    int start, goal;        /* tile indices */
+    Uint32 revision;        /* map_revision it was found on */
+    Uint32 last_used;       /* LRU stamp, 0 = empty */
+    PathStatus status;      /* PATH_FOUND or PATH_NO_PATH */
+    int count;
+    PathPoint points[PATH_MAX_POINTS];
+} CachedPath;
+
+static CachedPath cache[PATH_CACHE_SIZE];
+static Uint32 use_clock = 0;
+
+typedef struct {
+    float f;
+    int tile;
+} HeapEntry;
+
+/* A jump along one direction from an expanded jump point. It stops when
+ * the budget runs out and carries on from the same tile next update. */
+typedef struct {
+    int dx, dy;
+    int x, y;               /* last tile checked along the direction */
+    int phase;              /* diagonal: JUMP_STEP or the straight scan under way */
+    int sx, sy;             /* last tile checked by that straight scan */
+} Jump;
+
+enum { JUMP_STEP = 0, JUMP_SCAN_X, JUMP_SCAN_Y };
+
+/* Returned by the jumps when the budget ran out before they ended. */
+#define JUMP_PAUSED (-2)
+
+/* The search in progress. Per-tile arrays are stamped with the search id,
+ * so a new search does not have to clear them. */
+typedef struct {
+    int w, h;               /* tiles, copied from the map when allocated */
+    int active;
+    int start, goal;
+    int gx, gy;
+    Uint32 revision;
+    Uint32 id;
+
+    float *g;               /* cost from the start */
+    int *parent;            /* previous jump point */
+    Uint32 *seen;           /* id of the search that set g */
+    Uint32 *closed;         /* id of the search that expanded the tile */
+
+    HeapEntry *heap;        /* open list; stale entries are skipped */
+    int heap_n, heap_cap;
+
+    /* The jump point being expanded (-1 = none), its directions and the
+     * jump along dirs[k]. */
+    int cur;
+    int dirs[8][2];
+    int ndirs, k;
+    Jump jump;
+} Search;
+
+static Search search;
+
+static int budget = PATH_DEFAULT_BUDGET;
+static int budget_left = PATH_DEFAULT_BUDGET;
+
+void pathfind_new_frame(void)
+{
+    budget_left = budget;
+}
+
+void pathfind_set_budget(int tiles)
+{
+    budget = tiles < 1 ? 1 : tiles;
+    budget_left = budget;
+}
+
+void pathfind_shutdown(void)
+{
+    free(search.g);
+    free(search.parent);
+    free(search.seen);
+    free(search.closed);
+    free(search.heap);
+    memset(&search, 0, sizeof search);
+    memset(cache, 0, sizeof cache);
+    use_clock = 0;
+}
+
+static int search_alloc(int w, int h)
+{
+    pathfind_shutdown();
+
+    size_t n = (size_t)w * (size_t)h;
+    search.g = (float *)malloc(n * sizeof *search.g);
+    search.parent = (int *)malloc(n * sizeof *search.parent);
+    search.seen = (Uint32 *)calloc(n, sizeof *search.seen);
+    search.closed = (Uint32 *)calloc(n, sizeof *search.closed);
+    if (!search.g || !search.parent || !search.seen || !search.closed) {
+        pathfind_shutdown();
+        return -1;
+    }
+    search.w = w;
+    search.h = h;
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Open list (binary min-heap on f)
+ * ------------------------------------------------------------ */
+static int heap_push(float f, int tile)
+{
+    if (search.heap_n == search.heap_cap) {
+        int cap = search.heap_cap ? search.heap_cap * 2 : 256;
+        HeapEntry *grown = (HeapEntry *)realloc(search.heap, (size_t)cap * sizeof *grown);
+        if (!grown) return -1;
+        search.heap = grown;
+        search.heap_cap = cap;
+    }
+
+    HeapEntry *h = search.heap;
+    int i = search.heap_n++;
+    while (i > 0) {
+        int up = (i - 1) / 2;
+        if (h[up].f <= f) break;
+        h[i] = h[up];
+        i = up;
+    }
+    h[i] = (HeapEntry){ f, tile };
+    return 0;
+}
+
+static int heap_pop(void)
+{
+    HeapEntry *h = search.heap;
+    int top = h[0].tile;
+    HeapEntry last = h[--search.heap_n];
+
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= search.heap_n) break;
+        if (c + 1 < search.heap_n && h[c + 1].f < h[c].f) c++;
+        if (last.f <= h[c].f) break;
+        h[i] = h[c];
+        i = c;
+    }
+    if (search.heap_n > 0) h[i] = last;
+    return top;
+}
+
+/* ------------------------------------------------------------
+ * Jump point search
+ * ------------------------------------------------------------ */
+static int open_at(int x, int y)
+{
+    return x >= 0 && y >= 0 && x < search.w && y < search.h && !map_is(x, y, TILE_SOLID);
+}
+
+/* Octile distance: diagonal steps first, then straight ones. */
+static float octile(int ax, int ay, int bx, int by)
+{
+    int dx = abs(ax - bx), dy = abs(ay - by);
+    int lo = dx < dy ? dx : dy, hi = dx < dy ? dy : dx;
+    return (float)lo * COST_DIAG + (float)(hi - lo);
+}
+
+/* Walk on from (*x, *y) along a straight direction until a tile is a jump
+ * point (the goal, or a tile with a neighbour only reachable through it).
+ * Returns its index, -1 at a wall, or JUMP_PAUSED with (*x, *y) on the
+ * last tile checked when the budget runs out. */
+static int jump_straight(int *x, int *y, int dx, int dy)
+{
+    for (;;) {
+        if (budget_left <= 0) return JUMP_PAUSED;
+        int nx = *x + dx, ny = *y + dy;
+        budget_left--;
+        if (!open_at(nx, ny)) return -1;
+        *x = nx;
+        *y = ny;
+        if (nx == search.gx && ny == search.gy) return ny * search.w + nx;
+
+        if (dx != 0) {
+            if ((open_at(nx, ny - 1) && !open_at(nx - dx, ny - 1)) ||
+                (open_at(nx, ny + 1) && !open_at(nx - dx, ny + 1)))
+                return ny * search.w + nx;
+        } else {
+            if ((open_at(nx - 1, ny) && !open_at(nx - 1, ny - dy)) ||
+                (open_at(nx + 1, ny) && !open_at(nx + 1, ny - dy)))
+                return ny * search.w + nx;
+        }
+    }
+}
+
+/* The same along a diagonal: a tile is a jump point if a straight walk
+ * from it along either component finds one. */
+static int jump_diagonal(Jump *j)
+{
+    for (;;) {
+        if (j->phase == JUMP_STEP) {
+            if (budget_left <= 0) return JUMP_PAUSED;
+            if (!open_at(j->x + j->dx, j->y) || !open_at(j->x, j->y + j->dy)) return -1;
+            j->x += j->dx;
+            j->y += j->dy;
+            budget_left--;
+            if (!open_at(j->x, j->y)) return -1;
+            if (j->x == search.gx && j->y == search.gy) return j->y * search.w + j->x;
+
+            j->phase = JUMP_SCAN_X;
+            j->sx = j->x;
+            j->sy = j->y;
+        }
+
+        int found = (j->phase == JUMP_SCAN_X) ? jump_straight(&j->sx, &j->sy, j->dx, 0)
+                                              : jump_straight(&j->sx, &j->sy, 0, j->dy);
+        if (found == JUMP_PAUSED) return JUMP_PAUSED;
+        if (found != -1) return j->y * search.w + j->x;
+
+        if (j->phase == JUMP_SCAN_X) {
+            j->phase = JUMP_SCAN_Y;
+            j->sx = j->x;
+            j->sy = j->y;
+        } else {
+            j->phase = JUMP_STEP;
+        }
+    }
+}
+
+/* Carry on with the jump in progress. */
+static int jump_run(Jump *j)
+{
+    if (j->dx && j->dy) return jump_diagonal(j);
+    return jump_straight(&j->x, &j->y, j->dx, j->dy);
+}
+
+/* Start the expanded tile's jump along dirs[k]. */
+static void jump_begin(int k)
+{
+    Jump *j = &search.jump;
+    j->dx = search.dirs[k][0];
+    j->dy = search.dirs[k][1];
+    j->x = search.cur % search.w;
+    j->y = search.cur / search.w;
+    j->phase = JUMP_STEP;
+}
+
+static int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+/* Directions worth jumping in from tile c: all open ones at the start,
+ * otherwise the parent's direction plus the neighbours it could not have
+ * reached more cheaply. Returns how many went into dirs. */
+static int prune_directions(int c, int dirs[8][2])
+{
+    int x = c % search.w, y = c / search.w;
+    int n = 0;
+
+    if (search.parent[c] < 0) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0) continue;
+                if (!open_at(x + dx, y + dy)) continue;
+                if (dx && dy && (!open_at(x + dx, y) || !open_at(x, y + dy))) continue;
+                dirs[n][0] = dx;
+                dirs[n][1] = dy;
+                n++;
+            }
+        }
+        return n;
+    }
+
+    int p = search.parent[c];
+    int dx = sign(x - p % search.w), dy = sign(y - p / search.w);
+
+#define ADD_DIR(ddx, ddy) do { dirs[n][0] = (ddx); dirs[n][1] = (ddy); n++; } while (0)
+    if (dx && dy) {
+        int openY = open_at(x, y + dy), openX = open_at(x + dx, y);
+        if (openY) ADD_DIR(0, dy);
+        if (openX) ADD_DIR(dx, 0);
+        if (openX && openY && open_at(x + dx, y + dy)) ADD_DIR(dx, dy);
+    } else if (dx) {
+        int ahead = open_at(x + dx, y);
+        int up = open_at(x, y - 1), down = open_at(x, y + 1);
+        if (ahead) {
+            ADD_DIR(dx, 0);
+            if (down && open_at(x + dx, y + 1)) ADD_DIR(dx, 1);
+            if (up && open_at(x + dx, y - 1)) ADD_DIR(dx, -1);
+        }
+        if (down) ADD_DIR(0, 1);
+        if (up) ADD_DIR(0, -1);
+    } else {
+        int ahead = open_at(x, y + dy);
+        int right = open_at(x + 1, y), left = open_at(x - 1, y);
+        if (ahead) {
+            ADD_DIR(0, dy);
+            if (right && open_at(x + 1, y + dy)) ADD_DIR(1, dy);
+            if (left && open_at(x - 1, y + dy)) ADD_DIR(-1, dy);
+        }
+        if (right) ADD_DIR(1, 0);
+        if (left) ADD_DIR(-1, 0);
+    }
+#undef ADD_DIR
+    return n;
+}
+
+static void search_begin(int start, int goal)
+{
+    search.active = 1;
+    search.start = start;
+    search.goal = goal;
+    search.gx = goal % search.w;
+    search.gy = goal / search.w;
+    search.revision = map_revision;
+    search.heap_n = 0;
+    search.cur = -1;
+
+    /* Id 0 is what the stamp arrays start as, so it is never used. */
+    if (++search.id == 0) {
+        memset(search.seen, 0, (size_t)search.w * (size_t)search.h * sizeof *search.seen);
+        memset(search.closed, 0, (size_t)search.w * (size_t)search.h * sizeof *search.closed);
+        search.id = 1;
+    }
+
+    search.g[start] = 0.0f;
+    search.parent[start] = -1;
+    search.seen[start] = search.id;
+    (void)heap_push(octile(start % search.w, start / search.w, search.gx, search.gy), start);
+}
+
+/* Expand jump points until the goal is reached, the open list runs dry or
+ * the budget is spent. A jump cut off by the budget resumes next time, so
+ * no call scans more tiles than the budget. */
+static PathStatus search_run(void)
+{
+    const int w = search.w;
+
+    for (;;) {
+        if (search.cur < 0) {
+            if (budget_left <= 0) return PATH_PENDING;
+            if (search.heap_n == 0) return PATH_NO_PATH;
+
+            int c = heap_pop();
+            if (search.closed[c] == search.id) continue;
+            search.closed[c] = search.id;
+            if (c == search.goal) return PATH_FOUND;
+
+            search.cur = c;
+            search.ndirs = prune_directions(c, search.dirs);
+            search.k = 0;
+            if (search.ndirs > 0) jump_begin(0);
+        }
+
+        int c = search.cur;
+        int cx = c % w, cy = c / w;
+        while (search.k < search.ndirs) {
+            int jp = jump_run(&search.jump);
+            if (jp == JUMP_PAUSED) return PATH_PENDING;
+            if (++search.k < search.ndirs) jump_begin(search.k);
+            if (jp < 0 || search.closed[jp] == search.id) continue;
+
+            int jx = jp % w, jy = jp / w;
+            float g = search.g[c] + octile(cx, cy, jx, jy);
+            if (search.seen[jp] == search.id && g >= search.g[jp]) continue;
+
+            search.g[jp] = g;
+            search.parent[jp] = c;
+            search.seen[jp] = search.id;
+            if (heap_push(g + octile(jx, jy, search.gx, search.gy), jp) != 0)
+                return PATH_NO_PATH;
+        }
+        search.cur = -1;
+    }
+}
+
+/* ------------------------------------------------------------
+ * Cache
+ * ------------------------------------------------------------ */
+static CachedPath *cache_find(int start, int goal)
+{
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        CachedPath *c = &cache[i];
+        if (c->last_used && c->start == start && c->goal == goal && c->revision == map_revision)
+            return c;
+    }
+    return NULL;
+}
+
+/* Put the finished search's result in the least recently used entry. */
+static CachedPath *cache_store(PathStatus status)
+{
+    CachedPath *slot = &cache[0];
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        CachedPath *c = &cache[i];
+        if (!c->last_used || c->revision != map_revision) {
+            slot = c;
+            break;
+        }
+        if (c->last_used < slot->last_used) slot = c;
+    }
+
+    slot->start = search.start;
+    slot->goal = search.goal;
+    slot->revision = search.revision;
+    slot->last_used = ++use_clock;
+    slot->status = status;
+    slot->count = 0;
+    if (status != PATH_FOUND) return slot;
+
+    /* Count the points back from the goal, then keep the ones nearest the
+     * start. */
+    int len = 0;
+    for (int t = search.goal; t >= 0; t = search.parent[t]) len++;
+    int skip = len > PATH_MAX_POINTS ? len - PATH_MAX_POINTS : 0;
+
+    slot->count = len - skip;
+    int i = len - 1;
+    for (int t = search.goal; t >= 0; t = search.parent[t], i--) {
+        if (i >= slot->count) continue;
+        slot->points[i] = (PathPoint){ t % search.w, t / search.w };
+    }
+    return slot;
+}
+
+static PathStatus cache_result(CachedPath *c, const PathPoint **points, int *count)
+{
+    c->last_used = ++use_clock;
+    *points = c->points;
+    *count = c->count;
+    return c->status;
+}
+
+/* Run the search in progress and cache its result once it is done.
+ * Returns 1 when it finished. */
+static int advance_search(void)
+{
+    PathStatus status;
+    TRACE_SCOPE("path_search", status = search_run());
+    if (status == PATH_PENDING) return 0;
+
+    (void)cache_store(status);
+    search.active = 0;
+    return 1;
+}
+
+PathStatus pathfind_query(int sx, int sy, int gx, int gy, const PathPoint **points, int *count)
+{
+    *points = NULL;
+    *count = 0;
+    if (!worldmap || worldWidth <= 0 || worldHeight <= 0) return PATH_NO_PATH;
+
+    if (!search.g || search.w != worldWidth || search.h != worldHeight) {
+        if (search_alloc(worldWidth, worldHeight) != 0) return PATH_NO_PATH;
+    }
+    if (!open_at(sx, sy) || !open_at(gx, gy)) return PATH_NO_PATH;
+
+    int start = sy * search.w + sx, goal = gy * search.w + gx;
+    CachedPath *c = cache_find(start, goal);
+    if (c) return cache_result(c, points, count);
+
+    /* Tiles changed under the search in progress: its result is useless. */
+    if (search.active && search.revision != map_revision)
+        search.active = 0;
+
+    /* Another path is being searched for: spend the budget on it first, so
+     * a search whose asker went away still finishes. */
+    if (search.active && (search.start != start || search.goal != goal)) {
+        if (!advance_search() || budget_left <= 0) return PATH_PENDING;
+    }
+
+    if (!search.active) search_begin(start, goal);
+    if (!advance_search()) return PATH_PENDING;
+
+    c = cache_find(start, goal);
+    return c ? cache_result(c, points, count) : PATH_NO_PATH;
+}
@@ -0,0 +1,57 @@
+#ifndef PATHFIND_H
+#define PATHFIND_H
+
+/*
+ * Path queries over the map's tiles.
+ *
+ * Paths are found with jump point search on the same grid the flow field
+ * uses: tiles that are not TILE_SOLID are open, steps go to the 8 neighbours and never
+ * diagonally past a wall corner. A path is the list of tiles where it
+ * turns, from the start tile to the goal; between two points it runs in a
+ * straight or diagonal line through open tiles.
+ *
+ * Each update may scan a limited number of tiles (pathfind_new_frame()),
+ * so a search that does not fit carries on in later updates while the
+ * query reports PATH_PENDING. One search runs at a time; queries for other
+ * paths wait for it. Finished paths (and failures) go into a small LRU
+ * cache keyed by start and goal tile, which drops entries once the tiles
+ * change (map_revision).
+ */
+
+/* Turning points kept per path. A longer path is cut short; query again
+ * from its last point to get the rest. */
+#define PATH_MAX_POINTS 64
+
+/* Paths kept in the cache. */
+#define PATH_CACHE_SIZE 32
+
+/* Tiles scanned per update unless pathfind_set_budget() says otherwise. */
+#define PATH_DEFAULT_BUDGET 4096
+
+typedef struct {
+    int x, y;       /* tile */
+} PathPoint;
+
+typedef enum {
+    PATH_PENDING = 0,   /* still searching, ask again next update */
+    PATH_FOUND,
+    PATH_NO_PATH
+} PathStatus;
+
+/* Refill the scan budget; called once per update. */
+void pathfind_new_frame(void);
+
+/* Tiles a search may scan per update (at least 1). A search that runs out
+ * stops in the middle of a jump and picks it up from there next update, so
+ * an update never scans more than this many tiles. */
+void pathfind_set_budget(int tiles);
+
+/* Path from tile (sx, sy) to tile (gx, gy). On PATH_FOUND, *points and
+ * *count describe it until the next query. */
+PathStatus pathfind_query(int sx, int sy, int gx, int gy, const PathPoint **points, int *count);
+
+/* Drop the cache and any search in progress, and release the search
+ * buffers (called when the map is freed). */
+void pathfind_shutdown(void);
+
+#endif /* PATHFIND_H */
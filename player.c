@@ -7,6 +7,7 @@
 #include "enemy.h"
 #include "audio.h"
 #include "config.h"
+#include "input.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -19,6 +20,10 @@ float px = 3.0f;
 float py = 3.0f;
 float angle = 0.0f;
 
+float prev_px = 3.0f;
+float prev_py = 3.0f;
+float prev_angle = 0.0f;
+
 int gun_recoil_timer = 0;
 int shot_fired = 0;
 
@@ -58,6 +63,13 @@ static float cd_smg = 0.0f;
 static float cd_plasma = 0.0f;
 static float cd_rrg = 0.0f;
 
+/* Buttons held on the last step, so presses act once. Cleared with the
+ * cooldowns when a level starts, so a replay begins where its recording
+ * did. */
+static int lastLMB = 0;
+static int lastWep[5] = {0,0,0,0,0};
+static int lastE = 0;
+
 static void cooldown_tick(float *t, float dt)
 {
     if (*t > 0.0f) {
@@ -128,6 +140,9 @@ void init_player(void)
     shot_fired = 0;
 
     cd_pistol = cd_shotgun = cd_smg = cd_plasma = cd_rrg = 0.0f;
+    lastLMB = 0;
+    lastE = 0;
+    for (int i = 0; i < 5; i++) lastWep[i] = 0;
 
     /* Make sure current weapon is valid. */
     if (current_weapon == WEAPON_SHOTGUN && !hasShotgun) current_weapon = WEAPON_PISTOL;
@@ -137,10 +152,29 @@ void init_player(void)
 
     player_damage_timer = 0.0f;
     player_dead = 0;
+
+    player_snap_view();
+}
+
+void player_snap_view(void)
+{
+    prev_px = px;
+    prev_py = py;
+    prev_angle = angle;
 }
 
 void update_player(float dt)
 {
+    /* Frames until the next step are drawn from here to where it ends. */
+    player_snap_view();
+
+    /* Taken every step, dead or not, so a replay stays in step. */
+    InputSample in;
+    input_sample(&in);
+
+    /* Recoil is game state: it counts steps, not frames drawn. */
+    if (gun_recoil_timer > 0) gun_recoil_timer--;
+
     if (godmode_enabled) {
         player_dead = 0;
         hp = 100;
@@ -149,14 +183,8 @@ void update_player(float dt)
     if (player_dead)
         return;
 
-    const Uint8 *k = SDL_GetKeyboardState(NULL);
-
     /* ---------------- Mouse look ---------------- */
-    int mdx = 0, mdy = 0;
-    Uint32 mstate = SDL_GetRelativeMouseState(&mdx, &mdy);
-    (void)mdy;
-
-    angle += (float)mdx * mouse_sensitivity;
+    angle += (float)in.mouse_dx * mouse_sensitivity;
 
     const float two_pi = (float)(M_PI * 2.0);
     if (angle >= two_pi || angle <= -two_pi) angle = fmodf(angle, two_pi);
@@ -166,24 +194,16 @@ void update_player(float dt)
     float nx = px;
     float ny = py;
 
-    /* Configurable binds (scancodes). */
-    SDL_Scancode b_fwd  = config_get_bind(ACTION_MOVE_FORWARD);
-    SDL_Scancode b_back = config_get_bind(ACTION_MOVE_BACK);
-    SDL_Scancode b_left = config_get_bind(ACTION_STRAFE_LEFT);
-    SDL_Scancode b_right= config_get_bind(ACTION_STRAFE_RIGHT);
-
-    #define KEYDOWN(sc) ((sc) != SDL_SCANCODE_UNKNOWN && k[(sc)])
-
-    if (KEYDOWN(b_fwd))  { nx += cosf(angle) * moveSpeed * dt; ny += sinf(angle) * moveSpeed * dt; }
-    if (KEYDOWN(b_back)) { nx -= cosf(angle) * moveSpeed * dt; ny -= sinf(angle) * moveSpeed * dt; }
-    if (KEYDOWN(b_left)) { nx += cosf(angle - (float)M_PI/2.0f) * moveSpeed * dt; ny += sinf(angle - (float)M_PI/2.0f) * moveSpeed * dt; }
-    if (KEYDOWN(b_right)){ nx += cosf(angle + (float)M_PI/2.0f) * moveSpeed * dt; ny += sinf(angle + (float)M_PI/2.0f) * moveSpeed * dt; }
+    if (input_held(&in, ACTION_MOVE_FORWARD)) { nx += cosf(angle) * moveSpeed * dt; ny += sinf(angle) * moveSpeed * dt; }
+    if (input_held(&in, ACTION_MOVE_BACK)) { nx -= cosf(angle) * moveSpeed * dt; ny -= sinf(angle) * moveSpeed * dt; }
+    if (input_held(&in, ACTION_STRAFE_LEFT)) { nx += cosf(angle - (float)M_PI/2.0f) * moveSpeed * dt; ny += sinf(angle - (float)M_PI/2.0f) * moveSpeed * dt; }
+    if (input_held(&in, ACTION_STRAFE_RIGHT)) { nx += cosf(angle + (float)M_PI/2.0f) * moveSpeed * dt; ny += sinf(angle + (float)M_PI/2.0f) * moveSpeed * dt; }
 
     int tx = (int)nx;
     int ty = (int)ny;
 
     if (worldmap && tx >= 0 && ty >= 0 && tx < worldWidth && ty < worldHeight) {
-        if (worldmap[ty][tx] < 2) {
+        if (!map_is(tx, ty, TILE_SOLID)) {
             px = nx;
             py = ny;
         }
@@ -197,31 +217,30 @@ void update_player(float dt)
     cooldown_tick(&cd_rrg, dt);
 
     shot_fired = 0;
-    static int lastLMB = 0;
-    int currLMB = ((mstate & SDL_BUTTON(SDL_BUTTON_LEFT)) != 0);
+    int currLMB = ((in.buttons & SDL_BUTTON(SDL_BUTTON_LEFT)) != 0);
     int edge = (currLMB && !lastLMB);
 
     int want_fire = 0;
     float *cd = NULL;
     float cd_reset = 0.0f;
-    int recoil_frames = 6;
+    int recoil_steps = 12;
     int require_edge = 1;
 
     switch (current_weapon) {
         case WEAPON_PISTOL:
-            cd = &cd_pistol; cd_reset = PISTOL_COOLDOWN_SEC; recoil_frames = 6; require_edge = 1;
+            cd = &cd_pistol; cd_reset = PISTOL_COOLDOWN_SEC; recoil_steps = 12; require_edge = 1;
             break;
         case WEAPON_SHOTGUN:
-            cd = &cd_shotgun; cd_reset = SHOTGUN_COOLDOWN_SEC; recoil_frames = 10; require_edge = 1;
+            cd = &cd_shotgun; cd_reset = SHOTGUN_COOLDOWN_SEC; recoil_steps = 20; require_edge = 1;
             break;
         case WEAPON_SMG:
-            cd = &cd_smg; cd_reset = SMG_COOLDOWN_SEC; recoil_frames = 3; require_edge = 0;
+            cd = &cd_smg; cd_reset = SMG_COOLDOWN_SEC; recoil_steps = 6; require_edge = 0;
             break;
         case WEAPON_PLASMA:
-            cd = &cd_plasma; cd_reset = PLASMA_COOLDOWN_SEC; recoil_frames = 4; require_edge = 0;
+            cd = &cd_plasma; cd_reset = PLASMA_COOLDOWN_SEC; recoil_steps = 8; require_edge = 0;
             break;
         case WEAPON_RRG:
-            cd = &cd_rrg; cd_reset = RRG_COOLDOWN_SEC; recoil_frames = 14; require_edge = 1;
+            cd = &cd_rrg; cd_reset = RRG_COOLDOWN_SEC; recoil_steps = 28; require_edge = 1;
             break;
     }
 
@@ -230,7 +249,7 @@ void update_player(float dt)
 
     if (want_fire && cd && (*cd <= 0.0f) && weapon_has_ammo(current_weapon)) {
         weapon_consume_ammo(current_weapon);
-        gun_recoil_timer = recoil_frames;
+        gun_recoil_timer = recoil_steps;
         shot_fired = 1;
         *cd = cd_reset;
     }
@@ -238,19 +257,12 @@ void update_player(float dt)
     lastLMB = currLMB;
 
     /* ---------------- Weapon switch (binds) ---------------- */
-    static int lastWep[5] = {0,0,0,0,0};
-    SDL_Scancode b1 = config_get_bind(ACTION_WEAPON_1);
-    SDL_Scancode b2 = config_get_bind(ACTION_WEAPON_2);
-    SDL_Scancode b3 = config_get_bind(ACTION_WEAPON_3);
-    SDL_Scancode b4 = config_get_bind(ACTION_WEAPON_4);
-    SDL_Scancode b5 = config_get_bind(ACTION_WEAPON_5);
-
     int curr[5];
-    curr[0] = KEYDOWN(b1);
-    curr[1] = KEYDOWN(b2);
-    curr[2] = KEYDOWN(b3);
-    curr[3] = KEYDOWN(b4);
-    curr[4] = KEYDOWN(b5);
+    curr[0] = input_held(&in, ACTION_WEAPON_1);
+    curr[1] = input_held(&in, ACTION_WEAPON_2);
+    curr[2] = input_held(&in, ACTION_WEAPON_3);
+    curr[3] = input_held(&in, ACTION_WEAPON_4);
+    curr[4] = input_held(&in, ACTION_WEAPON_5);
 
     if (curr[0] && !lastWep[0]) current_weapon = WEAPON_PISTOL;
     if (curr[1] && !lastWep[1] && hasShotgun) current_weapon = WEAPON_SHOTGUN;
@@ -261,9 +273,7 @@ void update_player(float dt)
     for (int i = 0; i < 5; i++) lastWep[i] = curr[i];
 
     /* ---------------- Interaction (bind) ---------------- */
-    static int lastE = 0;
-    SDL_Scancode b_interact = config_get_bind(ACTION_INTERACT);
-    int currE = KEYDOWN(b_interact);
+    int currE = input_held(&in, ACTION_INTERACT);
 
     if (currE && !lastE) {
         if (worldmap) {
@@ -276,19 +286,19 @@ void update_player(float dt)
                 float dy = cy - py;
                 float dist = sqrtf(dx * dx + dy * dy);
 
-                int tile = worldmap[y][x];
+                int tile = map_tile(x, y);
 
-                if (tile == 1 && dist < 0.7f) {
-                    worldmap[y][x] = 0;
+                if (tile_is(tile, TILE_KEY) && dist < 0.7f) {
+                    map_set_tile(x, y, 0);
                     hasKey = 1;
                     show_message("you got the key!");
                     audio_play_sfx(SFX_ITEM);
                 }
-                else if (tile == 3 && dist < 1.0f) {
+                else if (tile_is(tile, TILE_DOOR) && dist < 1.0f) {
                     if (enemy_boss_alive()) {
                         show_message("the exit is sealed. defeat the boss!");
                     } else if (hasKey) {
-                        worldmap[y][x] = 0;
+                        map_set_tile(x, y, 0);
                         escaped = 1;
                     } else {
                         show_message("you need key to open the exit door.");
@@ -299,8 +309,6 @@ void update_player(float dt)
     }
     lastE = currE;
 
-    #undef KEYDOWN
-
     /* ---------------- Damage FX timer ---------------- */
     if (player_damage_timer > 0.0f) {
         player_damage_timer -= dt;
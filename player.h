@@ -6,8 +6,14 @@ extern float px;
 extern float py;
 extern float angle;
 
+/* Position and view at the start of the last simulation step; frames are
+ * drawn between these and the current ones (raycast_capture_view()). */
+extern float prev_px;
+extern float prev_py;
+extern float prev_angle;
+
 /* Combat */
-extern int gun_recoil_timer;
+extern int gun_recoil_timer;    /* steps the recoil frame is still shown */
 extern int shot_fired;
 
 /* Weapons */
@@ -48,4 +54,8 @@ extern int player_dead;
 void init_player(void);
 void update_player(float dt);
 
+/* Forget the previous step's position and view, so the next frame does
+ * not draw the player sliding in from there (after teleporting). */
+void player_snap_view(void);
+
 #endif /* PLAYER_H */
@@ -0,0 +1,158 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "profiler.h"
+
+int profiler_active = 0;
+
+const char *const profiler_stage_names[PROF_STAGE_COUNT] = {
+    "PLAYER", "ENEMIES", "ITEMS", "WORLD", "SPRITES", "HUD", "PRESENT"
+};
+
+const char *const profiler_counter_names[PROF_COUNTER_COUNT] = {
+    "AI NEAR", "MID", "FAR"
+};
+
+/* Latest value of each counter. */
+static int counters[PROF_COUNTER_COUNT];
+
+/* Ticks gathered for the frame in progress. */
+static Uint64 frame_ticks[PROF_STAGE_COUNT];
+
+/* Rolling history in milliseconds; hist_pos is the next slot to write. */
+static float stage_hist[PROF_HISTORY][PROF_STAGE_COUNT];
+static float frame_hist[PROF_HISTORY];
+static int hist_pos = 0;
+static int hist_count = 0;
+static Uint64 last_frame = 0;
+
+void profiler_set_enabled(int enabled)
+{
+    profiler_active = enabled ? 1 : 0;
+
+    /* Start from an empty history so old frames do not skew the numbers. */
+    memset(frame_ticks, 0, sizeof frame_ticks);
+    hist_pos = 0;
+    hist_count = 0;
+    last_frame = 0;
+}
+
+int profiler_enabled(void)
+{
+    return profiler_active;
+}
+
+void profiler_add(ProfStage stage, Uint64 ticks)
+{
+    if (stage < 0 || stage >= PROF_STAGE_COUNT) return;
+    frame_ticks[stage] += ticks;
+}
+
+void profiler_count(ProfCounter counter, int value)
+{
+    if (counter < 0 || counter >= PROF_COUNTER_COUNT) return;
+    counters[counter] = value;
+}
+
+void profiler_frame_end(void)
+{
+    if (!profiler_active) return;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    double to_ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+    if (last_frame) {
+        for (int s = 0; s < PROF_STAGE_COUNT; s++)
+            stage_hist[hist_pos][s] = (float)((double)frame_ticks[s] * to_ms);
+        frame_hist[hist_pos] = (float)((double)(now - last_frame) * to_ms);
+
+        hist_pos = (hist_pos + 1) % PROF_HISTORY;
+        if (hist_count < PROF_HISTORY) hist_count++;
+    }
+
+    memset(frame_ticks, 0, sizeof frame_ticks);
+    last_frame = now;
+}
+
+/* Graph scale: the full height is 33.3 ms, with a marker at 16.7 ms. */
+#define GRAPH_H 60
+#define GRAPH_MS 33.3f
+#define GRAPH_BAR_W 2
+
+static void draw_graph(SDL_Renderer *r, int x, int y)
+{
+    /* Oldest frame on the left. */
+    for (int i = 0; i < hist_count; i++) {
+        int idx = (hist_pos - hist_count + i + PROF_HISTORY) % PROF_HISTORY;
+        float ms = frame_hist[idx];
+
+        int h = (int)(ms / GRAPH_MS * GRAPH_H);
+        if (h > GRAPH_H) h = GRAPH_H;
+        if (h < 1) h = 1;
+
+        if (ms <= 1000.0f / 60.0f) SDL_SetRenderDrawColor(r, 0, 200, 0, 255);
+        else if (ms <= GRAPH_MS) SDL_SetRenderDrawColor(r, 220, 200, 0, 255);
+        else SDL_SetRenderDrawColor(r, 220, 0, 0, 255);
+
+        SDL_RenderFillRect(r, &(SDL_Rect){x + i * GRAPH_BAR_W, y + GRAPH_H - h, GRAPH_BAR_W, h});
+    }
+
+    int mark = y + GRAPH_H - (int)(1000.0f / 60.0f / GRAPH_MS * GRAPH_H);
+    SDL_SetRenderDrawColor(r, 255, 255, 255, 160);
+    SDL_RenderDrawLine(r, x, mark, x + PROF_HISTORY * GRAPH_BAR_W, mark);
+}
+
+void profiler_draw(SDL_Renderer *r, BitmapFont *font)
+{
+    if (!profiler_active || !font) return;
+
+    const int x = 10, y = 10;
+    const int lh = font->lineHeight > 0 ? font->lineHeight : 12;
+    const int w = PROF_HISTORY * GRAPH_BAR_W + 20;
+    const int h = (PROF_STAGE_COUNT + 3) * lh + GRAPH_H + 25;
+
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 170);
+    SDL_RenderFillRect(r, &(SDL_Rect){x, y, w, h});
+
+    /* Average and worst case over the history. */
+    float frame_avg = 0.0f, frame_max = 0.0f;
+    float avg[PROF_STAGE_COUNT] = {0}, max[PROF_STAGE_COUNT] = {0};
+    for (int i = 0; i < hist_count; i++) {
+        frame_avg += frame_hist[i];
+        if (frame_hist[i] > frame_max) frame_max = frame_hist[i];
+        for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+            avg[s] += stage_hist[i][s];
+            if (stage_hist[i][s] > max[s]) max[s] = stage_hist[i][s];
+        }
+    }
+    if (hist_count > 0) {
+        frame_avg /= (float)hist_count;
+        for (int s = 0; s < PROF_STAGE_COUNT; s++) avg[s] /= (float)hist_count;
+    }
+
+    char line[64];
+    int ty = y + 5;
+    snprintf(line, sizeof line, "FRAME   %6.2f MS  MAX %6.2f", frame_avg, frame_max);
+    draw_text(r, font, x + 10, ty, line, 1.0f);
+    ty += lh + lh / 2;
+
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        snprintf(line, sizeof line, "%-7s %6.2f MS  MAX %6.2f", profiler_stage_names[s], avg[s], max[s]);
+        draw_text(r, font, x + 10, ty, line, 1.0f);
+        ty += lh;
+    }
+
+    /* Counters on one line: "AI NEAR 12  MID 40  FAR 3". */
+    int len = 0;
+    line[0] = '\0';
+    for (int c = 0; c < PROF_COUNTER_COUNT && len < (int)sizeof line; c++)
+        len += snprintf(line + len, sizeof line - (size_t)len, "%s%s %d",
+                        c ? "  " : "", profiler_counter_names[c], counters[c]);
+    draw_text(r, font, x + 10, ty, line, 1.0f);
+    ty += lh;
+
+    draw_graph(r, x + 10, ty + 10);
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_NONE);
+}
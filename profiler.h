@@ -0,0 +1,84 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <SDL2/SDL.h>
+
+#include "font.h"
+#include "trace.h"
+
+/*
+ * Frame profiler.
+ *
+ * Each stage of the game loop is bracketed by profiler_begin() /
+ * profiler_end(), which read SDL_GetPerformanceCounter(). The per-stage
+ * times of every frame go into a rolling history that the overlay (F3)
+ * shows as average/max milliseconds per stage plus a frame-time graph.
+ *
+ * The same brackets emit trace events (trace.h) named after the stage while
+ * a trace capture is running. With both off they cost two flag tests.
+ *
+ * Counters (profiler_count()) hold one number per frame, such as how many
+ * enemies were in each AI tier; the overlay shows the latest values.
+ */
+typedef enum {
+    PROF_PLAYER = 0,
+    PROF_ENEMIES,
+    PROF_ITEMS,
+    PROF_WORLD,
+    PROF_SPRITES,
+    PROF_HUD,
+    PROF_PRESENT,
+    PROF_STAGE_COUNT
+} ProfStage;
+
+typedef enum {
+    PROF_COUNT_AI_NEAR = 0,
+    PROF_COUNT_AI_MID,
+    PROF_COUNT_AI_FAR,
+    PROF_COUNTER_COUNT
+} ProfCounter;
+
+/* Frames kept in the rolling history. */
+#define PROF_HISTORY 120
+
+extern int profiler_active;
+extern const char *const profiler_stage_names[PROF_STAGE_COUNT];
+extern const char *const profiler_counter_names[PROF_COUNTER_COUNT];
+
+void profiler_set_enabled(int enabled);
+int profiler_enabled(void);
+
+void profiler_add(ProfStage stage, Uint64 ticks);
+
+/* Set a counter's value for the current frame. */
+void profiler_count(ProfCounter counter, int value);
+
+/* Start timing a stage; returns 0 while the profiler is off. */
+static inline Uint64 profiler_begin(ProfStage stage)
+{
+    trace_begin(profiler_stage_names[stage]);
+    return profiler_active ? SDL_GetPerformanceCounter() : 0;
+}
+
+/* Stop timing a stage started with profiler_begin(). */
+static inline void profiler_end(ProfStage stage, Uint64 t0)
+{
+    if (t0) profiler_add(stage, SDL_GetPerformanceCounter() - t0);
+    trace_end(profiler_stage_names[stage]);
+}
+
+/* Time a single statement as a stage. */
+#define PROF_SCOPE(stage, stmt) do {              \
+        Uint64 prof_t0_ = profiler_begin(stage);  \
+        stmt;                                     \
+        profiler_end((stage), prof_t0_);          \
+    } while (0)
+
+/* Close the current frame: its stage times and the time since the previous
+ * call go into the history. */
+void profiler_frame_end(void);
+
+/* Draw the overlay in the top left corner (does nothing while off). */
+void profiler_draw(SDL_Renderer *r, BitmapFont *font);
+
+#endif /* PROFILER_H */
@@ -0,0 +1,468 @@
+#include <float.h>
+#include <math.h>
+
+#include <SDL2/SDL.h>
+
+#include "raycast.h"
+#include "render.h"
+#include "player.h"
+#include "map.h"
+
+/* The packet kernels must round every intermediate to float exactly like the
+ * scalar DDA does, which rules out x87 excess precision. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#define RAYCAST_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+static void select_packet_kernel(void);
+
+void raycast_capture_view(RayView *v, float alpha)
+{
+    if (alpha >= 1.0f) {
+        v->px = px;
+        v->py = py;
+        v->angle = angle;
+    } else {
+        /* Turn the short way round when the angle wrapped past 0. */
+        const float two_pi = 6.28318530718f;
+        float turn = angle - prev_angle;
+        if (turn > two_pi * 0.5f) turn -= two_pi;
+        if (turn < -two_pi * 0.5f) turn += two_pi;
+
+        v->px = prev_px + (px - prev_px) * alpha;
+        v->py = prev_py + (py - prev_py) * alpha;
+        v->angle = prev_angle + turn * alpha;
+    }
+    v->map = worldmap;
+    v->stride = worldStride;
+
+    /* Camera plane: column sx looks along dir + plane * cameraX with cameraX
+     * running from -1 at the left edge to +1 at the right edge. */
+    float halfPlane = tanf(FOV * 0.5f);
+    v->dirX = cosf(v->angle);
+    v->dirY = sinf(v->angle);
+    v->planeX = -v->dirY * halfPlane;
+    v->planeY = v->dirX * halfPlane;
+
+    /* Views are captured on the main thread, before any worker traces. */
+    select_packet_kernel();
+}
+
+/* Position of column sx on the camera plane. Both the scalar and the packet
+ * kernels compute it from the same integer numerator so they agree exactly. */
+static float camera_x(int sx)
+{
+    return (float)(2 * sx - W) / (float)W;
+}
+
+/* Fill in the fields that only depend on the DDA result. */
+static void finish_hit(const RayView *v, float rayDirX, float rayDirY,
+                       float perpWallDist, int side, int tile, RayHit *out)
+{
+    /* Calculate where exactly the wall was hit. */
+    float wallX;
+    if (side == 0) {
+        wallX = v->py + perpWallDist * rayDirY;
+    } else {
+        wallX = v->px + perpWallDist * rayDirX;
+    }
+    wallX -= floorf(wallX);
+
+    out->rayDirX = rayDirX;
+    out->rayDirY = rayDirY;
+    out->perpWallDist = perpWallDist;
+    out->wallX = wallX;
+    out->side = side;
+    out->tile = tile;
+}
+
+/* The DDA algorithm calculates intersections with the grid and reduces per-ray
+ * iterations compared to naive stepping. This is the reference the packet
+ * kernels below must match. */
+void raycast_column(const RayView *v, int sx, RayHit *out)
+{
+    const float px = v->px;
+    const float py = v->py;
+
+    /* Ray direction for this column. */
+    float cameraX = camera_x(sx);
+    float rayDirX = v->dirX + v->planeX * cameraX;
+    float rayDirY = v->dirY + v->planeY * cameraX;
+
+    /* Grid position of the player. */
+    int mapX = (int)px;
+    int mapY = (int)py;
+
+    /* Calculate the distance the ray has to travel from one x or y-side to the next. */
+    float deltaDistX = (rayDirX == 0.0f) ? 1e30f : fabsf(1.0f / rayDirX);
+    float deltaDistY = (rayDirY == 0.0f) ? 1e30f : fabsf(1.0f / rayDirY);
+
+    /* Calculate step direction and initial side distance. */
+    int stepX;
+    int stepY;
+    float sideDistX;
+    float sideDistY;
+
+    if (rayDirX < 0) {
+        stepX = -1;
+        sideDistX = (px - (float)mapX) * deltaDistX;
+    } else {
+        stepX = 1;
+        sideDistX = ((float)mapX + 1.0f - px) * deltaDistX;
+    }
+    if (rayDirY < 0) {
+        stepY = -1;
+        sideDistY = (py - (float)mapY) * deltaDistY;
+    } else {
+        stepY = 1;
+        sideDistY = ((float)mapY + 1.0f - py) * deltaDistY;
+    }
+
+    int hit = 0;
+    int side = 0;
+    int tile = 0;
+
+    float perpWallDist = MAX_DIST;
+
+    /* Perform DDA: step through the grid until hitting a wall or exceeding max distance. */
+    while (!hit) {
+        if (sideDistX < sideDistY) {
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            side = 0;
+        } else {
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            side = 1;
+        }
+        /* No bounds check: the map's padding is solid. */
+        tile = v->map[mapY * v->stride + mapX];
+        if (tile_is(tile, TILE_OPAQUE)) {
+            hit = 1;
+            /* Calculate distance projected on camera direction (perpendicular distance) to avoid fish-eye effect. */
+            if (side == 0) {
+                perpWallDist = ((float)mapX - px + (1.0f - (float)stepX) * 0.5f) / (rayDirX == 0.0f ? 1e-6f : rayDirX);
+            } else {
+                perpWallDist = ((float)mapY - py + (1.0f - (float)stepY) * 0.5f) / (rayDirY == 0.0f ? 1e-6f : rayDirY);
+            }
+            /* Clamp to avoid extremely small distances. */
+            if (perpWallDist <= 0.0f) perpWallDist = 0.001f;
+        }
+        /* Stop if the distance is beyond maximum draw distance. */
+        float approxDist = (side == 0) ? sideDistX - deltaDistX : sideDistY - deltaDistY;
+        if (approxDist > MAX_DIST) {
+            hit = 1;
+            tile = 0;
+            break;
+        }
+    }
+
+    finish_hit(v, rayDirX, rayDirY, perpWallDist, side, tile, out);
+}
+
+/* ------------------------------------------------------------
+ * Packet DDA
+ *
+ * Adjacent columns are traced together, one per lane. A lane that has hit
+ * something is masked out of further updates and the packet steps until
+ * every lane is done. The arithmetic mirrors raycast_column() operation for
+ * operation, so perpWallDist, side and tile come out bit-identical; map
+ * reads stay scalar, one per live lane.
+ * ------------------------------------------------------------ */
+typedef void (*PacketFn)(const RayView *v, int sx, RayHit *out);
+
+static PacketFn packet_fn = NULL;
+static int packet_width = 1;
+static const char *packet_kernel = NULL;
+
+#ifdef RAYCAST_X86_SIMD
+__attribute__((target("sse2")))
+static __m128 sel_ps(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__attribute__((target("sse2")))
+static __m128i sel_epi32(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__attribute__((target("sse2")))
+static void packet4_sse2(const RayView *v, int sx, RayHit *out)
+{
+    const __m128 vpx = _mm_set1_ps(v->px);
+    const __m128 vpy = _mm_set1_ps(v->py);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 maxDist = _mm_set1_ps(MAX_DIST);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128i iOne = _mm_set1_epi32(1);
+    const __m128i iMinusOne = _mm_set1_epi32(-1);
+
+    __m128i num = _mm_setr_epi32(2 * sx - W, 2 * (sx + 1) - W, 2 * (sx + 2) - W, 2 * (sx + 3) - W);
+    __m128 cameraX = _mm_div_ps(_mm_cvtepi32_ps(num), _mm_set1_ps((float)W));
+    __m128 rayDirX = _mm_add_ps(_mm_set1_ps(v->dirX), _mm_mul_ps(_mm_set1_ps(v->planeX), cameraX));
+    __m128 rayDirY = _mm_add_ps(_mm_set1_ps(v->dirY), _mm_mul_ps(_mm_set1_ps(v->planeY), cameraX));
+
+    __m128i mapX = _mm_set1_epi32((int)v->px);
+    __m128i mapY = _mm_set1_epi32((int)v->py);
+    __m128 mapXf = _mm_cvtepi32_ps(mapX);
+    __m128 mapYf = _mm_cvtepi32_ps(mapY);
+
+    __m128 zeroX = _mm_cmpeq_ps(rayDirX, zero);
+    __m128 zeroY = _mm_cmpeq_ps(rayDirY, zero);
+    __m128 deltaDistX = sel_ps(zeroX, _mm_set1_ps(1e30f), _mm_and_ps(_mm_div_ps(one, rayDirX), absMask));
+    __m128 deltaDistY = sel_ps(zeroY, _mm_set1_ps(1e30f), _mm_and_ps(_mm_div_ps(one, rayDirY), absMask));
+
+    __m128 negX = _mm_cmplt_ps(rayDirX, zero);
+    __m128 negY = _mm_cmplt_ps(rayDirY, zero);
+    __m128i stepX = sel_epi32(_mm_castps_si128(negX), iMinusOne, iOne);
+    __m128i stepY = sel_epi32(_mm_castps_si128(negY), iMinusOne, iOne);
+    __m128 sideDistX = sel_ps(negX, _mm_mul_ps(_mm_sub_ps(vpx, mapXf), deltaDistX),
+                              _mm_mul_ps(_mm_sub_ps(_mm_add_ps(mapXf, one), vpx), deltaDistX));
+    __m128 sideDistY = sel_ps(negY, _mm_mul_ps(_mm_sub_ps(vpy, mapYf), deltaDistY),
+                              _mm_mul_ps(_mm_sub_ps(_mm_add_ps(mapYf, one), vpy), deltaDistY));
+
+    /* Perpendicular distance terms that do not change while stepping. */
+    __m128 offX = _mm_mul_ps(_mm_sub_ps(one, _mm_cvtepi32_ps(stepX)), half);
+    __m128 offY = _mm_mul_ps(_mm_sub_ps(one, _mm_cvtepi32_ps(stepY)), half);
+    __m128 denX = sel_ps(zeroX, _mm_set1_ps(1e-6f), rayDirX);
+    __m128 denY = sel_ps(zeroY, _mm_set1_ps(1e-6f), rayDirY);
+
+    __m128i active = iMinusOne;
+    __m128i side = _mm_setzero_si128();
+    __m128i tile = _mm_setzero_si128();
+    __m128 perp = maxDist;
+
+    while (_mm_movemask_epi8(active)) {
+        /* Step every live lane along x or y. */
+        __m128i xStep = _mm_castps_si128(_mm_cmplt_ps(sideDistX, sideDistY));
+        __m128i mx = _mm_and_si128(active, xStep);
+        __m128i my = _mm_andnot_si128(xStep, active);
+        sideDistX = _mm_add_ps(sideDistX, _mm_and_ps(_mm_castsi128_ps(mx), deltaDistX));
+        sideDistY = _mm_add_ps(sideDistY, _mm_and_ps(_mm_castsi128_ps(my), deltaDistY));
+        mapX = _mm_add_epi32(mapX, _mm_and_si128(mx, stepX));
+        mapY = _mm_add_epi32(mapY, _mm_and_si128(my, stepY));
+        side = _mm_or_si128(_mm_and_si128(my, iOne), _mm_andnot_si128(active, side));
+
+        int live = _mm_movemask_ps(_mm_castsi128_ps(active));
+        int lx[4], ly[4], lt[4], lw[4] = { 0, 0, 0, 0 };
+        _mm_storeu_si128((__m128i *)lx, mapX);
+        _mm_storeu_si128((__m128i *)ly, mapY);
+        _mm_storeu_si128((__m128i *)lt, tile);
+        for (int i = 0; i < 4; i++) {
+            if (!(live & (1 << i))) continue;
+            lt[i] = v->map[ly[i] * v->stride + lx[i]];
+            lw[i] = -tile_is(lt[i], TILE_OPAQUE);
+        }
+        tile = _mm_loadu_si128((const __m128i *)lt);
+
+        /* Wall hits: perpendicular distance, clamped like the scalar path. */
+        __m128i wall = _mm_loadu_si128((const __m128i *)lw);
+        __m128 sideY = _mm_castsi128_ps(_mm_cmpeq_epi32(side, iOne));
+        if (_mm_movemask_epi8(wall)) {
+            __m128 pX = _mm_div_ps(_mm_add_ps(_mm_sub_ps(_mm_cvtepi32_ps(mapX), vpx), offX), denX);
+            __m128 pY = _mm_div_ps(_mm_add_ps(_mm_sub_ps(_mm_cvtepi32_ps(mapY), vpy), offY), denY);
+            __m128 p = sel_ps(sideY, pY, pX);
+            p = sel_ps(_mm_cmple_ps(p, zero), _mm_set1_ps(0.001f), p);
+            perp = sel_ps(_mm_castsi128_ps(wall), p, perp);
+        }
+
+        /* Lanes past the draw distance stop with nothing hit. */
+        __m128 approx = sel_ps(sideY, _mm_sub_ps(sideDistY, deltaDistY), _mm_sub_ps(sideDistX, deltaDistX));
+        __m128i far = _mm_and_si128(active, _mm_castps_si128(_mm_cmpgt_ps(approx, maxDist)));
+        tile = _mm_andnot_si128(far, tile);
+
+        active = _mm_andnot_si128(_mm_or_si128(wall, far), active);
+    }
+
+    float rx[4], ry[4], rp[4];
+    int rs[4], rt[4];
+    _mm_storeu_ps(rx, rayDirX);
+    _mm_storeu_ps(ry, rayDirY);
+    _mm_storeu_ps(rp, perp);
+    _mm_storeu_si128((__m128i *)rs, side);
+    _mm_storeu_si128((__m128i *)rt, tile);
+    for (int i = 0; i < 4; i++)
+        finish_hit(v, rx[i], ry[i], rp[i], rs[i], rt[i], &out[i]);
+}
+
+__attribute__((target("avx2")))
+static void packet8_avx2(const RayView *v, int sx, RayHit *out)
+{
+    const __m256 vpx = _mm256_set1_ps(v->px);
+    const __m256 vpy = _mm256_set1_ps(v->py);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 maxDist = _mm256_set1_ps(MAX_DIST);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256i iOne = _mm256_set1_epi32(1);
+    const __m256i iMinusOne = _mm256_set1_epi32(-1);
+
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i num = _mm256_sub_epi32(_mm256_add_epi32(_mm256_set1_epi32(2 * sx), _mm256_add_epi32(lanes, lanes)),
+                                   _mm256_set1_epi32(W));
+    __m256 cameraX = _mm256_div_ps(_mm256_cvtepi32_ps(num), _mm256_set1_ps((float)W));
+    __m256 rayDirX = _mm256_add_ps(_mm256_set1_ps(v->dirX), _mm256_mul_ps(_mm256_set1_ps(v->planeX), cameraX));
+    __m256 rayDirY = _mm256_add_ps(_mm256_set1_ps(v->dirY), _mm256_mul_ps(_mm256_set1_ps(v->planeY), cameraX));
+
+    __m256i mapX = _mm256_set1_epi32((int)v->px);
+    __m256i mapY = _mm256_set1_epi32((int)v->py);
+    __m256 mapXf = _mm256_cvtepi32_ps(mapX);
+    __m256 mapYf = _mm256_cvtepi32_ps(mapY);
+
+    __m256 zeroX = _mm256_cmp_ps(rayDirX, zero, _CMP_EQ_OQ);
+    __m256 zeroY = _mm256_cmp_ps(rayDirY, zero, _CMP_EQ_OQ);
+    __m256 deltaDistX = _mm256_blendv_ps(_mm256_and_ps(_mm256_div_ps(one, rayDirX), absMask),
+                                         _mm256_set1_ps(1e30f), zeroX);
+    __m256 deltaDistY = _mm256_blendv_ps(_mm256_and_ps(_mm256_div_ps(one, rayDirY), absMask),
+                                         _mm256_set1_ps(1e30f), zeroY);
+
+    __m256 negX = _mm256_cmp_ps(rayDirX, zero, _CMP_LT_OQ);
+    __m256 negY = _mm256_cmp_ps(rayDirY, zero, _CMP_LT_OQ);
+    __m256i stepX = _mm256_blendv_epi8(iOne, iMinusOne, _mm256_castps_si256(negX));
+    __m256i stepY = _mm256_blendv_epi8(iOne, iMinusOne, _mm256_castps_si256(negY));
+    __m256 sideDistX = _mm256_blendv_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(mapXf, one), vpx), deltaDistX),
+                                        _mm256_mul_ps(_mm256_sub_ps(vpx, mapXf), deltaDistX), negX);
+    __m256 sideDistY = _mm256_blendv_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(mapYf, one), vpy), deltaDistY),
+                                        _mm256_mul_ps(_mm256_sub_ps(vpy, mapYf), deltaDistY), negY);
+
+    __m256 offX = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_cvtepi32_ps(stepX)), half);
+    __m256 offY = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_cvtepi32_ps(stepY)), half);
+    __m256 denX = _mm256_blendv_ps(rayDirX, _mm256_set1_ps(1e-6f), zeroX);
+    __m256 denY = _mm256_blendv_ps(rayDirY, _mm256_set1_ps(1e-6f), zeroY);
+
+    __m256i active = iMinusOne;
+    __m256i side = _mm256_setzero_si256();
+    __m256i tile = _mm256_setzero_si256();
+    __m256 perp = maxDist;
+
+    while (!_mm256_testz_si256(active, active)) {
+        __m256i xStep = _mm256_castps_si256(_mm256_cmp_ps(sideDistX, sideDistY, _CMP_LT_OQ));
+        __m256i mx = _mm256_and_si256(active, xStep);
+        __m256i my = _mm256_andnot_si256(xStep, active);
+        sideDistX = _mm256_add_ps(sideDistX, _mm256_and_ps(_mm256_castsi256_ps(mx), deltaDistX));
+        sideDistY = _mm256_add_ps(sideDistY, _mm256_and_ps(_mm256_castsi256_ps(my), deltaDistY));
+        mapX = _mm256_add_epi32(mapX, _mm256_and_si256(mx, stepX));
+        mapY = _mm256_add_epi32(mapY, _mm256_and_si256(my, stepY));
+        side = _mm256_or_si256(_mm256_and_si256(my, iOne), _mm256_andnot_si256(active, side));
+
+        int live = _mm256_movemask_ps(_mm256_castsi256_ps(active));
+        int lx[8], ly[8], lt[8], lw[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        _mm256_storeu_si256((__m256i *)lx, mapX);
+        _mm256_storeu_si256((__m256i *)ly, mapY);
+        _mm256_storeu_si256((__m256i *)lt, tile);
+        for (int i = 0; i < 8; i++) {
+            if (!(live & (1 << i))) continue;
+            lt[i] = v->map[ly[i] * v->stride + lx[i]];
+            lw[i] = -tile_is(lt[i], TILE_OPAQUE);
+        }
+        tile = _mm256_loadu_si256((const __m256i *)lt);
+
+        __m256i wall = _mm256_loadu_si256((const __m256i *)lw);
+        __m256 sideY = _mm256_castsi256_ps(_mm256_cmpeq_epi32(side, iOne));
+        if (!_mm256_testz_si256(wall, wall)) {
+            __m256 pX = _mm256_div_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(mapX), vpx), offX), denX);
+            __m256 pY = _mm256_div_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(mapY), vpy), offY), denY);
+            __m256 p = _mm256_blendv_ps(pX, pY, sideY);
+            p = _mm256_blendv_ps(p, _mm256_set1_ps(0.001f), _mm256_cmp_ps(p, zero, _CMP_LE_OQ));
+            perp = _mm256_blendv_ps(perp, p, _mm256_castsi256_ps(wall));
+        }
+
+        __m256 approx = _mm256_blendv_ps(_mm256_sub_ps(sideDistX, deltaDistX),
+                                         _mm256_sub_ps(sideDistY, deltaDistY), sideY);
+        __m256i far = _mm256_and_si256(active, _mm256_castps_si256(_mm256_cmp_ps(approx, maxDist, _CMP_GT_OQ)));
+        tile = _mm256_andnot_si256(far, tile);
+
+        active = _mm256_andnot_si256(_mm256_or_si256(wall, far), active);
+    }
+
+    float rx[8], ry[8], rp[8];
+    int rs[8], rt[8];
+    _mm256_storeu_ps(rx, rayDirX);
+    _mm256_storeu_ps(ry, rayDirY);
+    _mm256_storeu_ps(rp, perp);
+    _mm256_storeu_si256((__m256i *)rs, side);
+    _mm256_storeu_si256((__m256i *)rt, tile);
+    for (int i = 0; i < 8; i++)
+        finish_hit(v, rx[i], ry[i], rp[i], rs[i], rt[i], &out[i]);
+}
+#endif /* RAYCAST_X86_SIMD */
+
+static void select_packet_kernel(void)
+{
+    if (packet_kernel) return;
+
+    packet_fn = NULL;
+    packet_width = 1;
+    packet_kernel = "SCALAR";
+#ifdef RAYCAST_X86_SIMD
+    if (SDL_HasAVX2()) {
+        packet_fn = packet8_avx2;
+        packet_width = 8;
+        packet_kernel = "AVX2";
+    } else if (SDL_HasSSE2()) {
+        packet_fn = packet4_sse2;
+        packet_width = 4;
+        packet_kernel = "SSE2";
+    }
+#endif
+}
+
+const char *raycast_kernel_name(void)
+{
+    select_packet_kernel();
+    return packet_kernel;
+}
+
+void raycast_columns(const RayView *v, int sx, int n, RayHit *out)
+{
+    int i = 0;
+    if (packet_fn) {
+        for (; i + packet_width <= n; i += packet_width)
+            packet_fn(v, sx + i, out + i);
+    }
+    for (; i < n; i++)
+        raycast_column(v, sx + i, out + i);
+}
+
+int raycast_project(const RayView *v, float wx, float wy, float *sx, float *depth)
+{
+    float dx = wx - v->px;
+    float dy = wy - v->py;
+
+    /* Split the offset into depth along the view and position on the plane. */
+    float d = dx * v->dirX + dy * v->dirY;
+    if (d <= 0.0f) return 0;
+
+    float halfPlane = tanf(FOV * 0.5f);
+    float cameraX = (dx * -v->dirY + dy * v->dirX) / (d * halfPlane);
+    if (fabsf(cameraX) >= 1.0f) return 0;
+
+    *sx = (cameraX + 1.0f) * 0.5f * (float)W;
+    *depth = d;
+    return 1;
+}
+
+int raycast_hit_is_wall(const RayHit *hit)
+{
+    /* Skip rendering if nothing hit or beyond max range. */
+    return tile_is(hit->tile, TILE_OPAQUE) && hit->perpWallDist <= MAX_DIST;
+}
+
+int raycast_tex_x(const RayHit *hit, int texW)
+{
+    int texX = (int)(hit->wallX * (float)texW);
+    /* Flip the texture coordinate for certain faces to prevent mirroring. */
+    if ((hit->side == 0 && hit->rayDirX > 0) || (hit->side == 1 && hit->rayDirY < 0)) {
+        texX = texW - texX - 1;
+    }
+    if (texX < 0) texX = 0;
+    if (texX >= texW) texX = texW - 1;
+    return texX;
+}
@@ -0,0 +1,73 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Grid raycasting shared by the world renderers.
+ *
+ * Both the SDL_RenderCopy path (render.c) and the software framebuffer path
+ * (swrender.c) trace exactly the same rays so their output can be compared
+ * column for column.
+ *
+ * Ray directions are interpolated across a camera plane, so perpWallDist is
+ * the distance along the view direction and walls do not bulge (no fisheye).
+ * raycast_columns() traces 4 (SSE2) or 8 (AVX2) adjacent columns per packet
+ * when the CPU supports it; the results are identical to raycast_column().
+ */
+
+/* Maximum draw distance in tiles. */
+#define MAX_DIST 30.0f
+
+/* Everything a ray depends on, captured once per frame. Rays only ever read
+ * this copy, so columns can be traced on worker threads while the main
+ * thread owns the live player globals. The map tiles are shared, not
+ * copied: the map must not change until the frame's rays are done. Rays
+ * stop at the wall padding around the map (MAP_PAD), so they never need to
+ * check the map's bounds; px, py must be on the map. */
+typedef struct {
+    float px;
+    float py;
+    float angle;
+    const Uint16 *map;  /* tile (0, 0), see worldmap */
+    int stride;
+    float dirX, dirY;     /* view direction */
+    float planeX, planeY; /* camera plane, half-width tan(FOV / 2) */
+} RayView;
+
+typedef struct {
+    float rayDirX;
+    float rayDirY;
+    float perpWallDist;
+    float wallX;     /* hit position along the wall face, 0..1 */
+    int side;        /* 0: x side hit, 1: y side hit */
+    int tile;        /* TILE_OPAQUE tile id that was hit, 0 if nothing was */
+} RayHit;
+
+/* Snapshot the player position and view angle, alpha (0..1) of the way
+ * from where they were at the start of the last simulation step (prev_px,
+ * prev_py, prev_angle) to where they are now, and the map into v. */
+void raycast_capture_view(RayView *v, float alpha);
+
+/* Trace the ray for screen column sx (0..W-1) as seen from view v. */
+void raycast_column(const RayView *v, int sx, RayHit *out);
+
+/* Trace columns sx .. sx + n - 1 into out[0 .. n - 1] with the widest packet
+ * kernel available. Call raycast_capture_view() on the main thread first. */
+void raycast_columns(const RayView *v, int sx, int n, RayHit *out);
+
+/* Name of the packet kernel picked for this CPU ("AVX2", "SSE2" or "SCALAR"). */
+const char *raycast_kernel_name(void);
+
+/* Project world point (wx, wy) with the same camera as the rays. Returns 1
+ * and stores the screen column in *sx and the depth along the view direction
+ * in *depth if the point is inside the field of view, otherwise returns 0. */
+int raycast_project(const RayView *v, float wx, float wy, float *sx, float *depth);
+
+/* Returns 1 if the hit should draw a wall stripe, 0 for floor/ceiling only. */
+int raycast_hit_is_wall(const RayHit *hit);
+
+/* Texture column for a wall hit on a texture texW pixels wide. */
+int raycast_tex_x(const RayHit *hit, int texW);
+
+#endif /* RAYCAST_H */
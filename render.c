@@ -1,67 +1,39 @@
 #include <SDL2/SDL.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "render.h"
 #include "player.h"
 #include "enemy.h"
+#include "items.h"
 #include "map.h"
+#include "raycast.h"
+#include "swrender.h"
+#include "mipmap.h"
+#include "spatial.h"
+#include "trace.h"
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-#define MAX_DIST 30.0f
-/* Removed STEP constant – we now use a DDA algorithm for raycasts. */
-/* The DDA algorithm calculates intersections with the grid and reduces per-ray
- * iterations compared to naive stepping. */
+/* World rays are cast by raycast.c (DDA), shared with the software path. */
 
 /* -------------------------------------------------------------------------
- * Visibility helper
+ * Depth buffer
  *
- * Determine whether a point at (tx, ty) is visible from the player's
- * position by checking for walls along the line between them. The function
- * marches along the line using small increments and stops when it either
- * encounters a solid wall or reaches the tile containing the target point.
- * Returning 1 indicates the target is visible, 0 means it is occluded.
+ * The wall pass stores the perpendicular distance of each column's wall hit
+ * (FAR_DEPTH where nothing was hit). Sprites are depth tested against it
+ * column by column, so a sprite that is half behind a wall shows its
+ * visible half, and the test costs the same at any distance.
  */
-static int is_visible_to_player(float tx, float ty)
-{
-    /* Compute direction vector from player to target. */
-    float dx = tx - px;
-    float dy = ty - py;
-    float dist = sqrtf(dx * dx + dy * dy);
-    if (dist <= 0.0f) {
-        return 1;
-    }
-    float invDist = 1.0f / dist;
-    float vx = dx * invDist;
-    float vy = dy * invDist;
-
-    float t = 0.0f;
-    /* Step along the line in small increments. A smaller step results in
-     * finer visibility testing at the cost of more iterations. */
-    const float step = 0.05f;
-    while (t < dist) {
-        float cx = px + vx * t;
-        float cy = py + vy * t;
-        int mx = (int)cx;
-        int my = (int)cy;
-        if (mx < 0 || my < 0 || mx >= worldWidth || my >= worldHeight) {
-            return 0;
-        }
-        /* If we've reached the tile containing the target, stop. */
-        if (mx == (int)tx && my == (int)ty) {
-            break;
-        }
-        /* If this tile is a wall/door, the target is occluded. */
-        if (worldmap[my][mx] >= 2) {
-            return 0;
-        }
-        t += step;
-    }
-    return 1;
+#define FAR_DEPTH 1e30f
+
+static float zbuf[W];
+
+RenderStats render_stats;
+
+void render_stats_reset(void)
+{
+    memset(&render_stats, 0, sizeof render_stats);
 }
 
 /* ------------------------------------------------------------
@@ -73,52 +45,65 @@ SDL_Texture *texFloor_ep[3] = {NULL, NULL, NULL};
 SDL_Texture *texCeil_ep[3]  = {NULL, NULL, NULL};
 SDL_Texture *texDoor = NULL;
 
-SDL_Texture *texKey = NULL;
+SpriteHandle sprKey;
 
 SDL_Texture *texMenu = NULL;
 SDL_Texture *texCutscene[9] = {NULL};
 SDL_Texture *texEnding = NULL;
 
-SDL_Texture *texAmmo = NULL;
-SDL_Texture *texMedkit = NULL;
-SDL_Texture *texShotgunItem = NULL;
-SDL_Texture *texSMGItem = NULL;
-SDL_Texture *texShells = NULL;
-SDL_Texture *texEnergy = NULL;
-SDL_Texture *texPlasmaItem = NULL;
-SDL_Texture *texRRGItem = NULL;
-
-SDL_Texture *texEnemy1 = NULL;
-SDL_Texture *texEnemy1Die = NULL;
-SDL_Texture *texEnemy1Attack = NULL;
-
-SDL_Texture *texEnemy2 = NULL;
-SDL_Texture *texEnemy2Die = NULL;
-SDL_Texture *texEnemy2Attack = NULL;
-
-SDL_Texture *texMiniboss1 = NULL;
-SDL_Texture *texMiniboss1Die = NULL;
-SDL_Texture *texMiniboss1Attack = NULL;
-
-SDL_Texture *texFinalboss = NULL;
-SDL_Texture *texFinalbossDie = NULL;
-SDL_Texture *texFinalbossAttack = NULL;
-
-SDL_Texture *texGun = NULL;
-SDL_Texture *texGunRecoil = NULL;
-SDL_Texture *texShotgun = NULL;
-SDL_Texture *texShotgunRecoil = NULL;
-SDL_Texture *texSMG = NULL;
-SDL_Texture *texSMGRecoil = NULL;
-SDL_Texture *texPlasma = NULL;
-SDL_Texture *texPlasmaRecoil = NULL;
-SDL_Texture *texRRG = NULL;
-SDL_Texture *texRRGRecoil = NULL;
-
-SDL_Texture *texPlayer = NULL;
-SDL_Texture *texPlayerDamage = NULL;
-SDL_Texture *texPlayerDead = NULL;
-SDL_Texture *texGodmod = NULL;
+SpriteHandle sprAmmo;
+SpriteHandle sprMedkit;
+SpriteHandle sprShotgunItem;
+SpriteHandle sprSMGItem;
+SpriteHandle sprShells;
+SpriteHandle sprEnergy;
+SpriteHandle sprPlasmaItem;
+SpriteHandle sprRRGItem;
+
+SpriteHandle sprEnemy1;
+SpriteHandle sprEnemy1Die;
+SpriteHandle sprEnemy1Attack;
+
+SpriteHandle sprEnemy2;
+SpriteHandle sprEnemy2Die;
+SpriteHandle sprEnemy2Attack;
+
+SpriteHandle sprMiniboss1;
+SpriteHandle sprMiniboss1Die;
+SpriteHandle sprMiniboss1Attack;
+
+SpriteHandle sprFinalboss;
+SpriteHandle sprFinalbossDie;
+SpriteHandle sprFinalbossAttack;
+
+SpriteHandle sprGun;
+SpriteHandle sprGunRecoil;
+SpriteHandle sprShotgun;
+SpriteHandle sprShotgunRecoil;
+SpriteHandle sprSMG;
+SpriteHandle sprSMGRecoil;
+SpriteHandle sprPlasma;
+SpriteHandle sprPlasmaRecoil;
+SpriteHandle sprRRG;
+SpriteHandle sprRRGRecoil;
+
+SpriteHandle sprPlayer;
+SpriteHandle sprPlayerDamage;
+SpriteHandle sprPlayerDead;
+SpriteHandle sprGodmod;
+
+/* Mip chains of the world textures for the SDL path. level[0] is the
+ * texture itself; the software path keeps its own CPU copies. */
+typedef struct {
+    SDL_Texture *level[MIP_MAX_LEVELS];
+    int w[MIP_MAX_LEVELS], h[MIP_MAX_LEVELS];
+    int levels;
+} WorldMips;
+
+#define MAX_WORLD_MIPS 32
+
+static WorldMips world_mips[MAX_WORLD_MIPS];
+static int world_mip_count = 0;
 
 static char ASSET_PATH[512];
 
@@ -133,13 +118,64 @@ static void init_asset_path(void)
     }
 }
 
-static SDL_Texture *load_tex(SDL_Renderer *r, const char *file, int ck)
+static void build_world_mips(SDL_Renderer *r, SDL_Texture *t, SDL_Surface *s, int ck)
+{
+    if (world_mip_count >= MAX_WORLD_MIPS) {
+        fprintf(stderr, "RENDER: too many world textures\n");
+        return;
+    }
+
+    WorldMips *m = &world_mips[world_mip_count++];
+    m->level[0] = t;
+    m->w[0] = s->w;
+    m->h[0] = s->h;
+    m->levels = 1;
+
+    SDL_Surface *cur = SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_ARGB8888, 0);
+    while (cur && m->levels < MIP_MAX_LEVELS) {
+        SDL_Surface *next = mip_downsample(cur);
+        SDL_FreeSurface(cur);
+        cur = next;
+        if (!cur) break;
+
+        SDL_Texture *lt = SDL_CreateTextureFromSurface(r, cur);
+        if (!lt) break;
+        SDL_SetTextureBlendMode(lt, ck ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+
+        m->level[m->levels] = lt;
+        m->w[m->levels] = cur->w;
+        m->h[m->levels] = cur->h;
+        m->levels++;
+    }
+    SDL_FreeSurface(cur);
+}
+
+/* Level of texture t to draw a wall stripe h pixels tall. Textures without a
+ * chain are drawn as they are. */
+static SDL_Texture *world_mip_for(SDL_Texture *t, float h, int *texW, int *texH)
+{
+    for (int i = 0; i < world_mip_count; i++) {
+        const WorldMips *m = &world_mips[i];
+        if (m->level[0] != t) continue;
+
+        int l = mip_level_for((float)m->h[0] / h, m->levels);
+        *texW = m->w[l];
+        *texH = m->h[l];
+        return m->level[l];
+    }
+    SDL_QueryTexture(t, NULL, NULL, texW, texH);
+    return t;
+}
+
+static SDL_Texture *load_tex_ex(SDL_Renderer *r, const char *file, int ck, int world)
 {
     char full[512];
     snprintf(full, sizeof full, "%s%s", ASSET_PATH, file);
 
+    trace_begin_detail("load_tex", file);
     SDL_Surface *s = SDL_LoadBMP(full);
     if (!s) {
+        trace_end("load_tex");
         return NULL;
     }
 
@@ -147,10 +183,48 @@ static SDL_Texture *load_tex(SDL_Renderer *r, const char *file, int ck)
         SDL_SetColorKey(s, SDL_TRUE, SDL_MapRGB(s->format, 0, 0, 0));
 
     SDL_Texture *t = SDL_CreateTextureFromSurface(r, s);
+
+    /* World textures are also sampled by the software renderer, and both
+     * paths draw distant walls from smaller mip levels. */
+    if (world && t) {
+        swr_register_texture(t, s);
+        build_world_mips(r, t, s, ck);
+    }
+
     SDL_FreeSurface(s);
+    trace_end("load_tex");
     return t;
 }
 
+static SDL_Texture *load_tex(SDL_Renderer *r, const char *file, int ck)
+{
+    return load_tex_ex(r, file, ck, 0);
+}
+
+static SDL_Texture *load_world_tex(SDL_Renderer *r, const char *file, int ck)
+{
+    return load_tex_ex(r, file, ck, 1);
+}
+
+/* Queue a colour-keyed sprite for the atlas; *out is filled by atlas_build(). */
+static int load_sprite(SpriteHandle *out, const char *file)
+{
+    char full[512];
+    snprintf(full, sizeof full, "%s%s", ASSET_PATH, file);
+
+    trace_begin_detail("load_sprite", file);
+    SDL_Surface *s = SDL_LoadBMP(full);
+    atlas_add(out, s);
+    trace_end("load_sprite");
+    return s ? 0 : -1;
+}
+
+static void load_sprite_try(SpriteHandle *out, const char *a, const char *b)
+{
+    if (load_sprite(out, a) != 0)
+        load_sprite(out, b);
+}
+
 static SDL_Texture *load_tex_try(SDL_Renderer *r, int ck, const char *a, const char *b)
 {
     SDL_Texture *t = NULL;
@@ -159,25 +233,33 @@ static SDL_Texture *load_tex_try(SDL_Renderer *r, int ck, const char *a, const c
     return t;
 }
 
+static SDL_Texture *load_world_tex_try(SDL_Renderer *r, int ck, const char *a, const char *b)
+{
+    SDL_Texture *t = NULL;
+    if (a && a[0]) t = load_world_tex(r, a, ck);
+    if (!t && b && b[0]) t = load_world_tex(r, b, ck);
+    return t;
+}
+
 static void load_episode_textures(SDL_Renderer *r)
 {
     /* EP1 */
-    texWall1_ep[0] = load_tex_try(r, 0, "wall1.bmp", "wall.bmp");
-    texWall2_ep[0] = load_tex(r, "wall2.bmp", 0);
-    texFloor_ep[0] = load_tex(r, "floor.bmp", 0);
-    texCeil_ep[0]  = load_tex(r, "ceiling.bmp", 0);
+    texWall1_ep[0] = load_world_tex_try(r, 0, "wall1.bmp", "wall.bmp");
+    texWall2_ep[0] = load_world_tex(r, "wall2.bmp", 0);
+    texFloor_ep[0] = load_world_tex(r, "floor.bmp", 0);
+    texCeil_ep[0]  = load_world_tex(r, "ceiling.bmp", 0);
 
     /* EP2 */
-    texWall1_ep[1] = load_tex(r, "wall_ep2.bmp", 0);
-    texWall2_ep[1] = load_tex(r, "wall2_ep2.bmp", 0);
-    texFloor_ep[1] = load_tex(r, "floor_ep2.bmp", 0);
-    texCeil_ep[1]  = load_tex(r, "ceiling_ep2.bmp", 0);
+    texWall1_ep[1] = load_world_tex(r, "wall_ep2.bmp", 0);
+    texWall2_ep[1] = load_world_tex(r, "wall2_ep2.bmp", 0);
+    texFloor_ep[1] = load_world_tex(r, "floor_ep2.bmp", 0);
+    texCeil_ep[1]  = load_world_tex(r, "ceiling_ep2.bmp", 0);
 
     /* EP3 */
-    texWall1_ep[2] = load_tex(r, "wall_ep3.bmp", 0);
-    texWall2_ep[2] = load_tex(r, "wall2_ep3.bmp", 0);
-    texFloor_ep[2] = load_tex(r, "floor_ep3.bmp", 0);
-    texCeil_ep[2]  = load_tex(r, "ceiling_ep3.bmp", 0);
+    texWall1_ep[2] = load_world_tex(r, "wall_ep3.bmp", 0);
+    texWall2_ep[2] = load_world_tex(r, "wall2_ep3.bmp", 0);
+    texFloor_ep[2] = load_world_tex(r, "floor_ep3.bmp", 0);
+    texCeil_ep[2]  = load_world_tex(r, "ceiling_ep3.bmp", 0);
 
     /* Fallbacks if episode assets are missing (keep game running). */
     for (int i = 0; i < 3; i++) {
@@ -190,12 +272,12 @@ static void load_episode_textures(SDL_Renderer *r)
 
 void load_textures(SDL_Renderer *r)
 {
+    trace_begin("load_textures");
     init_asset_path();
 
     load_episode_textures(r);
 
-    texDoor = load_tex(r, "door.bmp", 1);
-    texKey  = load_tex(r, "key.bmp", 1);
+    texDoor = load_world_tex(r, "door.bmp", 1);
 
     texMenu = load_tex(r, "menu.bmp", 0);
 
@@ -206,56 +288,62 @@ void load_textures(SDL_Renderer *r)
     }
     texEnding = load_tex_try(r, 0, "ending.bmp", "escape.bmp");
 
-    texAmmo        = load_tex(r, "ammo.bmp", 1);
-    texMedkit      = load_tex(r, "medkit.bmp", 1);
-    texShotgunItem = load_tex_try(r, 1, "shotgun_item.bmp", "shogun_item.bmp");
-    texSMGItem     = load_tex(r, "smg_item.bmp", 1);
-    texShells      = load_tex(r, "shells.bmp", 1);
-    texEnergy      = load_tex(r, "energy.bmp", 1);
-    texPlasmaItem  = load_tex(r, "plasma_item.bmp", 1);
-    texRRGItem     = load_tex_try(r, 1, "RRG_item.bmp", "rrg_item.bmp");
-
-    texEnemy1       = load_tex(r, "enemy.bmp", 1);
-    texEnemy1Die    = load_tex(r, "enemy_die.bmp", 1);
-    texEnemy1Attack = load_tex(r, "enemy_attack.bmp", 1);
-
-    texEnemy2       = load_tex(r, "enemy2.bmp", 1);
-    texEnemy2Die    = load_tex(r, "enemy2_die.bmp", 1);
-    texEnemy2Attack = load_tex(r, "enemy2_attack.bmp", 1);
-
-    texMiniboss1       = load_tex(r, "miniboss1.bmp", 1);
-    texMiniboss1Die    = load_tex(r, "miniboss1_die.bmp", 1);
-    texMiniboss1Attack = load_tex(r, "miniboss1_attack.bmp", 1);
-
-    texFinalboss       = load_tex(r, "finalboss.bmp", 1);
-    texFinalbossDie    = load_tex(r, "finalboss_die.bmp", 1);
-    texFinalbossAttack = load_tex(r, "finalboss_attack.bmp", 1);
-
-    texGun         = load_tex(r, "gun.bmp", 1);
-    texGunRecoil   = load_tex(r, "gun_recoil.bmp", 1);
-    texShotgun     = load_tex(r, "shotgun.bmp", 1);
-    texShotgunRecoil = load_tex(r, "shotgun_recoil.bmp", 1);
-    texSMG         = load_tex(r, "smg.bmp", 1);
-    texSMGRecoil   = load_tex(r, "smg_recoil.bmp", 1);
-    texPlasma      = load_tex(r, "plasma.bmp", 1);
-    texPlasmaRecoil = load_tex(r, "plasma_recoil.bmp", 1);
-    texRRG         = load_tex_try(r, 1, "RRG.bmp", "rrg.bmp");
-    texRRGRecoil   = load_tex_try(r, 1, "RRG_recoil.bmp", "rrg_recoil.bmp");
-
-    texPlayer       = load_tex(r, "player.bmp", 1);
-    texPlayerDamage = load_tex(r, "player_damage.bmp", 1);
-    texPlayerDead   = load_tex(r, "player_dead.bmp", 1);
-    texGodmod       = load_tex(r, "godmod.bmp", 1);
+    load_sprite(&sprKey, "key.bmp");
+
+    load_sprite(&sprAmmo, "ammo.bmp");
+    load_sprite(&sprMedkit, "medkit.bmp");
+    load_sprite_try(&sprShotgunItem, "shotgun_item.bmp", "shogun_item.bmp");
+    load_sprite(&sprSMGItem, "smg_item.bmp");
+    load_sprite(&sprShells, "shells.bmp");
+    load_sprite(&sprEnergy, "energy.bmp");
+    load_sprite(&sprPlasmaItem, "plasma_item.bmp");
+    load_sprite_try(&sprRRGItem, "RRG_item.bmp", "rrg_item.bmp");
+
+    load_sprite(&sprEnemy1, "enemy.bmp");
+    load_sprite(&sprEnemy1Die, "enemy_die.bmp");
+    load_sprite(&sprEnemy1Attack, "enemy_attack.bmp");
+
+    load_sprite(&sprEnemy2, "enemy2.bmp");
+    load_sprite(&sprEnemy2Die, "enemy2_die.bmp");
+    load_sprite(&sprEnemy2Attack, "enemy2_attack.bmp");
+
+    load_sprite(&sprMiniboss1, "miniboss1.bmp");
+    load_sprite(&sprMiniboss1Die, "miniboss1_die.bmp");
+    load_sprite(&sprMiniboss1Attack, "miniboss1_attack.bmp");
+
+    load_sprite(&sprFinalboss, "finalboss.bmp");
+    load_sprite(&sprFinalbossDie, "finalboss_die.bmp");
+    load_sprite(&sprFinalbossAttack, "finalboss_attack.bmp");
+
+    load_sprite(&sprGun, "gun.bmp");
+    load_sprite(&sprGunRecoil, "gun_recoil.bmp");
+    load_sprite(&sprShotgun, "shotgun.bmp");
+    load_sprite(&sprShotgunRecoil, "shotgun_recoil.bmp");
+    load_sprite(&sprSMG, "smg.bmp");
+    load_sprite(&sprSMGRecoil, "smg_recoil.bmp");
+    load_sprite(&sprPlasma, "plasma.bmp");
+    load_sprite(&sprPlasmaRecoil, "plasma_recoil.bmp");
+    load_sprite_try(&sprRRG, "RRG.bmp", "rrg.bmp");
+    load_sprite_try(&sprRRGRecoil, "RRG_recoil.bmp", "rrg_recoil.bmp");
+
+    load_sprite(&sprPlayer, "player.bmp");
+    load_sprite(&sprPlayerDamage, "player_damage.bmp");
+    load_sprite(&sprPlayerDead, "player_dead.bmp");
+    load_sprite(&sprGodmod, "godmod.bmp");
+
+    if (atlas_build(r) != 0)
+        fprintf(stderr, "RENDER: some sprites could not be packed\n");
 
     /* If enemy attack textures are missing, fall back to normal sprites. */
-    if (!texEnemy1Attack) texEnemy1Attack = texEnemy1;
-    if (!texEnemy2Attack) texEnemy2Attack = texEnemy2;
-    if (!texMiniboss1Attack) texMiniboss1Attack = texMiniboss1;
-    if (!texFinalbossAttack) texFinalbossAttack = texFinalboss;
-
-    if (!texEnemy2Die) texEnemy2Die = texEnemy1Die;
-    if (!texMiniboss1Die) texMiniboss1Die = texEnemy1Die;
-    if (!texFinalbossDie) texFinalbossDie = texEnemy1Die;
+    if (!sprEnemy1Attack.atlas) sprEnemy1Attack = sprEnemy1;
+    if (!sprEnemy2Attack.atlas) sprEnemy2Attack = sprEnemy2;
+    if (!sprMiniboss1Attack.atlas) sprMiniboss1Attack = sprMiniboss1;
+    if (!sprFinalbossAttack.atlas) sprFinalbossAttack = sprFinalboss;
+
+    if (!sprEnemy2Die.atlas) sprEnemy2Die = sprEnemy1Die;
+    if (!sprMiniboss1Die.atlas) sprMiniboss1Die = sprEnemy1Die;
+    if (!sprFinalbossDie.atlas) sprFinalbossDie = sprEnemy1Die;
+    trace_end("load_textures");
 }
 
 static int episode_index_for_level(int level)
@@ -265,114 +353,57 @@ static int episode_index_for_level(int level)
     return 2;
 }
 
-void draw_world(SDL_Renderer *r)
+/* ------------------------------------------------------------
+ * WORLD
+ * ------------------------------------------------------------ */
+static RenderPath world_path = RENDER_PATH_SDL;
+
+void render_set_path(RenderPath p)
 {
-    if (!worldmap || worldWidth <= 0 || worldHeight <= 0)
-        return;
+    world_path = (p == RENDER_PATH_SOFTWARE) ? RENDER_PATH_SOFTWARE : RENDER_PATH_SDL;
+}
 
-    int ep = episode_index_for_level(map_current_level);
-    SDL_Texture *tWall1 = texWall1_ep[ep];
-    SDL_Texture *tWall2 = texWall2_ep[ep];
-    SDL_Texture *tFloor = texFloor_ep[ep];
-    SDL_Texture *tCeil  = texCeil_ep[ep];
+RenderPath render_get_path(void)
+{
+    return world_path;
+}
 
-    /* Ray cast each column using a DDA algorithm. */
-    for (int sx = 0; sx < W; sx++) {
-        /* Compute current ray angle within the player's field of view. */
-        float rayAngle = angle - FOV * 0.5f + ((float)sx / (float)W) * FOV;
-        float rayDirX = cosf(rayAngle);
-        float rayDirY = sinf(rayAngle);
-
-        /* Grid position of the player. */
-        int mapX = (int)px;
-        int mapY = (int)py;
-
-        /* Calculate the distance the ray has to travel from one x or y-side to the next. */
-        float deltaDistX = (rayDirX == 0.0f) ? 1e30f : fabsf(1.0f / rayDirX);
-        float deltaDistY = (rayDirY == 0.0f) ? 1e30f : fabsf(1.0f / rayDirY);
-
-        /* Calculate step direction and initial side distance. */
-        int stepX;
-        int stepY;
-        float sideDistX;
-        float sideDistY;
-
-        if (rayDirX < 0) {
-            stepX = -1;
-            sideDistX = (px - (float)mapX) * deltaDistX;
-        } else {
-            stepX = 1;
-            sideDistX = ((float)mapX + 1.0f - px) * deltaDistX;
-        }
-        if (rayDirY < 0) {
-            stepY = -1;
-            sideDistY = (py - (float)mapY) * deltaDistY;
-        } else {
-            stepY = 1;
-            sideDistY = ((float)mapY + 1.0f - py) * deltaDistY;
-        }
+static float draw_alpha = 1.0f;
 
-        int hit = 0;
-        int side = 0;
-        int tile = 0;
-
-        float perpWallDist = MAX_DIST;
-
-        /* Perform DDA: step through the grid until hitting a wall or exceeding max distance. */
-        while (!hit) {
-            if (sideDistX < sideDistY) {
-                sideDistX += deltaDistX;
-                mapX += stepX;
-                side = 0;
-            } else {
-                sideDistY += deltaDistY;
-                mapY += stepY;
-                side = 1;
-            }
-            /* Check world bounds. */
-            if (mapX < 0 || mapY < 0 || mapX >= worldWidth || mapY >= worldHeight) {
-                tile = 2;
-                hit = 1;
-                /* Use MAX_DIST as distance for out-of-bound rays. */
-                perpWallDist = MAX_DIST;
-                break;
-            }
-            tile = worldmap[mapY][mapX];
-            if (tile >= 2) {
-                hit = 1;
-                /* Calculate distance projected on camera direction (perpendicular distance) to avoid fish-eye effect. */
-                if (side == 0) {
-                    perpWallDist = ((float)mapX - px + (1.0f - (float)stepX) * 0.5f) / (rayDirX == 0.0f ? 1e-6f : rayDirX);
-                } else {
-                    perpWallDist = ((float)mapY - py + (1.0f - (float)stepY) * 0.5f) / (rayDirY == 0.0f ? 1e-6f : rayDirY);
-                }
-                /* Clamp to avoid extremely small distances. */
-                if (perpWallDist <= 0.0f) perpWallDist = 0.001f;
-            }
-            /* Stop if the distance is beyond maximum draw distance. */
-            float approxDist = (side == 0) ? sideDistX - deltaDistX : sideDistY - deltaDistY;
-            if (approxDist > MAX_DIST) {
-                hit = 1;
-                tile = 0;
-                break;
-            }
-        }
+void render_set_alpha(float alpha)
+{
+    draw_alpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
+/* One SDL_RenderCopy per ceiling, floor and wall stripe of every column. */
+static void draw_world_sdl(SDL_Renderer *r, const RayView *view, SDL_Texture *const walls[WALL_TEX_COUNT],
+                           SDL_Texture *tFloor, SDL_Texture *tCeil)
+{
+    static RayHit hits[W];
+    raycast_columns(view, 0, W, hits);
+
+    for (int sx = 0; sx < W; sx++) {
+        const RayHit hit = hits[sx];
 
-        /* Skip rendering if nothing hit or beyond max range. */
-        if (tile < 2 || perpWallDist > MAX_DIST) {
+        if (!raycast_hit_is_wall(&hit)) {
+            zbuf[sx] = FAR_DEPTH;
             /* Fill entire column with ceiling on top and floor on bottom. */
             int half = H / 2;
             if (tCeil) {
                 SDL_RenderCopy(r, tCeil, NULL, &(SDL_Rect){sx, 0, 1, half});
+                render_stats.draw_calls++;
             }
             if (tFloor) {
                 SDL_RenderCopy(r, tFloor, NULL, &(SDL_Rect){sx, half, 1, H - half});
+                render_stats.draw_calls++;
             }
             continue;
         }
 
+        zbuf[sx] = hit.perpWallDist;
+
         /* Calculate height of line to draw on screen. */
-        float h = 240.0f / perpWallDist;
+        float h = 240.0f / hit.perpWallDist;
         int y1 = (int)(H / 2 - h / 2);
         int y2 = (int)(H / 2 + h / 2);
         if (y1 < 0) y1 = 0;
@@ -381,183 +412,380 @@ void draw_world(SDL_Renderer *r)
         /* Draw ceiling above the wall. */
         if (tCeil && y1 > 0) {
             SDL_RenderCopy(r, tCeil, NULL, &(SDL_Rect){sx, 0, 1, y1});
+            render_stats.draw_calls++;
         }
         /* Draw floor below the wall. */
         if (tFloor && y2 < H) {
             SDL_RenderCopy(r, tFloor, NULL, &(SDL_Rect){sx, y2, 1, H - y2});
+            render_stats.draw_calls++;
         }
 
         /* Choose texture based on tile type. */
-        SDL_Texture *T = (tile == 4) ? tWall2 : (tile == 3) ? texDoor : tWall1;
+        SDL_Texture *T = walls[tile_info[hit.tile].wall_tex];
         if (!T) continue;
 
         int texW = 0, texH = 0;
-        SDL_QueryTexture(T, NULL, NULL, &texW, &texH);
-
-        /* Calculate where exactly the wall was hit. */
-        float wallX;
-        if (side == 0) {
-            wallX = py + perpWallDist * rayDirY;
-        } else {
-            wallX = px + perpWallDist * rayDirX;
-        }
-        wallX -= floorf(wallX);
-        int texX = (int)(wallX * (float)texW);
-        /* Flip the texture coordinate for certain faces to prevent mirroring. */
-        if ((side == 0 && rayDirX > 0) || (side == 1 && rayDirY < 0)) {
-            texX = texW - texX - 1;
-        }
-        if (texX < 0) texX = 0;
-        if (texX >= texW) texX = texW - 1;
+        T = world_mip_for(T, h, &texW, &texH);
+        int texX = raycast_tex_x(&hit, texW);
 
         /* Render a single vertical stripe from the texture. */
         SDL_RenderCopy(r, T,
                        &(SDL_Rect){texX, 0, 1, texH},
                        &(SDL_Rect){sx, y1, 1, y2 - y1});
+        render_stats.draw_calls++;
     }
 }
 
-void draw_keys(SDL_Renderer *r)
+void draw_world(SDL_Renderer *r)
 {
-    if (!worldmap || worldWidth <= 0 || worldHeight <= 0 || !texKey)
+    if (!worldmap || worldWidth <= 0 || worldHeight <= 0)
         return;
 
-    for (int y = 0; y < worldHeight; y++)
-    for (int x = 0; x < worldWidth; x++) {
-        if (worldmap[y][x] != 1) continue;
+    int ep = episode_index_for_level(map_current_level);
+    SDL_Texture *walls[WALL_TEX_COUNT];
+    walls[WALL_TEX_WALL1] = texWall1_ep[ep];
+    walls[WALL_TEX_WALL2] = texWall2_ep[ep];
+    walls[WALL_TEX_DOOR] = texDoor;
+    SDL_Texture *tFloor = texFloor_ep[ep];
+    SDL_Texture *tCeil  = texCeil_ep[ep];
+
+    Uint64 t0 = SDL_GetPerformanceCounter();
+
+    RayView view;
+    raycast_capture_view(&view, draw_alpha);
+
+    int drawn = 0;
+    if (world_path == RENDER_PATH_SOFTWARE) {
+        SwrWorldTextures set;
+        memcpy(set.walls, walls, sizeof set.walls);
+        set.floorTex = tFloor;
+        set.ceilTex = tCeil;
+        drawn = (swr_draw_world(r, &view, &set, zbuf) == 0);
+        /* Streaming textures unavailable: stay on the SDL path. */
+        if (!drawn) world_path = RENDER_PATH_SDL;
+    }
+
+    if (!drawn)
+        draw_world_sdl(r, &view, walls, tFloor, tCeil);
+
+    render_stats.rays += W;
+    render_stats.world_ticks += SDL_GetPerformanceCounter() - t0;
+}
+
+/* ------------------------------------------------------------
+ * SPRITES
+ *
+ * Keys, items and enemies are submitted as billboards into a frame-local
+ * list, sorted back to front and drawn as textured quads. A sprite becomes
+ * one quad per run of screen columns where it is nearer than the wall in
+ * zbuf, so partially hidden sprites keep their visible part. Consecutive
+ * quads on the same atlas page go out in a single SDL_RenderGeometry call;
+ * with every sprite on one page that is one call per frame. Each sprite
+ * samples the atlas mip level that matches its size on screen.
+ * ------------------------------------------------------------ */
+typedef struct {
+    SDL_Texture *atlas;
+    SDL_Rect src;       /* mip level picked for the on-screen size */
+    float depth;
+    SDL_Rect dst;
+} Sprite;
+
+/* One visible run of a sprite: columns [x0, x1) of its destination rect,
+ * showing the src rect of the atlas. */
+typedef struct {
+    SDL_Rect src;
+    SDL_Rect dst;
+    int x0, x1;
+} SpriteQuad;
+
+#define MAX_SPRITES 512
+#define SPRITE_BATCH_QUADS 256
+
+static Sprite sprite_list[MAX_SPRITES];
+static int sprite_count = 0;
+
+static SpriteQuad batch_quads[SPRITE_BATCH_QUADS];
+static int batch_count = 0;
+static SDL_Texture *batch_tex = NULL;
+
+/* Set once SDL_RenderGeometry fails (SDL older than 2.0.18 or a backend
+ * without geometry support); sprites then use clipped SDL_RenderCopy. */
+static int geometry_unsupported = 0;
+
+void sprites_begin(void)
+{
+    sprite_count = 0;
+}
+
+void sprites_submit(const SpriteHandle *spr, float sx, float depth, float size)
+{
+    if (!spr || !spr->atlas || sprite_count >= MAX_SPRITES) return;
+
+    Sprite *s = &sprite_list[sprite_count++];
+    s->atlas = spr->atlas;
+    s->depth = depth;
+    s->dst = (SDL_Rect){(int)(sx - size/2), (int)(H/2 - size/2), (int)size, (int)size};
+    s->src = *atlas_level_rect(spr, s->dst.w, s->dst.h);
+}
+
+static int sprite_far_first(const void *a, const void *b)
+{
+    float da = ((const Sprite *)a)->depth;
+    float db = ((const Sprite *)b)->depth;
+    return (da < db) - (da > db);
+}
+
+static void flush_batch_copy(SDL_Renderer *r)
+{
+    int clipped = 0;
+    for (int i = 0; i < batch_count; i++) {
+        const SpriteQuad *q = &batch_quads[i];
+        if (q->x0 == q->dst.x && q->x1 == q->dst.x + q->dst.w) {
+            if (clipped) {
+                SDL_RenderSetClipRect(r, NULL);
+                clipped = 0;
+            }
+        } else {
+            SDL_RenderSetClipRect(r, &(SDL_Rect){q->x0, 0, q->x1 - q->x0, H});
+            clipped = 1;
+        }
+        SDL_RenderCopy(r, batch_tex, &q->src, &q->dst);
+        render_stats.draw_calls++;
+    }
+    if (clipped) SDL_RenderSetClipRect(r, NULL);
+}
+
+static void flush_batch(SDL_Renderer *r)
+{
+    if (batch_count == 0) return;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (!geometry_unsupported) {
+        static SDL_Vertex verts[SPRITE_BATCH_QUADS * 4];
+        static int indices[SPRITE_BATCH_QUADS * 6];
+        static int indices_ready = 0;
+
+        if (!indices_ready) {
+            for (int i = 0; i < SPRITE_BATCH_QUADS; i++) {
+                int *ix = &indices[i * 6];
+                ix[0] = i * 4; ix[1] = i * 4 + 1; ix[2] = i * 4 + 2;
+                ix[3] = i * 4; ix[4] = i * 4 + 2; ix[5] = i * 4 + 3;
+            }
+            indices_ready = 1;
+        }
+
+        int aw = 1, ah = 1;
+        SDL_QueryTexture(batch_tex, NULL, NULL, &aw, &ah);
+
+        const SDL_Color white = {255, 255, 255, 255};
+        for (int i = 0; i < batch_count; i++) {
+            const SpriteQuad *q = &batch_quads[i];
+            float x0 = (float)q->x0;
+            float x1 = (float)q->x1;
+            float y0 = (float)q->dst.y;
+            float y1 = (float)(q->dst.y + q->dst.h);
+
+            /* Atlas coordinates of the run's left and right edge. */
+            float f0 = (float)(q->x0 - q->dst.x) / (float)q->dst.w;
+            float f1 = (float)(q->x1 - q->dst.x) / (float)q->dst.w;
+            float u0 = ((float)q->src.x + f0 * (float)q->src.w) / (float)aw;
+            float u1 = ((float)q->src.x + f1 * (float)q->src.w) / (float)aw;
+            float v0 = (float)q->src.y / (float)ah;
+            float v1 = (float)(q->src.y + q->src.h) / (float)ah;
+
+            SDL_Vertex *v = &verts[i * 4];
+            v[0] = (SDL_Vertex){{x0, y0}, white, {u0, v0}};
+            v[1] = (SDL_Vertex){{x1, y0}, white, {u1, v0}};
+            v[2] = (SDL_Vertex){{x1, y1}, white, {u1, v1}};
+            v[3] = (SDL_Vertex){{x0, y1}, white, {u0, v1}};
+        }
+
+        if (SDL_RenderGeometry(r, batch_tex, verts, batch_count * 4, indices, batch_count * 6) == 0) {
+            render_stats.draw_calls++;
+            batch_count = 0;
+            return;
+        }
+        fprintf(stderr, "RENDER: SDL_RenderGeometry failed, using RenderCopy for sprites: %s\n",
+                SDL_GetError());
+        geometry_unsupported = 1;
+    }
+#endif
 
-        float dx = x + 0.5f - px;
-        float dy = y + 0.5f - py;
-        float dir = atan2f(dy, dx) - angle;
+    flush_batch_copy(r);
+    batch_count = 0;
+}
 
-        while (dir >  (float)M_PI) dir -= 2.0f * (float)M_PI;
-        while (dir < -(float)M_PI) dir += 2.0f * (float)M_PI;
+static void push_quad(SDL_Renderer *r, const Sprite *s, int x0, int x1)
+{
+    if (s->atlas != batch_tex || batch_count == SPRITE_BATCH_QUADS) {
+        flush_batch(r);
+        batch_tex = s->atlas;
+    }
+    SpriteQuad *q = &batch_quads[batch_count++];
+    q->src = s->src;
+    q->dst = s->dst;
+    q->x0 = x0;
+    q->x1 = x1;
+}
 
-        if (fabsf(dir) < FOV/2) {
-            float sx = (dir + FOV/2) / FOV * W;
-            float size = 80.0f / sqrtf(dx*dx + dy*dy);
-            SDL_RenderCopy(r, texKey, NULL,
-                           &(SDL_Rect){(int)(sx - size/2), (int)(H/2 - size/2), (int)size, (int)size});
+void sprites_flush(SDL_Renderer *r)
+{
+    qsort(sprite_list, (size_t)sprite_count, sizeof sprite_list[0], sprite_far_first);
+
+    for (int i = 0; i < sprite_count; i++) {
+        const Sprite *s = &sprite_list[i];
+        int x0 = s->dst.x < 0 ? 0 : s->dst.x;
+        int x1 = s->dst.x + s->dst.w > W ? W : s->dst.x + s->dst.w;
+        if (s->dst.w <= 0 || s->dst.h <= 0) continue;
+
+        /* One quad per run of columns where the sprite is in front of the wall. */
+        int c = x0;
+        while (c < x1) {
+            while (c < x1 && zbuf[c] <= s->depth) c++;
+            int start = c;
+            while (c < x1 && zbuf[c] > s->depth) c++;
+            if (c > start)
+                push_quad(r, s, start, c);
         }
     }
+
+    flush_batch(r);
+    batch_tex = NULL;
+    sprite_count = 0;
 }
 
-static void enemy_tex_for(const Enemy *e, SDL_Texture **out)
+static void submit_keys(const RayView *view)
 {
-    SDL_Texture *base = NULL, *die = NULL, *atk = NULL;
+    if (!worldmap || worldWidth <= 0 || worldHeight <= 0 || !sprKey.atlas)
+        return;
 
-    switch (e->kind) {
+    for (int y = 0; y < worldHeight; y++)
+    for (int x = 0; x < worldWidth; x++) {
+        if (!map_is(x, y, TILE_KEY)) continue;
+
+        float sx, depth;
+        if (raycast_project(view, x + 0.5f, y + 0.5f, &sx, &depth))
+            sprites_submit(&sprKey, sx, depth, 80.0f / depth);
+    }
+}
+
+static const SpriteHandle *enemy_sprite_for(int i)
+{
+    const SpriteHandle *base, *die, *atk;
+
+    switch ((EnemyKind)enemies.kind[i]) {
         case ENEMY_KIND1:
-            base = texEnemy1; die = texEnemy1Die; atk = texEnemy1Attack; break;
+            base = &sprEnemy1; die = &sprEnemy1Die; atk = &sprEnemy1Attack; break;
         case ENEMY_KIND2:
-            base = texEnemy2; die = texEnemy2Die; atk = texEnemy2Attack; break;
+            base = &sprEnemy2; die = &sprEnemy2Die; atk = &sprEnemy2Attack; break;
         case ENEMY_MINIBOSS1:
-            base = texMiniboss1; die = texMiniboss1Die; atk = texMiniboss1Attack; break;
+            base = &sprMiniboss1; die = &sprMiniboss1Die; atk = &sprMiniboss1Attack; break;
         case ENEMY_FINALBOSS:
-            base = texFinalboss; die = texFinalbossDie; atk = texFinalbossAttack; break;
+            base = &sprFinalboss; die = &sprFinalbossDie; atk = &sprFinalbossAttack; break;
         default:
-            base = texEnemy1; die = texEnemy1Die; atk = texEnemy1Attack; break;
+            base = &sprEnemy1; die = &sprEnemy1Die; atk = &sprEnemy1Attack; break;
     }
 
-    if (e->state == ENEMY_DYING) *out = die ? die : base;
-    else if (e->state == ENEMY_ALIVE && e->attack_timer > 0.0f) *out = atk ? atk : base;
-    else *out = base;
+    if (enemies.state[i] == ENEMY_DYING) return die->atlas ? die : base;
+    if (enemies.state[i] == ENEMY_ALIVE && enemies.attack_timer[i] > 0.0f) return atk->atlas ? atk : base;
+    return base;
 }
 
-static float enemy_sprite_base_size(const Enemy *e)
+static float enemy_sprite_base_size(int i)
 {
-    switch (e->kind) {
+    switch ((EnemyKind)enemies.kind[i]) {
         case ENEMY_MINIBOSS1: return 260.0f;
         case ENEMY_FINALBOSS: return 320.0f;
         default: return 160.0f;
     }
 }
 
-void draw_enemies(SDL_Renderer *r)
+static void submit_enemies(const RayView *view)
 {
-    for (int i = 0; i < enemy_count; i++) {
-        Enemy *e = &enemies[i];
-        if (e->state == ENEMY_DEAD) continue;
-
-        float dx = e->x - px;
-        float dy = e->y - py;
-        float dir = atan2f(dy, dx) - angle;
-        while (dir >  (float)M_PI) dir -= 2.0f * (float)M_PI;
-        while (dir < -(float)M_PI) dir += 2.0f * (float)M_PI;
-
-        if (fabsf(dir) >= FOV/2) continue;
-
-        /* Determine projected screen x and distance. */
-        float sx = (dir + FOV / 2.0f) / FOV * W;
-        float dist = sqrtf(dx * dx + dy * dy);
-        if (dist < 0.01f) dist = 0.01f;
-        /* Cull enemies that are behind walls. */
-        if (!is_visible_to_player(e->x, e->y)) {
-            continue;
+    /* Only enemies whose centre is inside the view cone can project. */
+    int *visible;
+    int n = spatial_query_cone(SPATIAL_ENEMIES, view->px, view->py, view->dirX, view->dirY,
+                               FOV * 0.5f, 0.0f, &visible);
+
+    for (int k = 0; k < n; k++) {
+        int i = visible[k];
+
+        /* Determine projected screen x and distance, between the enemy's
+         * last two positions like the camera. */
+        float ex = enemies.x[i], ey = enemies.y[i];
+        if (draw_alpha < 1.0f) {
+            ex = enemies.prev_x[i] + (ex - enemies.prev_x[i]) * draw_alpha;
+            ey = enemies.prev_y[i] + (ey - enemies.prev_y[i]) * draw_alpha;
         }
-        float size = enemy_sprite_base_size(e) / dist;
-
-        SDL_Texture *T = NULL;
-        enemy_tex_for(e, &T);
-        if (!T) continue;
+        float sx, dist;
+        if (!raycast_project(view, ex, ey, &sx, &dist)) continue;
+        if (dist < 0.01f) dist = 0.01f;
+        float size = enemy_sprite_base_size(i) / dist;
 
-        SDL_RenderCopy(r, T, NULL,
-                       &(SDL_Rect){(int)(sx - size/2), (int)(H/2 - size/2), (int)size, (int)size});
+        sprites_submit(enemy_sprite_for(i), sx, dist, size);
     }
 }
 
+void draw_sprites(SDL_Renderer *r)
+{
+    RayView view;
+    raycast_capture_view(&view, draw_alpha);
+
+    sprites_begin();
+    submit_keys(&view);
+    submit_items(&view);
+    submit_enemies(&view);
+    sprites_flush(r);
+}
+
 void draw_hud(SDL_Renderer *r)
 {
     SDL_SetRenderDrawColor(r, 0, 0, 0, 255);
     SDL_RenderFillRect(r, &(SDL_Rect){0, H - 120, W, 120});
+    render_stats.draw_calls++;
 
-    SDL_Texture *face = texPlayer;
-    if (godmode_enabled && texGodmod) face = texGodmod;
-    else if (player_dead) face = texPlayerDead;
-    else if (player_damage_timer > 0.0f) face = texPlayerDamage;
+    const SpriteHandle *face = &sprPlayer;
+    if (godmode_enabled && sprGodmod.atlas) face = &sprGodmod;
+    else if (player_dead) face = &sprPlayerDead;
+    else if (player_damage_timer > 0.0f) face = &sprPlayerDamage;
 
-    if (face) {
-        SDL_RenderCopy(r, face, NULL,
-                       &(SDL_Rect){W/2 - 56, H - 120/2 - 56, 112, 112});
-    }
+    atlas_draw(r, face, &(SDL_Rect){W/2 - 56, H - 120/2 - 56, 112, 112});
 
     SDL_SetRenderDrawColor(r, 200, 0, 0, 255);
     int barw = hp * 2;
     if (barw < 0) barw = 0;
     if (barw > W - 40) barw = W - 40;
     SDL_RenderFillRect(r, &(SDL_Rect){20, H - 100, barw, 24});
+    render_stats.draw_calls++;
 }
 
 void draw_gun(SDL_Renderer *r)
 {
-    SDL_Texture *base = texGun;
-    SDL_Texture *recoil = texGunRecoil;
+    const SpriteHandle *base = &sprGun;
+    const SpriteHandle *recoil = &sprGunRecoil;
 
     switch (current_weapon) {
         case WEAPON_SHOTGUN:
-            if (texShotgun && texShotgunRecoil) { base = texShotgun; recoil = texShotgunRecoil; }
+            if (sprShotgun.atlas && sprShotgunRecoil.atlas) { base = &sprShotgun; recoil = &sprShotgunRecoil; }
             break;
         case WEAPON_SMG:
-            if (texSMG && texSMGRecoil) { base = texSMG; recoil = texSMGRecoil; }
+            if (sprSMG.atlas && sprSMGRecoil.atlas) { base = &sprSMG; recoil = &sprSMGRecoil; }
             break;
         case WEAPON_PLASMA:
-            if (texPlasma && texPlasmaRecoil) { base = texPlasma; recoil = texPlasmaRecoil; }
+            if (sprPlasma.atlas && sprPlasmaRecoil.atlas) { base = &sprPlasma; recoil = &sprPlasmaRecoil; }
             break;
         case WEAPON_RRG:
-            if (texRRG && texRRGRecoil) { base = texRRG; recoil = texRRGRecoil; }
+            if (sprRRG.atlas && sprRRGRecoil.atlas) { base = &sprRRG; recoil = &sprRRGRecoil; }
             break;
         default:
             break;
     }
 
-    if (!base) return;
-
-    SDL_RenderCopy(r, (gun_recoil_timer ? recoil : base),
-                   NULL, &(SDL_Rect){W/2 - 110, H - 270, 220, 150});
-    if (gun_recoil_timer > 0) gun_recoil_timer--;
+    atlas_draw(r, (gun_recoil_timer ? recoil : base), &(SDL_Rect){W/2 - 110, H - 270, 220, 150});
 }
 
 void draw_hitbox(SDL_Renderer *r)
 {
     SDL_RenderDrawRect(r, &(SDL_Rect){W/2 - 125, H/2 - 125, 250, 250});
+    render_stats.draw_calls++;
 }
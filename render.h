@@ -3,6 +3,8 @@
 
 #include <SDL2/SDL.h>
 
+#include "atlas.h"
+
 /* Screen size. Keep in sync with the window creation in main.c. */
 #define W 800
 #define H 600
@@ -17,7 +19,9 @@ extern SDL_Texture *texFloor_ep[3];
 extern SDL_Texture *texCeil_ep[3];
 extern SDL_Texture *texDoor;
 
-extern SDL_Texture *texKey;
+/* Sprites, weapons and HUD faces are packed into the sprite atlas
+ * (atlas.h); full-screen images stay separate textures. */
+extern SpriteHandle sprKey;
 
 /* UI */
 extern SDL_Texture *texMenu;
@@ -25,58 +29,95 @@ extern SDL_Texture *texCutscene[9]; /* 1..8 used */
 extern SDL_Texture *texEnding;
 
 /* Items */
-extern SDL_Texture *texAmmo;
-extern SDL_Texture *texMedkit;
-extern SDL_Texture *texShotgunItem;
-extern SDL_Texture *texSMGItem;
-extern SDL_Texture *texShells;
-extern SDL_Texture *texEnergy;
-extern SDL_Texture *texPlasmaItem;
-extern SDL_Texture *texRRGItem;
+extern SpriteHandle sprAmmo;
+extern SpriteHandle sprMedkit;
+extern SpriteHandle sprShotgunItem;
+extern SpriteHandle sprSMGItem;
+extern SpriteHandle sprShells;
+extern SpriteHandle sprEnergy;
+extern SpriteHandle sprPlasmaItem;
+extern SpriteHandle sprRRGItem;
 
 /* Enemies */
-extern SDL_Texture *texEnemy1;
-extern SDL_Texture *texEnemy1Die;
-extern SDL_Texture *texEnemy1Attack;
+extern SpriteHandle sprEnemy1;
+extern SpriteHandle sprEnemy1Die;
+extern SpriteHandle sprEnemy1Attack;
 
-extern SDL_Texture *texEnemy2;
-extern SDL_Texture *texEnemy2Die;
-extern SDL_Texture *texEnemy2Attack;
+extern SpriteHandle sprEnemy2;
+extern SpriteHandle sprEnemy2Die;
+extern SpriteHandle sprEnemy2Attack;
 
-extern SDL_Texture *texMiniboss1;
-extern SDL_Texture *texMiniboss1Die;
-extern SDL_Texture *texMiniboss1Attack;
+extern SpriteHandle sprMiniboss1;
+extern SpriteHandle sprMiniboss1Die;
+extern SpriteHandle sprMiniboss1Attack;
 
-extern SDL_Texture *texFinalboss;
-extern SDL_Texture *texFinalbossDie;
-extern SDL_Texture *texFinalbossAttack;
+extern SpriteHandle sprFinalboss;
+extern SpriteHandle sprFinalbossDie;
+extern SpriteHandle sprFinalbossAttack;
 
 /* Weapons */
-extern SDL_Texture *texGun;
-extern SDL_Texture *texGunRecoil;
-extern SDL_Texture *texShotgun;
-extern SDL_Texture *texShotgunRecoil;
-extern SDL_Texture *texSMG;
-extern SDL_Texture *texSMGRecoil;
-extern SDL_Texture *texPlasma;
-extern SDL_Texture *texPlasmaRecoil;
-extern SDL_Texture *texRRG;
-extern SDL_Texture *texRRGRecoil;
+extern SpriteHandle sprGun;
+extern SpriteHandle sprGunRecoil;
+extern SpriteHandle sprShotgun;
+extern SpriteHandle sprShotgunRecoil;
+extern SpriteHandle sprSMG;
+extern SpriteHandle sprSMGRecoil;
+extern SpriteHandle sprPlasma;
+extern SpriteHandle sprPlasmaRecoil;
+extern SpriteHandle sprRRG;
+extern SpriteHandle sprRRGRecoil;
 
 /* Player faces */
-extern SDL_Texture *texPlayer;
-extern SDL_Texture *texPlayerDamage;
-extern SDL_Texture *texPlayerDead;
-extern SDL_Texture *texGodmod;
+extern SpriteHandle sprPlayer;
+extern SpriteHandle sprPlayerDamage;
+extern SpriteHandle sprPlayerDead;
+extern SpriteHandle sprGodmod;
 
 void load_textures(SDL_Renderer *r);
 
+/* World renderer selection. RENDER_PATH_SDL draws every column with
+ * SDL_RenderCopy; RENDER_PATH_SOFTWARE rasterizes into a CPU framebuffer
+ * (swrender.c) and uploads it once per frame. */
+typedef enum {
+    RENDER_PATH_SDL = 0,
+    RENDER_PATH_SOFTWARE = 1
+} RenderPath;
+
+void render_set_path(RenderPath p);
+RenderPath render_get_path(void);
+
+/* How far (0..1) past the start of the last simulation step to draw the
+ * player and enemies; the game loop sets it from timestep_alpha(). 1 (the
+ * default) draws the current state. */
+void render_set_alpha(float alpha);
+
+/* Draws the walls, floor and ceiling and records the per-column wall depth
+ * the sprites are clipped against. */
 void draw_world(SDL_Renderer *r);
-void draw_keys(SDL_Renderer *r);
-void draw_enemies(SDL_Renderer *r);
-void draw_items(SDL_Renderer *renderer); /* from items.c, but renderer calls it */
+
+/* Sprite stage: sprites_begin() clears the frame's list, sprites_submit()
+ * adds a billboard of the given size centred on screen column sx, and
+ * sprites_flush() draws the list back to front, hidden wherever the last
+ * draw_world() put a wall closer than the sprite. */
+void sprites_begin(void);
+void sprites_submit(const SpriteHandle *spr, float sx, float depth, float size);
+void sprites_flush(SDL_Renderer *r);
+
+/* Submit and draw keys, items and enemies. */
+void draw_sprites(SDL_Renderer *r);
 void draw_hud(SDL_Renderer *r);
 void draw_gun(SDL_Renderer *r);
 void draw_hitbox(SDL_Renderer *r);
 
+/* Counters accumulated by the render pipeline until render_stats_reset(). */
+typedef struct {
+    Uint32 draw_calls;  /* SDL copies, fills and geometry batches issued */
+    Uint32 rays;        /* world rays cast (one per screen column) */
+    Uint64 world_ticks; /* performance counter ticks spent in draw_world() */
+} RenderStats;
+
+extern RenderStats render_stats;
+
+void render_stats_reset(void);
+
 #endif /* RENDER_H */
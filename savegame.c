@@ -15,6 +15,7 @@
 #endif
 
 #include "savegame.h"
+#include "trace.h"
 
 /* ------------------------------------------------------------------------- */
 /* Paths / directories                                                       */
@@ -218,7 +219,62 @@ int savegame_peek(int slot, SaveMeta *out)
     return 0;
 }
 
-int savegame_write(int slot, const SaveGame *in)
+int savegame_alloc(SaveGame *g, int enemy_count, int item_count)
+{
+    savegame_free(g);
+    if (enemy_count < 0) enemy_count = 0;
+    if (item_count < 0) item_count = 0;
+
+    /* calloc(0) may return NULL; keep at least one entry. */
+    size_t ne = (size_t)(enemy_count > 0 ? enemy_count : 1);
+    size_t ni = (size_t)(item_count > 0 ? item_count : 1);
+
+    g->enemy_x = (float *)calloc(ne, sizeof *g->enemy_x);
+    g->enemy_y = (float *)calloc(ne, sizeof *g->enemy_y);
+    g->enemy_kind = (int *)calloc(ne, sizeof *g->enemy_kind);
+    g->enemy_state = (int *)calloc(ne, sizeof *g->enemy_state);
+    g->enemy_hp = (int *)calloc(ne, sizeof *g->enemy_hp);
+    g->enemy_dying_timer = (float *)calloc(ne, sizeof *g->enemy_dying_timer);
+    g->item_x = (float *)calloc(ni, sizeof *g->item_x);
+    g->item_y = (float *)calloc(ni, sizeof *g->item_y);
+    g->item_type = (int *)calloc(ni, sizeof *g->item_type);
+    g->item_collected = (int *)calloc(ni, sizeof *g->item_collected);
+
+    if (!g->enemy_x || !g->enemy_y || !g->enemy_kind || !g->enemy_state ||
+        !g->enemy_hp || !g->enemy_dying_timer || !g->item_x || !g->item_y ||
+        !g->item_type || !g->item_collected) {
+        savegame_free(g);
+        return -1;
+    }
+
+    g->enemy_count = enemy_count;
+    g->item_count = item_count;
+    return 0;
+}
+
+void savegame_free(SaveGame *g)
+{
+    if (!g) return;
+    free(g->enemy_x);
+    free(g->enemy_y);
+    free(g->enemy_kind);
+    free(g->enemy_state);
+    free(g->enemy_hp);
+    free(g->enemy_dying_timer);
+    free(g->item_x);
+    free(g->item_y);
+    free(g->item_type);
+    free(g->item_collected);
+
+    g->enemy_x = g->enemy_y = g->enemy_dying_timer = NULL;
+    g->enemy_kind = g->enemy_state = g->enemy_hp = NULL;
+    g->item_x = g->item_y = NULL;
+    g->item_type = g->item_collected = NULL;
+    g->enemy_count = 0;
+    g->item_count = 0;
+}
+
+static int write_save(int slot, const SaveGame *in)
 {
     if (!in) return -1;
     if (slot < 1 || slot > 3) return -1;
@@ -255,46 +311,47 @@ int savegame_write(int slot, const SaveGame *in)
 
     fprintf(fp, "  \"sens\": %.6f,\n", in->sensitivity);
 
+    fprintf(fp, "  \"has_entities\": %d,\n", in->has_entities);
     fprintf(fp, "  \"enemy_count\": %d,\n", in->enemy_count);
 
     /* Enemies */
     fprintf(fp, "  \"enemy_x\": [");
-    for (int i = 0; i < in->enemy_count && i < MAX_ENEMIES; i++) {
+    for (int i = 0; i < in->enemy_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%.6f", in->enemy_x[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"enemy_y\": [");
-    for (int i = 0; i < in->enemy_count && i < MAX_ENEMIES; i++) {
+    for (int i = 0; i < in->enemy_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%.6f", in->enemy_y[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"enemy_kind\": [");
-    for (int i = 0; i < in->enemy_count && i < MAX_ENEMIES; i++) {
+    for (int i = 0; i < in->enemy_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%d", in->enemy_kind[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"enemy_state\": [");
-    for (int i = 0; i < in->enemy_count && i < MAX_ENEMIES; i++) {
+    for (int i = 0; i < in->enemy_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%d", in->enemy_state[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"enemy_hp\": [");
-    for (int i = 0; i < in->enemy_count && i < MAX_ENEMIES; i++) {
+    for (int i = 0; i < in->enemy_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%d", in->enemy_hp[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"enemy_dying_timer\": [");
-    for (int i = 0; i < in->enemy_count && i < MAX_ENEMIES; i++) {
+    for (int i = 0; i < in->enemy_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%.6f", in->enemy_dying_timer[i]);
     }
@@ -304,28 +361,28 @@ int savegame_write(int slot, const SaveGame *in)
     fprintf(fp, "  \"item_count\": %d,\n", in->item_count);
 
     fprintf(fp, "  \"item_x\": [");
-    for (int i = 0; i < in->item_count && i < MAX_ITEMS; i++) {
+    for (int i = 0; i < in->item_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%.6f", in->item_x[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"item_y\": [");
-    for (int i = 0; i < in->item_count && i < MAX_ITEMS; i++) {
+    for (int i = 0; i < in->item_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%.6f", in->item_y[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"item_type\": [");
-    for (int i = 0; i < in->item_count && i < MAX_ITEMS; i++) {
+    for (int i = 0; i < in->item_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%d", in->item_type[i]);
     }
     fprintf(fp, "],\n");
 
     fprintf(fp, "  \"item_collected\": [");
-    for (int i = 0; i < in->item_count && i < MAX_ITEMS; i++) {
+    for (int i = 0; i < in->item_count; i++) {
         if (i) fprintf(fp, ", ");
         fprintf(fp, "%d", in->item_collected[i]);
     }
@@ -336,7 +393,7 @@ int savegame_write(int slot, const SaveGame *in)
     return 0;
 }
 
-int savegame_read(int slot, SaveGame *out)
+static int read_save(int slot, SaveGame *out)
 {
     if (!out) return -1;
     memset(out, 0, sizeof *out);
@@ -392,9 +449,22 @@ int savegame_read(int slot, SaveGame *out)
 
     (void)json_get_float(buf, "sens", &out->sensitivity);
 
-    (void)json_get_int(buf, "enemy_count", &out->enemy_count);
-    if (out->enemy_count < 0) out->enemy_count = 0;
-    if (out->enemy_count > MAX_ENEMIES) out->enemy_count = MAX_ENEMIES;
+    int enemy_count = 0, item_count = 0;
+    (void)json_get_int(buf, "enemy_count", &enemy_count);
+    (void)json_get_int(buf, "item_count", &item_count);
+    if (enemy_count < 0) enemy_count = 0;
+    if (enemy_count > SAVEGAME_MAX_ENTITIES) enemy_count = SAVEGAME_MAX_ENTITIES;
+    if (item_count < 0) item_count = 0;
+    if (item_count > SAVEGAME_MAX_ENTITIES) item_count = SAVEGAME_MAX_ENTITIES;
+
+    /* Version 3 saves had no flag; their progress saves list no entities. */
+    if (!json_get_int(buf, "has_entities", &out->has_entities))
+        out->has_entities = (enemy_count > 0 || item_count > 0);
+
+    if (savegame_alloc(out, enemy_count, item_count) != 0) {
+        free(buf);
+        return -1;
+    }
 
     json_parse_float_array(buf, "enemy_x", out->enemy_x, out->enemy_count);
     json_parse_float_array(buf, "enemy_y", out->enemy_y, out->enemy_count);
@@ -408,10 +478,6 @@ int savegame_read(int slot, SaveGame *out)
     json_parse_int_array(buf, "enemy_hp", out->enemy_hp, out->enemy_count);
     json_parse_float_array(buf, "enemy_dying_timer", out->enemy_dying_timer, out->enemy_count);
 
-    (void)json_get_int(buf, "item_count", &out->item_count);
-    if (out->item_count < 0) out->item_count = 0;
-    if (out->item_count > MAX_ITEMS) out->item_count = MAX_ITEMS;
-
     json_parse_float_array(buf, "item_x", out->item_x, out->item_count);
     json_parse_float_array(buf, "item_y", out->item_y, out->item_count);
     json_parse_int_array(buf, "item_type", out->item_type, out->item_count);
@@ -420,3 +486,19 @@ int savegame_read(int slot, SaveGame *out)
     free(buf);
     return 0;
 }
+
+int savegame_write(int slot, const SaveGame *in)
+{
+    trace_begin("savegame_write");
+    int rc = write_save(slot, in);
+    trace_end("savegame_write");
+    return rc;
+}
+
+int savegame_read(int slot, SaveGame *out)
+{
+    trace_begin("savegame_read");
+    int rc = read_save(slot, out);
+    trace_end("savegame_read");
+    return rc;
+}
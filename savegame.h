@@ -2,11 +2,9 @@
 #define SAVEGAME_H
 
 #include <stddef.h>
-#include "enemy.h"
-#include "items.h"
 
 /* Save file version. Increment when new fields are added. */
-#define SAVEGAME_VERSION 3
+#define SAVEGAME_VERSION 4
 
 typedef struct {
     int exists;
@@ -46,25 +44,40 @@ typedef struct {
 
     float sensitivity;
 
-    /* Enemies */
+    /* 0 for progress saves: the level starts from its map's own spawns
+     * and the entity lists below are empty. */
+    int has_entities;
+
+    /* Enemies (enemy_count entries per array) */
     int enemy_count;
-    float enemy_x[MAX_ENEMIES];
-    float enemy_y[MAX_ENEMIES];
-    int enemy_kind[MAX_ENEMIES];
-    int enemy_state[MAX_ENEMIES];
-    int enemy_hp[MAX_ENEMIES];
-    float enemy_dying_timer[MAX_ENEMIES];
-
-    /* Items */
+    float *enemy_x;
+    float *enemy_y;
+    int *enemy_kind;
+    int *enemy_state;
+    int *enemy_hp;
+    float *enemy_dying_timer;
+
+    /* Items (item_count entries per array) */
     int item_count;
-    float item_x[MAX_ITEMS];
-    float item_y[MAX_ITEMS];
-    int item_type[MAX_ITEMS];
-    int item_collected[MAX_ITEMS];
+    float *item_x;
+    float *item_y;
+    int *item_type;
+    int *item_collected;
 } SaveGame;
 
+/* Upper bound on entities per list read from a file. */
+#define SAVEGAME_MAX_ENTITIES (1 << 20)
+
+/* Allocate the entity arrays for the given counts (zero-filled).
+ * Returns 0 on success, -1 if out of memory. */
+int savegame_alloc(SaveGame *g, int enemy_count, int item_count);
+
+/* Free the entity arrays; g can be reused afterwards. */
+void savegame_free(SaveGame *g);
+
 int savegame_path(int slot, char *out, size_t outsz);
 int savegame_write(int slot, const SaveGame *g);
+/* On success the caller owns out's entity arrays (see savegame_free()). */
 int savegame_read(int slot, SaveGame *out);
 int savegame_peek(int slot, SaveMeta *out);
 
@@ -0,0 +1,384 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spatial.h"
+#include "map.h"
+
+typedef struct {
+    int w, h;           /* tiles, copied from the map at reset */
+    int capacity;       /* ids 0..capacity-1 */
+    int *head;          /* first id in each tile, -1 = empty */
+    int *next;          /* next id in the same tile */
+    int *cell;          /* tile of each id, -1 = not indexed */
+    float *x, *y;
+    int *results;       /* query output, capacity entries */
+    Uint32 *seen;       /* per tile: stamp of the last ray query to look */
+    Uint32 stamp;
+} SpatialGrid;
+
+static SpatialGrid grids[SPATIAL_LAYER_COUNT];
+
+/* Half the diagonal of a tile: a circle this big around the tile centre
+ * covers the whole tile. */
+#define TILE_RADIUS 0.7072f
+
+static void grid_free(SpatialGrid *g)
+{
+    free(g->head);
+    free(g->next);
+    free(g->cell);
+    free(g->x);
+    free(g->y);
+    free(g->results);
+    free(g->seen);
+    *g = (SpatialGrid){0};
+}
+
+int spatial_reset(SpatialLayer layer, int capacity)
+{
+    if (layer < 0 || layer >= SPATIAL_LAYER_COUNT) return -1;
+
+    SpatialGrid *g = &grids[layer];
+    grid_free(g);
+
+    int w = worldWidth > 0 ? worldWidth : 1;
+    int h = worldHeight > 0 ? worldHeight : 1;
+    if (capacity < 1) capacity = 1;
+
+    g->head = (int *)malloc((size_t)w * (size_t)h * sizeof *g->head);
+    g->seen = (Uint32 *)calloc((size_t)w * (size_t)h, sizeof *g->seen);
+    if (!g->head || !g->seen) {
+        grid_free(g);
+        return -1;
+    }
+
+    g->w = w;
+    g->h = h;
+    for (int i = 0; i < w * h; i++) g->head[i] = -1;
+
+    if (spatial_reserve(layer, capacity) != 0) {
+        grid_free(g);
+        return -1;
+    }
+    return 0;
+}
+
+/* Resize arr to n entries, or return -1 from the caller and leave it as
+ * it was. */
+#define GROW_ARRAY(arr, n) do {                                        \
+        void *grown_ = realloc((arr), (size_t)(n) * sizeof *(arr));    \
+        if (!grown_) return -1;                                        \
+        (arr) = grown_;                                                \
+    } while (0)
+
+int spatial_reserve(SpatialLayer layer, int capacity)
+{
+    if (layer < 0 || layer >= SPATIAL_LAYER_COUNT) return -1;
+
+    /* A layer without a map has nothing to grow; spatial_reset() sizes it. */
+    SpatialGrid *g = &grids[layer];
+    if (!g->head || capacity <= g->capacity) return 0;
+
+    /* Arrays that did grow stay grown; capacity only moves once all did. */
+    GROW_ARRAY(g->next, capacity);
+    GROW_ARRAY(g->cell, capacity);
+    GROW_ARRAY(g->x, capacity);
+    GROW_ARRAY(g->y, capacity);
+    GROW_ARRAY(g->results, capacity);
+
+    for (int i = g->capacity; i < capacity; i++) g->cell[i] = -1;
+    g->capacity = capacity;
+    return 0;
+}
+
+void spatial_shutdown(void)
+{
+    for (int l = 0; l < SPATIAL_LAYER_COUNT; l++)
+        grid_free(&grids[l]);
+}
+
+static int clampi(int v, int lo, int hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/* Positions off the map are kept in the nearest border tile. */
+static int cell_for(const SpatialGrid *g, float x, float y)
+{
+    int cx = clampi((int)floorf(x), 0, g->w - 1);
+    int cy = clampi((int)floorf(y), 0, g->h - 1);
+    return cy * g->w + cx;
+}
+
+static SpatialGrid *grid_for(SpatialLayer layer, int id)
+{
+    if (layer < 0 || layer >= SPATIAL_LAYER_COUNT) return NULL;
+    SpatialGrid *g = &grids[layer];
+    if (!g->head || id < 0 || id >= g->capacity) return NULL;
+    return g;
+}
+
+static void unlink_id(SpatialGrid *g, int id)
+{
+    int *link = &g->head[g->cell[id]];
+    while (*link != -1 && *link != id)
+        link = &g->next[*link];
+    if (*link == id)
+        *link = g->next[id];
+    g->cell[id] = -1;
+}
+
+static void link_id(SpatialGrid *g, int id, int cell)
+{
+    g->cell[id] = cell;
+    g->next[id] = g->head[cell];
+    g->head[cell] = id;
+}
+
+void spatial_insert(SpatialLayer layer, int id, float x, float y)
+{
+    SpatialGrid *g = grid_for(layer, id);
+    if (!g) return;
+
+    if (g->cell[id] != -1) unlink_id(g, id);
+    g->x[id] = x;
+    g->y[id] = y;
+    link_id(g, id, cell_for(g, x, y));
+}
+
+void spatial_move(SpatialLayer layer, int id, float x, float y)
+{
+    SpatialGrid *g = grid_for(layer, id);
+    if (!g || g->cell[id] == -1) return;
+
+    g->x[id] = x;
+    g->y[id] = y;
+
+    int cell = cell_for(g, x, y);
+    if (cell != g->cell[id]) {
+        unlink_id(g, id);
+        link_id(g, id, cell);
+    }
+}
+
+void spatial_remove(SpatialLayer layer, int id)
+{
+    SpatialGrid *g = grid_for(layer, id);
+    if (!g || g->cell[id] == -1) return;
+    unlink_id(g, id);
+}
+
+void spatial_swap_remove(SpatialLayer layer, int id, int last)
+{
+    SpatialGrid *g = grid_for(layer, id);
+    if (!g || last < 0 || last >= g->capacity) return;
+
+    if (g->cell[id] != -1) unlink_id(g, id);
+    if (last == id || g->cell[last] == -1) return;
+
+    int cell = g->cell[last];
+    unlink_id(g, last);
+    g->x[id] = g->x[last];
+    g->y[id] = g->y[last];
+    link_id(g, id, cell);
+}
+
+int spatial_query_radius(SpatialLayer layer, float x, float y, float r, int **out)
+{
+    *out = NULL;
+    if (layer < 0 || layer >= SPATIAL_LAYER_COUNT) return 0;
+    const SpatialGrid *g = &grids[layer];
+    if (!g->head || r < 0.0f) return 0;
+
+    int *res = g->results;
+    *out = res;
+
+    int x0 = clampi((int)floorf(x - r), 0, g->w - 1);
+    int x1 = clampi((int)floorf(x + r), 0, g->w - 1);
+    int y0 = clampi((int)floorf(y - r), 0, g->h - 1);
+    int y1 = clampi((int)floorf(y + r), 0, g->h - 1);
+    const float r2 = r * r;
+
+    int n = 0;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (int id = g->head[cy * g->w + cx]; id != -1; id = g->next[id]) {
+                float dx = g->x[id] - x;
+                float dy = g->y[id] - y;
+                if (dx * dx + dy * dy > r2) continue;
+                res[n++] = id;
+            }
+        }
+    }
+    return n;
+}
+
+/* Grow the box [*x0,*x1] x [*y0,*y1] to include (x, y). */
+static void box_add(float *x0, float *y0, float *x1, float *y1, float x, float y)
+{
+    if (x < *x0) *x0 = x;
+    if (x > *x1) *x1 = x;
+    if (y < *y0) *y0 = y;
+    if (y > *y1) *y1 = y;
+}
+
+int spatial_query_cone(SpatialLayer layer, float x, float y, float dirX, float dirY,
+                       float halfAngle, float range, int **out)
+{
+    *out = NULL;
+    if (layer < 0 || layer >= SPATIAL_LAYER_COUNT) return 0;
+    const SpatialGrid *g = &grids[layer];
+    if (!g->head) return 0;
+
+    int *res = g->results;
+    *out = res;
+
+    float len = sqrtf(dirX * dirX + dirY * dirY);
+    if (len <= 0.0f) return 0;
+    dirX /= len;
+    dirY /= len;
+
+    if (halfAngle < 0.0f) halfAngle = 0.0f;
+    if (halfAngle > 1.57f) halfAngle = 1.57f;
+    if (range <= 0.0f) range = (float)(g->w + g->h);
+
+    const float c = cosf(halfAngle), s = sinf(halfAngle);
+    const float cos2 = c * c, tanH = s / c;
+    const float range2 = range * range;
+
+    /* Bounding box of the sector: apex, both edge ends, and the end of any
+     * axis direction that lies inside the cone. */
+    float bx0 = x, by0 = y, bx1 = x, by1 = y;
+    box_add(&bx0, &by0, &bx1, &by1, x + range * (dirX * c - dirY * s), y + range * (dirY * c + dirX * s));
+    box_add(&bx0, &by0, &bx1, &by1, x + range * (dirX * c + dirY * s), y + range * (dirY * c - dirX * s));
+    if ( dirX >= c) box_add(&bx0, &by0, &bx1, &by1, x + range, y);
+    if (-dirX >= c) box_add(&bx0, &by0, &bx1, &by1, x - range, y);
+    if ( dirY >= c) box_add(&bx0, &by0, &bx1, &by1, x, y + range);
+    if (-dirY >= c) box_add(&bx0, &by0, &bx1, &by1, x, y - range);
+
+    int x0 = clampi((int)floorf(bx0), 0, g->w - 1);
+    int x1 = clampi((int)floorf(bx1), 0, g->w - 1);
+    int y0 = clampi((int)floorf(by0), 0, g->h - 1);
+    int y1 = clampi((int)floorf(by1), 0, g->h - 1);
+
+    /* A tile can only hold hits if its covering circle reaches the cone. */
+    const float tileReach2 = (range + TILE_RADIUS) * (range + TILE_RADIUS);
+
+    int n = 0;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            int id = g->head[cy * g->w + cx];
+            if (id == -1) continue;
+
+            float tx = (float)cx + 0.5f - x;
+            float ty = (float)cy + 0.5f - y;
+            float d2 = tx * tx + ty * ty;
+            if (d2 > tileReach2) continue;
+
+            float along = tx * dirX + ty * dirY;
+            float perp = fabsf(tx * dirY - ty * dirX);
+            if (along <= 0.0f || perp > along * tanH) {
+                /* Outside: distance to the nearer edge ray (or the apex). */
+                float t = along * c + perp * s;
+                float d = (t <= 0.0f) ? sqrtf(d2) : perp * c - along * s;
+                if (d > TILE_RADIUS) continue;
+            }
+
+            for (; id != -1; id = g->next[id]) {
+                float dx = g->x[id] - x;
+                float dy = g->y[id] - y;
+                float e2 = dx * dx + dy * dy;
+                float a = dx * dirX + dy * dirY;
+                if (a <= 0.0f || e2 > range2 || a * a < e2 * cos2) continue;
+                res[n++] = id;
+            }
+        }
+    }
+    return n;
+}
+
+/* 1 if (px, py) is within radius of any of the segments. */
+static int near_rays(float x, float y, const SpatialRay *rays, int n, float r2,
+                     float px, float py)
+{
+    float dx = px - x, dy = py - y;
+    for (int k = 0; k < n; k++) {
+        float t = dx * rays[k].dirX + dy * rays[k].dirY;
+        if (t < 0.0f) t = 0.0f;
+        if (t > rays[k].length) t = rays[k].length;
+        float ex = dx - rays[k].dirX * t;
+        float ey = dy - rays[k].dirY * t;
+        if (ex * ex + ey * ey <= r2) return 1;
+    }
+    return 0;
+}
+
+int spatial_query_rays(SpatialLayer layer, float x, float y, const SpatialRay *rays, int n,
+                       float radius, int **out)
+{
+    *out = NULL;
+    if (layer < 0 || layer >= SPATIAL_LAYER_COUNT) return 0;
+    SpatialGrid *g = &grids[layer];
+    if (!g->head || n <= 0) return 0;
+
+    int *res = g->results;
+    *out = res;
+
+    if (radius < 0.0f) radius = 0.0f;
+    if (radius > 1.0f) radius = 1.0f;
+    const float r2 = radius * radius;
+
+    /* A new stamp marks every tile as not yet looked at. */
+    if (++g->stamp == 0) {
+        memset(g->seen, 0, (size_t)g->w * (size_t)g->h * sizeof *g->seen);
+        g->stamp = 1;
+    }
+
+    int count = 0;
+    for (int k = 0; k < n; k++) {
+        const float dirX = rays[k].dirX, dirY = rays[k].dirY;
+        int mapX = (int)floorf(x), mapY = (int)floorf(y);
+
+        /* Step through the tiles the segment crosses, as the renderer's
+         * rays do. */
+        float deltaX = (dirX == 0.0f) ? 1e30f : fabsf(1.0f / dirX);
+        float deltaY = (dirY == 0.0f) ? 1e30f : fabsf(1.0f / dirY);
+        int stepX = dirX < 0.0f ? -1 : 1;
+        int stepY = dirY < 0.0f ? -1 : 1;
+        float sideX = (dirX < 0.0f ? x - (float)mapX : (float)mapX + 1.0f - x) * deltaX;
+        float sideY = (dirY < 0.0f ? y - (float)mapY : (float)mapY + 1.0f - y) * deltaY;
+
+        for (;;) {
+            /* Anything within radius (at most a tile) of a point in this
+             * tile stands in it or a neighbour. */
+            int x0 = clampi(mapX - 1, 0, g->w - 1), x1 = clampi(mapX + 1, 0, g->w - 1);
+            int y0 = clampi(mapY - 1, 0, g->h - 1), y1 = clampi(mapY + 1, 0, g->h - 1);
+            for (int cy = y0; cy <= y1; cy++) {
+                for (int cx = x0; cx <= x1; cx++) {
+                    int cell = cy * g->w + cx;
+                    if (g->seen[cell] == g->stamp) continue;
+                    g->seen[cell] = g->stamp;
+                    for (int id = g->head[cell]; id != -1; id = g->next[id]) {
+                        if (near_rays(x, y, rays, n, r2, g->x[id], g->y[id]))
+                            res[count++] = id;
+                    }
+                }
+            }
+
+            float t;
+            if (sideX < sideY) {
+                t = sideX;
+                sideX += deltaX;
+                mapX += stepX;
+            } else {
+                t = sideY;
+                sideY += deltaY;
+                mapY += stepY;
+            }
+            if (t > rays[k].length) break;
+            if (mapX < -1 || mapY < -1 || mapX > g->w || mapY > g->h) break;
+        }
+    }
+    return count;
+}
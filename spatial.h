@@ -0,0 +1,66 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+/*
+ * Uniform-grid spatial index.
+ *
+ * Each layer keeps one bucket per map tile holding the ids (array
+ * indices) of the entities standing on it. Owners insert their entities
+ * when a level starts, report moves and remove entities that leave play;
+ * a move only relinks when the entity crosses into another tile.
+ *
+ * Queries visit only the tiles that can overlap the query shape and test
+ * the stored positions exactly, so results do not depend on tile size.
+ * Results come in bucket order, not sorted by distance, in a buffer owned
+ * by the layer that stays valid until its next query or reset; callers may
+ * reorder it.
+ */
+typedef enum {
+    SPATIAL_ENEMIES = 0,
+    SPATIAL_ITEMS,
+    SPATIAL_LAYER_COUNT
+} SpatialLayer;
+
+/* Empty a layer and size it to the current map for ids 0..capacity-1.
+ * Returns 0 on success, -1 if out of memory (the layer is then empty and
+ * queries find nothing). */
+int spatial_reset(SpatialLayer layer, int capacity);
+
+/* Allow ids up to capacity-1 without losing the indexed entries.
+ * Returns 0 on success, -1 if out of memory (the layer is unchanged). */
+int spatial_reserve(SpatialLayer layer, int capacity);
+
+/* Release every layer (called when the map is freed). */
+void spatial_shutdown(void);
+
+void spatial_insert(SpatialLayer layer, int id, float x, float y);
+void spatial_move(SpatialLayer layer, int id, float x, float y);
+void spatial_remove(SpatialLayer layer, int id);
+
+/* Mirror a swap-remove in the owner's arrays: id leaves the index and the
+ * entry indexed as last takes over id. */
+void spatial_swap_remove(SpatialLayer layer, int id, int last);
+
+/* Ids within distance r of (x, y). Points *out at the results and returns
+ * their number. */
+int spatial_query_radius(SpatialLayer layer, float x, float y, float r, int **out);
+
+/* Ids inside the cone from (x, y) along (dirX, dirY) whose angle to the
+ * direction is at most halfAngle (radians, below pi/2). range <= 0 means
+ * no distance limit. */
+int spatial_query_cone(SpatialLayer layer, float x, float y, float dirX, float dirY,
+                       float halfAngle, float range, int **out);
+
+/* A segment from the query point: unit direction and length in tiles. */
+typedef struct {
+    float dirX, dirY;
+    float length;
+} SpatialRay;
+
+/* Ids within radius (at most one tile) of any of the n segments from
+ * (x, y), each once. Only the tiles the segments cross and their
+ * neighbours are visited, so the cost follows the segments' length. */
+int spatial_query_rays(SpatialLayer layer, float x, float y, const SpatialRay *rays, int n,
+                       float radius, int **out);
+
+#endif /* SPATIAL_H */
@@ -0,0 +1,614 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "swrender.h"
+#include "raycast.h"
+#include "tiles.h"
+#include "render.h"
+#include "mipmap.h"
+#include "trace.h"
+
+/* x86 SIMD kernels are compiled with per-function target attributes so the
+ * rest of the game keeps the baseline instruction set; the widest kernel the
+ * CPU supports is picked at runtime. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SWR_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* ------------------------------------------------------------
+ * CPU texture copies
+ *
+ * Every registered texture keeps its whole mip chain; the column and row
+ * fills below only ever see one level.
+ * ------------------------------------------------------------ */
+typedef struct {
+    int w, h;
+    Uint32 *pixels;     /* ARGB8888, row-major */
+} SwTexture;
+
+typedef struct {
+    SDL_Texture *key;   /* texture this copy belongs to */
+    int levels;
+    SwTexture mip[MIP_MAX_LEVELS];
+} SwMipChain;
+
+#define SWR_MAX_TEXTURES 32
+
+static SwMipChain sw_textures[SWR_MAX_TEXTURES];
+static int sw_texture_count = 0;
+
+/* Framebuffer and the streaming texture it is uploaded through. */
+static Uint32 framebuffer[W * H];
+static SDL_Texture *fb_tex = NULL;
+static SDL_Renderer *fb_owner = NULL;
+
+#define FB_BLACK 0xFF000000u
+
+static SwrFloorMode floor_mode = SWR_FLOOR_CAST;
+
+/* Everything a band needs to draw its part of the frame. Written by the main
+ * thread before the workers are released and only read while they run. */
+typedef struct {
+    RayView view;
+    const SwMipChain *walls[WALL_TEX_COUNT];
+    const SwMipChain *floorTex;
+    const SwMipChain *ceilTex;
+    float *zbuf;
+    int stretch;
+} FrameJob;
+
+static FrameJob frame_job;
+
+/* Column band workers. Band 0 is always drawn by the calling thread, band
+ * i > 0 by workers[i - 1]. */
+#define SWR_MAX_THREADS 64
+
+typedef struct {
+    SDL_Thread *thread;
+    SDL_sem *go;
+    int x0, x1;
+} BandWorker;
+
+static BandWorker workers[SWR_MAX_THREADS - 1];
+static int worker_count = 0;
+static int pool_target = 0;     /* workers last asked for; may exceed worker_count */
+static SDL_sem *band_done = NULL;
+static SDL_atomic_t pool_quit;
+
+static int thread_setting = 0; /* requested thread count, 0 = one per CPU */
+
+/* Copy an ARGB8888 surface into a tightly packed level. */
+static int copy_level(SwTexture *lvl, SDL_Surface *s)
+{
+    Uint32 *pixels = (Uint32 *)malloc((size_t)s->w * (size_t)s->h * sizeof(Uint32));
+    if (!pixels) return -1;
+
+    SDL_LockSurface(s);
+    for (int y = 0; y < s->h; y++) {
+        memcpy(pixels + (size_t)y * (size_t)s->w,
+               (const Uint8 *)s->pixels + (size_t)y * (size_t)s->pitch,
+               (size_t)s->w * sizeof(Uint32));
+    }
+    SDL_UnlockSurface(s);
+
+    lvl->w = s->w;
+    lvl->h = s->h;
+    lvl->pixels = pixels;
+    return 0;
+}
+
+void swr_register_texture(SDL_Texture *t, SDL_Surface *s)
+{
+    if (!t || !s) return;
+    if (sw_texture_count >= SWR_MAX_TEXTURES) {
+        fprintf(stderr, "SWRENDER: too many world textures\n");
+        return;
+    }
+
+    SDL_Surface *conv = SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (!conv) return;
+
+    SwMipChain *mc = &sw_textures[sw_texture_count];
+    mc->levels = 0;
+    while (conv && mc->levels < MIP_MAX_LEVELS) {
+        if (copy_level(&mc->mip[mc->levels], conv) != 0) break;
+        mc->levels++;
+
+        SDL_Surface *next = mip_downsample(conv);
+        SDL_FreeSurface(conv);
+        conv = next;
+    }
+    SDL_FreeSurface(conv);
+
+    if (mc->levels == 0) return;
+    mc->key = t;
+    sw_texture_count++;
+}
+
+static const SwMipChain *find_texture(SDL_Texture *t)
+{
+    if (!t) return NULL;
+    for (int i = 0; i < sw_texture_count; i++) {
+        if (sw_textures[i].key == t)
+            return &sw_textures[i];
+    }
+    return NULL;
+}
+
+static int ensure_framebuffer(SDL_Renderer *r)
+{
+    if (fb_tex && fb_owner == r)
+        return 0;
+
+    if (fb_tex) {
+        SDL_DestroyTexture(fb_tex);
+        fb_tex = NULL;
+    }
+
+    fb_tex = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, W, H);
+    if (!fb_tex) {
+        fprintf(stderr, "SWRENDER: SDL_CreateTexture failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    fb_owner = r;
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Column fill
+ * ------------------------------------------------------------ */
+
+/* Stretch texture column texX over framebuffer rows [y0, y1) of column sx.
+ * This matches what SDL_RenderCopy does for a 1-pixel wide destination. */
+static void fill_column(int sx, int y0, int y1, const SwTexture *t, int texX)
+{
+    int n = y1 - y0;
+    if (n <= 0) return;
+
+    Uint32 *dst = framebuffer + (size_t)y0 * W + sx;
+
+    if (!t) {
+        for (int i = 0; i < n; i++, dst += W)
+            *dst = FB_BLACK;
+        return;
+    }
+
+    const Uint32 *src = t->pixels + texX;
+    /* 16.16 fixed-point source row stepping. */
+    Uint32 step = ((Uint32)t->h << 16) / (Uint32)n;
+    Uint32 pos = 0;
+    for (int i = 0; i < n; i++, dst += W) {
+        *dst = src[(size_t)(pos >> 16) * (size_t)t->w];
+        pos += step;
+    }
+}
+
+/* ------------------------------------------------------------
+ * Floor / ceiling casting
+ *
+ * Every row below the horizon sees the floor at a single distance, so the
+ * texture coordinates step linearly across the row. World coordinates are
+ * stepped in 16.16 fixed point; the fractional part selects the texel
+ * (tx = frac * texW >> 16), which also works for textures that are not a
+ * power of two wide (the EP2/EP3 sets are 15x16). The ceiling row mirrored
+ * about the horizon sees the same world point.
+ * ------------------------------------------------------------ */
+typedef void (*FloorRowFn)(Uint32 *dst, int n, Uint32 u, Uint32 v,
+                           Uint32 du, Uint32 dv, const SwTexture *t);
+
+static void floor_row_scalar(Uint32 *dst, int n, Uint32 u, Uint32 v,
+                             Uint32 du, Uint32 dv, const SwTexture *t)
+{
+    const Uint32 tw = (Uint32)t->w;
+    const Uint32 th = (Uint32)t->h;
+    const Uint32 *px_ = t->pixels;
+
+    for (int i = 0; i < n; i++) {
+        Uint32 tx = ((u & 0xFFFFu) * tw) >> 16;
+        Uint32 ty = ((v & 0xFFFFu) * th) >> 16;
+        dst[i] = px_[ty * tw + tx];
+        u += du;
+        v += dv;
+    }
+}
+
+#ifdef SWR_X86_SIMD
+/* The SIMD kernels compute texel indices in 16-bit lanes, so they are only
+ * used for textures with fewer than 65536 texels. */
+__attribute__((target("sse2")))
+static void floor_row_sse2(Uint32 *dst, int n, Uint32 u, Uint32 v,
+                           Uint32 du, Uint32 dv, const SwTexture *t)
+{
+    const Uint32 *px_ = t->pixels;
+    const __m128i lo16 = _mm_set1_epi32(0xFFFF);
+    const __m128i vw = _mm_set1_epi32(t->w);
+    const __m128i vh = _mm_set1_epi32(t->h);
+    const __m128i stepU = _mm_set1_epi32((int)(du * 4u));
+    const __m128i stepV = _mm_set1_epi32((int)(dv * 4u));
+    __m128i vu = _mm_setr_epi32((int)u, (int)(u + du), (int)(u + du * 2u), (int)(u + du * 3u));
+    __m128i vv = _mm_setr_epi32((int)v, (int)(v + dv), (int)(v + dv * 2u), (int)(v + dv * 3u));
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i tx = _mm_mulhi_epu16(_mm_and_si128(vu, lo16), vw);
+        __m128i ty = _mm_mulhi_epu16(_mm_and_si128(vv, lo16), vh);
+        __m128i idx = _mm_add_epi16(_mm_mullo_epi16(ty, vw), tx);
+
+        Uint32 lane[4];
+        _mm_storeu_si128((__m128i *)lane, idx);
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_setr_epi32((int)px_[lane[0]], (int)px_[lane[1]],
+                                        (int)px_[lane[2]], (int)px_[lane[3]]));
+
+        vu = _mm_add_epi32(vu, stepU);
+        vv = _mm_add_epi32(vv, stepV);
+    }
+
+    if (i < n)
+        floor_row_scalar(dst + i, n - i, u + du * (Uint32)i, v + dv * (Uint32)i, du, dv, t);
+}
+
+__attribute__((target("avx2")))
+static void floor_row_avx2(Uint32 *dst, int n, Uint32 u, Uint32 v,
+                           Uint32 du, Uint32 dv, const SwTexture *t)
+{
+    const __m256i lo16 = _mm256_set1_epi32(0xFFFF);
+    const __m256i vw = _mm256_set1_epi32(t->w);
+    const __m256i vh = _mm256_set1_epi32(t->h);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i stepU = _mm256_set1_epi32((int)(du * 8u));
+    const __m256i stepV = _mm256_set1_epi32((int)(dv * 8u));
+    __m256i vu = _mm256_add_epi32(_mm256_set1_epi32((int)u), _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)du)));
+    __m256i vv = _mm256_add_epi32(_mm256_set1_epi32((int)v), _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)dv)));
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i tx = _mm256_mulhi_epu16(_mm256_and_si256(vu, lo16), vw);
+        __m256i ty = _mm256_mulhi_epu16(_mm256_and_si256(vv, lo16), vh);
+        __m256i idx = _mm256_add_epi16(_mm256_mullo_epi16(ty, vw), tx);
+
+        __m256i texel = _mm256_i32gather_epi32((const int *)t->pixels, idx, 4);
+        _mm256_storeu_si256((__m256i *)(dst + i), texel);
+
+        vu = _mm256_add_epi32(vu, stepU);
+        vv = _mm256_add_epi32(vv, stepV);
+    }
+
+    if (i < n)
+        floor_row_scalar(dst + i, n - i, u + du * (Uint32)i, v + dv * (Uint32)i, du, dv, t);
+}
+#endif /* SWR_X86_SIMD */
+
+static FloorRowFn floor_row_wide = NULL;
+static const char *floor_kernel = NULL;
+
+static void select_floor_kernel(void)
+{
+    if (floor_row_wide) return;
+
+    floor_row_wide = floor_row_scalar;
+    floor_kernel = "SCALAR";
+#ifdef SWR_X86_SIMD
+    if (SDL_HasAVX2()) {
+        floor_row_wide = floor_row_avx2;
+        floor_kernel = "AVX2";
+    } else if (SDL_HasSSE2()) {
+        floor_row_wide = floor_row_sse2;
+        floor_kernel = "SSE2";
+    }
+#endif
+}
+
+static void floor_row(Uint32 *dst, int n, Uint32 u, Uint32 v,
+                      Uint32 du, Uint32 dv, const SwTexture *t)
+{
+    if (!t) {
+        for (int i = 0; i < n; i++)
+            dst[i] = FB_BLACK;
+        return;
+    }
+    if ((size_t)t->w * (size_t)t->h > 0xFFFFu) {
+        floor_row_scalar(dst, n, u, v, du, dv, t);
+        return;
+    }
+    floor_row_wide(dst, n, u, v, du, dv, t);
+}
+
+static Uint32 to_fixed(float f)
+{
+    return (Uint32)(Sint32)(f * 65536.0f);
+}
+
+/* Level of chain mc whose texels are about one pixel when a pixel covers
+ * footprint texels of level 0. NULL chain gives NULL. */
+static const SwTexture *pick_level(const SwMipChain *mc, float footprint)
+{
+    if (!mc) return NULL;
+    return &mc->mip[mip_level_for(footprint, mc->levels)];
+}
+
+/* Largest dimension of level 0, for footprints measured in tiles. */
+static int chain_size(const SwMipChain *mc)
+{
+    if (!mc) return 0;
+    return mc->mip[0].w > mc->mip[0].h ? mc->mip[0].w : mc->mip[0].h;
+}
+
+/* Fill floor and ceiling rows for columns [x0, x1). Each band starts its
+ * rows at u + x0 * du, which is exactly where a full-width row would be
+ * after x0 steps, so banded and full-width output are identical. */
+static void cast_floor_rows(const FrameJob *job, int x0, int x1)
+{
+    const RayView *view = &job->view;
+    const float px = view->px;
+    const float py = view->py;
+
+    /* Interpolate between the two edge rays of the camera plane (the same
+     * rays the wall columns use); each pixel's world point is then
+     * pos + rowDist * dir. */
+    const float d0x = view->dirX - view->planeX;
+    const float d0y = view->dirY - view->planeY;
+    const float d1x = view->dirX + view->planeX;
+    const float d1y = view->dirY + view->planeY;
+    const float planeLen = sqrtf(view->planeX * view->planeX + view->planeY * view->planeY);
+    const int floorSize = chain_size(job->floorTex);
+    const int ceilSize = chain_size(job->ceilTex);
+
+    for (int y = H / 2; y < H; y++) {
+        /* Camera height is half a wall (walls are 240 px tall at distance 1). */
+        float p = (float)(y - H / 2) + 0.5f;
+        float rowDist = 120.0f / p;
+
+        Uint32 u = to_fixed(px + rowDist * d0x);
+        Uint32 v = to_fixed(py + rowDist * d0y);
+        Uint32 du = to_fixed(rowDist * (d1x - d0x) / (float)W);
+        Uint32 dv = to_fixed(rowDist * (d1y - d0y) / (float)W);
+
+        u += du * (Uint32)x0;
+        v += dv * (Uint32)x0;
+
+        /* World distance one pixel spans: across the row, and in depth
+         * towards the next row (which dominates near the horizon). The
+         * level depends only on the row, so bands agree. */
+        float across = rowDist * 2.0f * planeLen / (float)W;
+        float along = rowDist - 120.0f / (p + 1.0f);
+        float span = across > along ? across : along;
+
+        floor_row(framebuffer + (size_t)y * W + x0, x1 - x0, u, v, du, dv,
+                  pick_level(job->floorTex, span * (float)floorSize));
+        floor_row(framebuffer + (size_t)(H - 1 - y) * W + x0, x1 - x0, u, v, du, dv,
+                  pick_level(job->ceilTex, span * (float)ceilSize));
+    }
+}
+
+#define SWR_RAY_CHUNK 64
+
+static void draw_band(const FrameJob *job, int x0, int x1)
+{
+    /* Stretched floor and ceiling stripes are never minified much; they
+     * keep the full-size level like the SDL path. */
+    const SwTexture *tFloor = pick_level(job->floorTex, 0.0f);
+    const SwTexture *tCeil = pick_level(job->ceilTex, 0.0f);
+
+    /* SDL samples the middle source column when squeezing a texture into a
+     * 1-pixel wide stripe; do the same for the floor and ceiling. */
+    int floorX = tFloor ? tFloor->w / 2 : 0;
+    int ceilX  = tCeil ? tCeil->w / 2 : 0;
+
+    /* Cast mode fills every floor/ceiling row first; walls are drawn over it. */
+    int stretch = job->stretch;
+    if (!stretch)
+        cast_floor_rows(job, x0, x1);
+
+    RayHit hits[SWR_RAY_CHUNK];
+    for (int sx = x0; sx < x1; sx++) {
+        /* Trace rays a chunk at a time so the packet kernels see full packets. */
+        int k = (sx - x0) % SWR_RAY_CHUNK;
+        if (k == 0) {
+            int n = x1 - sx;
+            raycast_columns(&job->view, sx, n < SWR_RAY_CHUNK ? n : SWR_RAY_CHUNK, hits);
+        }
+        const RayHit hit = hits[k];
+
+        if (!raycast_hit_is_wall(&hit)) {
+            job->zbuf[sx] = 1e30f;
+            if (stretch) {
+                int half = H / 2;
+                fill_column(sx, 0, half, tCeil, ceilX);
+                fill_column(sx, half, H, tFloor, floorX);
+            }
+            continue;
+        }
+
+        job->zbuf[sx] = hit.perpWallDist;
+
+        float h = 240.0f / hit.perpWallDist;
+        int y1 = (int)(H / 2 - h / 2);
+        int y2 = (int)(H / 2 + h / 2);
+        if (y1 < 0) y1 = 0;
+        if (y2 > H) y2 = H;
+
+        if (stretch) {
+            fill_column(sx, 0, y1, tCeil, ceilX);
+            fill_column(sx, y2, H, tFloor, floorX);
+        }
+
+        /* Minify by how many texel rows fall on each pixel of the stripe. */
+        const SwMipChain *mc = job->walls[tile_info[hit.tile].wall_tex];
+        const SwTexture *T = mc ? pick_level(mc, (float)mc->mip[0].h / h) : NULL;
+        fill_column(sx, y1, y2, T, T ? raycast_tex_x(&hit, T->w) : 0);
+    }
+}
+
+/* ------------------------------------------------------------
+ * Band worker pool
+ *
+ * Every column only writes its own framebuffer pixels, so the screen is
+ * split into vertical bands that are drawn in parallel. Workers sleep on
+ * their own semaphore and signal band_done when their band is finished;
+ * the semaphores also order the frame_job writes against the workers'
+ * reads.
+ * ------------------------------------------------------------ */
+static int band_worker_main(void *arg)
+{
+    BandWorker *bw = (BandWorker *)arg;
+    trace_set_thread_name("swr_band");
+    for (;;) {
+        SDL_SemWait(bw->go);
+        if (SDL_AtomicGet(&pool_quit))
+            break;
+        TRACE_SCOPE("swr_band", draw_band(&frame_job, bw->x0, bw->x1));
+        SDL_SemPost(band_done);
+    }
+    return 0;
+}
+
+static int resolve_thread_count(void)
+{
+    int n = thread_setting > 0 ? thread_setting : SDL_GetCPUCount();
+    if (n < 1) n = 1;
+    if (n > SWR_MAX_THREADS) n = SWR_MAX_THREADS;
+    return n;
+}
+
+static void stop_workers(void)
+{
+    pool_target = 0;
+    if (worker_count == 0) return;
+
+    SDL_AtomicSet(&pool_quit, 1);
+    for (int i = 0; i < worker_count; i++)
+        SDL_SemPost(workers[i].go);
+    for (int i = 0; i < worker_count; i++) {
+        SDL_WaitThread(workers[i].thread, NULL);
+        SDL_DestroySemaphore(workers[i].go);
+        workers[i].thread = NULL;
+        workers[i].go = NULL;
+    }
+    worker_count = 0;
+
+    SDL_DestroySemaphore(band_done);
+    band_done = NULL;
+}
+
+/* Make sure the pool matches the requested thread count. If threads cannot
+ * be created the frame is drawn with the bands that could be started, and
+ * no new attempt is made until the requested count changes. */
+static void ensure_workers(void)
+{
+    int want = resolve_thread_count() - 1;
+    if (want == pool_target) return;
+
+    stop_workers();
+    pool_target = want;
+    if (want == 0) return;
+
+    band_done = SDL_CreateSemaphore(0);
+    if (!band_done) {
+        fprintf(stderr, "SWRENDER: SDL_CreateSemaphore failed: %s\n", SDL_GetError());
+        return;
+    }
+    SDL_AtomicSet(&pool_quit, 0);
+
+    for (int i = 0; i < want; i++) {
+        BandWorker *bw = &workers[worker_count];
+        bw->go = SDL_CreateSemaphore(0);
+        if (!bw->go) break;
+        bw->thread = SDL_CreateThread(band_worker_main, "swr_band", bw);
+        if (!bw->thread) {
+            fprintf(stderr, "SWRENDER: SDL_CreateThread failed: %s\n", SDL_GetError());
+            SDL_DestroySemaphore(bw->go);
+            bw->go = NULL;
+            break;
+        }
+        worker_count++;
+    }
+
+    if (worker_count == 0) {
+        SDL_DestroySemaphore(band_done);
+        band_done = NULL;
+    }
+}
+
+void swr_set_thread_count(int n)
+{
+    thread_setting = (n < 0) ? 0 : n;
+}
+
+int swr_get_thread_count(void)
+{
+    return worker_count + 1;
+}
+
+void swr_shutdown(void)
+{
+    stop_workers();
+    if (fb_tex) {
+        SDL_DestroyTexture(fb_tex);
+        fb_tex = NULL;
+    }
+    fb_owner = NULL;
+}
+
+void swr_set_floor_mode(SwrFloorMode m)
+{
+    floor_mode = (m == SWR_FLOOR_STRETCH) ? SWR_FLOOR_STRETCH : SWR_FLOOR_CAST;
+}
+
+SwrFloorMode swr_get_floor_mode(void)
+{
+    return floor_mode;
+}
+
+const char *swr_floor_kernel_name(void)
+{
+    select_floor_kernel();
+    return floor_kernel;
+}
+
+int swr_draw_world(SDL_Renderer *r, const RayView *view, const SwrWorldTextures *tex, float *zbuf)
+{
+    if (!r || !view || !tex || !zbuf) return -1;
+    if (ensure_framebuffer(r) != 0) return -1;
+
+    select_floor_kernel();
+    ensure_workers();
+
+    frame_job.view = *view;
+    for (int i = 0; i < WALL_TEX_COUNT; i++)
+        frame_job.walls[i] = find_texture(tex->walls[i]);
+    frame_job.floorTex = find_texture(tex->floorTex);
+    frame_job.ceilTex = find_texture(tex->ceilTex);
+    frame_job.zbuf = zbuf;
+    frame_job.stretch = (floor_mode == SWR_FLOOR_STRETCH);
+
+    int bands = worker_count + 1;
+    for (int i = 0; i < worker_count; i++) {
+        workers[i].x0 = W * (i + 1) / bands;
+        workers[i].x1 = W * (i + 2) / bands;
+        SDL_SemPost(workers[i].go);
+    }
+    TRACE_SCOPE("swr_band", draw_band(&frame_job, 0, W / bands));
+    for (int i = 0; i < worker_count; i++)
+        SDL_SemWait(band_done);
+
+    void *pixels = NULL;
+    int pitch = 0;
+    if (SDL_LockTexture(fb_tex, NULL, &pixels, &pitch) != 0) {
+        fprintf(stderr, "SWRENDER: SDL_LockTexture failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    for (int y = 0; y < H; y++) {
+        memcpy((Uint8 *)pixels + (size_t)y * (size_t)pitch,
+               framebuffer + (size_t)y * W, W * sizeof(Uint32));
+    }
+    SDL_UnlockTexture(fb_tex);
+
+    SDL_RenderCopy(r, fb_tex, NULL, &(SDL_Rect){0, 0, W, H});
+    render_stats.draw_calls++;
+    return 0;
+}
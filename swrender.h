@@ -0,0 +1,67 @@
+#ifndef SWRENDER_H
+#define SWRENDER_H
+
+#include <SDL2/SDL.h>
+
+#include "raycast.h"
+#include "tiles.h"
+
+/*
+ * Software world renderer.
+ *
+ * Instead of issuing one SDL_RenderCopy per column for the ceiling, floor and
+ * wall stripe, every column is written into a CPU-side ARGB8888 framebuffer
+ * which is uploaded once per frame through a streaming texture.
+ *
+ * The rays come from raycast.c, so the output matches the SDL path in
+ * render.c. Texel data is captured at load time: render.c registers the
+ * surface of every world texture with swr_register_texture() before freeing
+ * it.
+ *
+ * The frame is split into vertical column bands drawn in parallel by a small
+ * pool of SDL threads; every band traces from the same RayView snapshot, so
+ * the result does not depend on the thread count.
+ */
+
+/* Episode texture set used for one frame. */
+typedef struct {
+    SDL_Texture *walls[WALL_TEX_COUNT];  /* by TileInfo.wall_tex */
+    SDL_Texture *floorTex;
+    SDL_Texture *ceilTex;
+} SwrWorldTextures;
+
+/* How the software path draws floor and ceiling.
+ * SWR_FLOOR_STRETCH reproduces the SDL path (whole texture squeezed into each
+ * column); SWR_FLOOR_CAST does perspective-correct per-row floor casting. */
+typedef enum {
+    SWR_FLOOR_STRETCH = 0,
+    SWR_FLOOR_CAST = 1
+} SwrFloorMode;
+
+void swr_set_floor_mode(SwrFloorMode m);
+SwrFloorMode swr_get_floor_mode(void);
+
+/* Name of the row kernel picked for this CPU ("AVX2", "SSE2" or "SCALAR"). */
+const char *swr_floor_kernel_name(void);
+
+/* Number of threads drawing the frame (including the caller); 0 picks one
+ * per CPU. Takes effect on the next frame. */
+void swr_set_thread_count(int n);
+
+/* Threads used for the last frame. */
+int swr_get_thread_count(void);
+
+/* Stop the worker threads and release the framebuffer texture. */
+void swr_shutdown(void);
+
+/* Keep a CPU copy of the surface that was used to create texture t, along
+ * with its mip chain for minified walls and floor rows. */
+void swr_register_texture(SDL_Texture *t, SDL_Surface *s);
+
+/* Draw the world into the framebuffer and copy it to the renderer. The wall
+ * depth of every column is written to zbuf[0 .. W - 1] (1e30 where no wall
+ * was hit). Returns 0 on success, -1 if the streaming texture is unavailable
+ * (the caller should then fall back to the SDL path). */
+int swr_draw_world(SDL_Renderer *r, const RayView *view, const SwrWorldTextures *tex, float *zbuf);
+
+#endif /* SWRENDER_H */
@@ -0,0 +1,49 @@
+#include "tiles.h"
+#include "enemy.h"
+
+TileInfo tile_info[TILE_IDS];
+
+#define WALL (TILE_SOLID | TILE_OPAQUE)
+
+/* Ids first..last share one definition. Later entries win. */
+typedef struct {
+    int first, last;
+    Uint8 flags;
+    Uint8 wall_tex;
+    Sint8 spawn;
+} TileDef;
+
+static const TileDef tile_defs[] = {
+    /* Ids with no definition of their own are kept for new content and
+     * read as plain walls until they get one. */
+    {  2, TILE_IDS - 1, WALL, WALL_TEX_WALL1, -1 },
+
+    {  0,  0, 0, 0, -1 },                                   /* floor */
+    {  1,  1, TILE_KEY, 0, -1 },
+    {  3,  3, WALL | TILE_DOOR, WALL_TEX_DOOR, -1 },
+    {  4,  4, WALL, WALL_TEX_WALL2, -1 },
+    {  5,  7, TILE_PICKUP, 0, -1 },                         /* bullets, medkit, shotgun */
+    {  8,  8, TILE_START, 0, -1 },
+    {  9,  9, TILE_SPAWN, 0, ENEMY_KIND1 },
+    { 10, 10, TILE_SPAWN, 0, ENEMY_KIND2 },
+    { 11, 11, TILE_PICKUP, 0, -1 },                         /* SMG */
+    { 12, 12, TILE_SPAWN, 0, ENEMY_MINIBOSS1 },
+    { 13, 13, TILE_SPAWN, 0, ENEMY_FINALBOSS },
+    { 14, 17, TILE_PICKUP, 0, -1 },                         /* shells, energy, plasma, RRG */
+};
+
+void tiles_init(void)
+{
+    static int done = 0;
+    if (done) return;
+
+    for (size_t i = 0; i < sizeof tile_defs / sizeof tile_defs[0]; i++) {
+        const TileDef *d = &tile_defs[i];
+        for (int t = d->first; t <= d->last; t++) {
+            tile_info[t].flags = d->flags;
+            tile_info[t].wall_tex = d->wall_tex;
+            tile_info[t].spawn = d->spawn;
+        }
+    }
+    done = 1;
+}
@@ -0,0 +1,56 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Tile registry.
+ *
+ * What each tile id in a map (see map.h for the list) is: a set of
+ * property flags, the texture it is drawn with if it is a wall, and the
+ * enemy it spawns if it is a spawn point. The definitions in tiles.c are
+ * compiled once into tile_info[], indexed by id, so code that looks at a
+ * tile does one lookup and one bit test instead of comparing ids. A new
+ * kind of wall only needs a definition (and its texture); the renderers
+ * pick the texture from tile_info[].
+ */
+
+/* Ids the map format allows (0..99). */
+#define TILE_IDS 100
+
+/* Property flags. */
+#define TILE_SOLID   0x01   /* blocks the player, enemies and paths */
+#define TILE_OPAQUE  0x02   /* stops rays, shots and sight; drawn as a wall */
+#define TILE_DOOR    0x04   /* exit door, opened with the key */
+#define TILE_KEY     0x08   /* key, picked up with E */
+#define TILE_PICKUP  0x10   /* item spawn; the id is its ItemType */
+#define TILE_SPAWN   0x20   /* enemy spawn; see TileInfo.spawn */
+#define TILE_START   0x40   /* player spawn */
+
+/* Wall textures, per episode. */
+typedef enum {
+    WALL_TEX_WALL1 = 0,
+    WALL_TEX_WALL2,
+    WALL_TEX_DOOR,
+    WALL_TEX_COUNT
+} WallTex;
+
+typedef struct {
+    Uint8 flags;        /* TILE_* */
+    Uint8 wall_tex;     /* WallTex, for TILE_OPAQUE tiles */
+    Sint8 spawn;        /* EnemyKind, for TILE_SPAWN tiles */
+} TileInfo;
+
+extern TileInfo tile_info[TILE_IDS];
+
+/* Fill in tile_info[] from the definitions (once; the map loader calls it
+ * before reading a map). */
+void tiles_init(void);
+
+/* 1 if tile id t has any of the flags. */
+static inline int tile_is(int t, Uint8 flags)
+{
+    return (tile_info[t].flags & flags) != 0;
+}
+
+#endif /* TILES_H */
@@ -0,0 +1,45 @@
+#include <SDL2/SDL.h>
+
+#include "timestep.h"
+
+static Uint64 step_ticks = 0;     /* performance counter ticks per step */
+static Uint64 last = 0;           /* 0 = start over at the next advance */
+static Uint64 acc = 0;            /* ticks not yet simulated */
+
+void timestep_reset(void)
+{
+    last = 0;
+    acc = 0;
+}
+
+int timestep_advance(void)
+{
+    if (!step_ticks) {
+        step_ticks = SDL_GetPerformanceFrequency() / SIM_HZ;
+        if (!step_ticks) step_ticks = 1;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (last) acc += now - last;
+    last = now;
+
+    int steps = 0;
+    while (acc >= step_ticks && steps < SIM_MAX_STEPS) {
+        acc -= step_ticks;
+        steps++;
+    }
+
+    /* Behind by more than the cap allows: drop the whole steps left. */
+    acc %= step_ticks;
+    return steps;
+}
+
+void timestep_defer(int steps)
+{
+    if (steps > 0) acc += (Uint64)steps * step_ticks;
+}
+
+float timestep_alpha(void)
+{
+    return step_ticks ? (float)((double)acc / (double)step_ticks) : 1.0f;
+}
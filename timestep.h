@@ -0,0 +1,40 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Fixed simulation timestep.
+ *
+ * The game state advances in steps of exactly SIM_DT seconds, however fast
+ * frames are drawn. Frame time measured on the performance counter goes
+ * into an accumulator, and each frame runs as many steps as it holds. At
+ * most SIM_MAX_STEPS run per frame; after a longer stall the extra time is
+ * dropped, so the game slows down instead of taking one huge step in which
+ * enemies could pass through walls. What is left in the accumulator (less
+ * than one step) gives the fraction used to draw moving things between
+ * their last two simulated positions.
+ */
+
+#define SIM_HZ 120
+#define SIM_DT (1.0f / (float)SIM_HZ)
+
+/* Steps run per frame at most (1/15 s of game time). */
+#define SIM_MAX_STEPS 8
+
+/* Start counting from now with an empty accumulator (after loading, a
+ * pause, or any time the game was not running). */
+void timestep_reset(void);
+
+/* Add the time since the last call and take out the steps that are due.
+ * Returns how many steps to run now (0..SIM_MAX_STEPS). */
+int timestep_advance(void);
+
+/* Put steps taken out by timestep_advance() back, to run on a later
+ * frame instead. */
+void timestep_defer(int steps);
+
+/* Fraction of a step left in the accumulator, 0..1. */
+float timestep_alpha(void);
+
+#endif /* TIMESTEP_H */
@@ -0,0 +1,246 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+/* Threads beyond this many are not traced. Buffers stay allocated after
+ * their thread exits, since a capture may still need them. */
+#define TRACE_MAX_THREADS 96
+#define TRACE_DETAIL 32
+
+typedef struct {
+    const char *name;
+    Uint64 ts;                  /* performance counter */
+    char phase;                 /* 'B' or 'E' */
+    char detail[TRACE_DETAIL];
+} TraceEvent;
+
+/* Written only by its own thread. head counts events recorded in the
+ * current capture and is published after the event is complete, so the
+ * writer needs no lock. busy is set while an event is being written;
+ * trace_finish() waits for it to clear before reading the ring. */
+struct TraceBuffer {
+    SDL_threadID tid;
+    const char *thread_name;
+    int epoch;                  /* capture the events belong to */
+    SDL_atomic_t busy;
+    SDL_atomic_t head;
+    TraceEvent events[TRACE_RING_EVENTS];
+};
+
+SDL_atomic_t trace_on;
+
+static TraceBuffer *buffers[TRACE_MAX_THREADS];
+static SDL_atomic_t buffer_count;
+static SDL_atomic_t capture_epoch;
+
+static SDL_TLSID tls_buffer = 0;
+static SDL_TLSID tls_name = 0;
+
+/* Stored in TLS once a thread has failed to get a buffer. */
+static TraceBuffer no_buffer;
+
+static Uint64 capture_start = 0;
+static Uint32 capture_end = 0;  /* SDL_GetTicks() deadline, 0 = none */
+static char capture_path[512];
+
+void trace_init(void)
+{
+    if (tls_buffer) return;
+    tls_buffer = SDL_TLSCreate();
+    tls_name = SDL_TLSCreate();
+}
+
+void trace_set_thread_name(const char *name)
+{
+    if (!tls_name) return;
+    SDL_TLSSet(tls_name, name, NULL);
+
+    TraceBuffer *b = (TraceBuffer *)SDL_TLSGet(tls_buffer);
+    if (b && b != &no_buffer)
+        b->thread_name = name;
+}
+
+/* A new ring in the next free slot, or NULL. It holds no events until its
+ * thread records one, so trace_finish() skips it until then. */
+static TraceBuffer *new_buffer(const char *name)
+{
+    int slot = SDL_AtomicAdd(&buffer_count, 1);
+    if (slot >= TRACE_MAX_THREADS) return NULL;
+
+    TraceBuffer *b = (TraceBuffer *)calloc(1, sizeof *b);
+    if (!b) return NULL;
+
+    b->thread_name = name;
+    b->epoch = -1;
+    SDL_AtomicSetPtr((void **)&buffers[slot], b);
+    return b;
+}
+
+TraceBuffer *trace_reserve_buffer(const char *name)
+{
+    if (!tls_buffer) return NULL;
+    return new_buffer(name);
+}
+
+void trace_use_buffer(TraceBuffer *b)
+{
+    if (!tls_buffer) return;
+    if (b) b->tid = SDL_ThreadID();
+    SDL_TLSSet(tls_buffer, b ? b : &no_buffer, NULL);
+}
+
+static TraceBuffer *thread_buffer(void)
+{
+    if (!tls_buffer) return NULL;
+
+    TraceBuffer *b = (TraceBuffer *)SDL_TLSGet(tls_buffer);
+    if (b) return (b == &no_buffer) ? NULL : b;
+
+    b = new_buffer((const char *)SDL_TLSGet(tls_name));
+    if (!b) {
+        SDL_TLSSet(tls_buffer, &no_buffer, NULL);
+        return NULL;
+    }
+
+    b->tid = SDL_ThreadID();
+    SDL_TLSSet(tls_buffer, b, NULL);
+    return b;
+}
+
+void trace_record(const char *name, const char *detail, char phase)
+{
+    TraceBuffer *b = thread_buffer();
+    if (!b) return;
+
+    /* Claim the ring, then check the capture is still running: either
+     * trace_finish() sees busy set and waits, or this sees trace_on clear. */
+    SDL_AtomicSet(&b->busy, 1);
+    if (!trace_enabled()) {
+        SDL_AtomicSet(&b->busy, 0);
+        return;
+    }
+
+    int epoch = SDL_AtomicGet(&capture_epoch);
+    if (b->epoch != epoch) {
+        b->epoch = epoch;
+        SDL_AtomicSet(&b->head, 0);
+    }
+
+    int head = SDL_AtomicGet(&b->head);
+    TraceEvent *ev = &b->events[head % TRACE_RING_EVENTS];
+    ev->name = name;
+    ev->ts = SDL_GetPerformanceCounter();
+    ev->phase = phase;
+    if (detail) {
+        strncpy(ev->detail, detail, TRACE_DETAIL - 1);
+        ev->detail[TRACE_DETAIL - 1] = '\0';
+    } else {
+        ev->detail[0] = '\0';
+    }
+    SDL_AtomicSet(&b->head, head + 1);
+    SDL_AtomicSet(&b->busy, 0);
+}
+
+void trace_capture(const char *path, Uint32 ms)
+{
+    if (!path || trace_enabled()) return;
+    trace_init();
+
+    strncpy(capture_path, path, sizeof capture_path - 1);
+    capture_path[sizeof capture_path - 1] = '\0';
+    capture_start = SDL_GetPerformanceCounter();
+    capture_end = ms ? SDL_GetTicks() + ms : 0;
+    if (capture_end == 0 && ms) capture_end = 1;
+
+    SDL_AtomicAdd(&capture_epoch, 1);
+    SDL_AtomicSet(&trace_on, 1);
+}
+
+void trace_poll(void)
+{
+    if (!trace_enabled() || capture_end == 0) return;
+    if (SDL_TICKS_PASSED(SDL_GetTicks(), capture_end))
+        (void)trace_finish();
+}
+
+/* JSON string body; names and details are short ASCII. */
+static void write_escaped(FILE *f, const char *s)
+{
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        if ((unsigned char)*s >= 0x20) fputc(*s, f);
+    }
+}
+
+int trace_finish(void)
+{
+    if (!trace_enabled()) return -1;
+    SDL_AtomicSet(&trace_on, 0);
+    capture_end = 0;
+
+    FILE *f = fopen(capture_path, "w");
+    if (!f) {
+        fprintf(stderr, "TRACE: cannot write %s\n", capture_path);
+        return -1;
+    }
+
+    const int epoch = SDL_AtomicGet(&capture_epoch);
+    const double to_us = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+    int threads = SDL_AtomicGet(&buffer_count);
+    if (threads > TRACE_MAX_THREADS) threads = TRACE_MAX_THREADS;
+
+    long written = 0;
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    for (int t = 0; t < threads; t++) {
+        TraceBuffer *b = (TraceBuffer *)SDL_AtomicGetPtr((void **)&buffers[t]);
+        if (!b) continue;
+
+        /* Let an event still being written finish; later ones see trace_on
+         * clear and are dropped. */
+        while (SDL_AtomicGet(&b->busy))
+            SDL_Delay(0);
+        if (b->epoch != epoch) continue;
+
+        unsigned long tid = (unsigned long)b->tid;
+        fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %lu, "
+                   "\"args\": {\"name\": \"", written ? ",\n" : "", tid);
+        write_escaped(f, b->thread_name ? b->thread_name : "thread");
+        fprintf(f, "\"}}");
+        written++;
+
+        /* A thread that recorded more than the ring holds keeps its newest
+         * events. */
+        int head = SDL_AtomicGet(&b->head);
+        int first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        for (int i = first; i < head; i++) {
+            const TraceEvent *ev = &b->events[i % TRACE_RING_EVENTS];
+            double ts = (double)(Sint64)(ev->ts - capture_start) * to_us;
+
+            fprintf(f, ",\n{\"name\": \"");
+            write_escaped(f, ev->name);
+            fprintf(f, "\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %lu",
+                    ev->phase, ts, tid);
+            if (ev->detail[0]) {
+                fprintf(f, ", \"args\": {\"detail\": \"");
+                write_escaped(f, ev->detail);
+                fprintf(f, "\"}");
+            }
+            fprintf(f, "}");
+            written++;
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    int rc = ferror(f) ? -1 : 0;
+    fclose(f);
+
+    if (rc == 0)
+        printf("TRACE: wrote %ld events to %s\n", written, capture_path);
+    else
+        fprintf(stderr, "TRACE: error writing %s\n", capture_path);
+    return rc;
+}
@@ -0,0 +1,86 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Trace capture in Chrome trace-event JSON (chrome://tracing, Perfetto).
+ *
+ * Code marks begin/end events around interesting work. While a capture is
+ * running each thread appends to its own ring buffer, found through SDL
+ * thread-local storage; there are no locks, and the oldest events are
+ * overwritten if a thread records more than the ring holds. When the
+ * capture stops, every thread's events are written to one JSON file with
+ * their thread ids and names. A ring is allocated on its thread's first
+ * event; a thread that must not allocate (the audio callback) is given one
+ * made beforehand with trace_reserve_buffer().
+ *
+ * Event names must be string literals (only the pointer is stored); the
+ * optional detail string is copied.
+ */
+
+/* Events kept per thread. */
+#define TRACE_RING_EVENTS 32768
+
+/* Create the TLS slots. Call once at startup, before other threads run. */
+void trace_init(void);
+
+/* Name the calling thread in the trace ("main", "audio", ...). */
+void trace_set_thread_name(const char *name);
+
+typedef struct TraceBuffer TraceBuffer;
+
+/* Allocate the ring for a thread that has not started yet, named name.
+ * Returns NULL if there is none to give (that thread is then not traced). */
+TraceBuffer *trace_reserve_buffer(const char *name);
+
+/* Make b, from trace_reserve_buffer(), the calling thread's ring. Call on
+ * that thread before its first event; with NULL the thread is not traced.
+ * Once its thread has ended, b may be handed to a thread replacing it. */
+void trace_use_buffer(TraceBuffer *b);
+
+extern SDL_atomic_t trace_on;
+
+/* 1 while a capture is running. */
+static inline int trace_enabled(void)
+{
+    return SDL_AtomicGet(&trace_on);
+}
+
+void trace_record(const char *name, const char *detail, char phase);
+
+static inline void trace_begin(const char *name)
+{
+    if (trace_enabled()) trace_record(name, NULL, 'B');
+}
+
+static inline void trace_end(const char *name)
+{
+    if (trace_enabled()) trace_record(name, NULL, 'E');
+}
+
+/* Begin event with a detail shown as args.detail (e.g. the file name). */
+static inline void trace_begin_detail(const char *name, const char *detail)
+{
+    if (trace_enabled()) trace_record(name, detail, 'B');
+}
+
+/* Trace a single statement. */
+#define TRACE_SCOPE(name, stmt) do { \
+        trace_begin(name);           \
+        stmt;                        \
+        trace_end(name);             \
+    } while (0)
+
+/* Start a capture that is written to path. With ms > 0 it stops by itself
+ * once trace_poll() sees that much time has passed. */
+void trace_capture(const char *path, Uint32 ms);
+
+/* Stop a timed capture whose time is up. Call once per frame. */
+void trace_poll(void);
+
+/* Stop the running capture and write it. Returns 0 on success, -1 if
+ * nothing was running or the file could not be written. */
+int trace_finish(void);
+
+#endif /* TRACE_H */